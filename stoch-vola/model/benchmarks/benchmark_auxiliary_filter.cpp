@@ -0,0 +1,69 @@
+#include <vector>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <random>
+
+#include <Eigen/Dense>
+
+#include "model/stochastic_volatility_model.h"
+
+//Variance of the log marginal likelihood estimate against CPU time for the bootstrap and the
+//auxiliary filter on a simulated series with a volatility jump every 50 steps. Efficiency is 1 / (variance * seconds),
+//higher is better. Usage: benchmark_auxiliary_filter [seriesLength] [runs]
+
+namespace {
+  Eigen::VectorXd simulate(const unsigned int& T, const double& mu, const double& phi, const double& sigma) {
+    std::mt19937 generator(42);
+    std::normal_distribution<double> normal(0.0, 1.0);
+
+    Eigen::VectorXd y(T);
+    double x = mu;
+    for (unsigned int t = 0; t < T; ++t) {
+      x = mu + phi * (x - mu) + sigma * normal(generator);
+      if (t % 50 == 25) {//volatility jumps
+        x += 3.0;
+      }
+      y[t] = std::exp(0.5 * x) * normal(generator);
+    }
+    return y;
+  }
+
+  const char* proposalName(const FilterProposal& proposal) {
+    return proposal == FilterProposal::Auxiliary ? "Auxiliary" : "Bootstrap";
+  }
+}
+
+
+int main(int argc, char** argv) {
+  const unsigned int T = argc > 1 ? std::stoul(argv[1]) : 500;
+  const unsigned int runs = argc > 2 ? std::stoul(argv[2]) : 50;
+
+  //unconstrained parameters as taken by the model: phi = tanh(2.0), sigma = exp(-1.5)
+  StochasticVolatilityModel svm(-1.0, 2.0, -1.5);
+  Eigen::VectorXd y = simulate(T, -1.0, std::tanh(2.0), std::exp(-1.5));
+
+  std::printf("T = %u, %u runs per row\n", T, runs);
+  std::printf("%-10s  %8s  %12s  %12s  %14s  %12s\n", "proposal", "N", "mean", "variance", "ms per run", "efficiency");
+
+  for (FilterProposal proposal : {FilterProposal::Bootstrap, FilterProposal::Auxiliary}) {
+    FilterOptions options;
+    options.proposal = proposal;
+
+    for (unsigned int N : {100u, 250u, 500u, 1000u, 2500u}) {
+      Eigen::VectorXd estimates(runs);
+      auto start = std::chrono::steady_clock::now();
+      for (unsigned int r = 0; r < runs; ++r) {
+        estimates[r] = svm.logMarginalLikelihood(y, N, 1000 + r, options);
+      }
+      std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+      const double variance = (estimates.array() - estimates.mean()).square().sum() / (runs - 1);
+      const double seconds = elapsed.count() / runs;
+      std::printf("%-10s  %8u  %12.3f  %12.4f  %14.3f  %12.1f\n", proposalName(proposal), N, estimates.mean(),
+                  variance, 1000.0 * seconds, 1.0 / (variance * seconds));
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,109 @@
+"""Copy volume of the NumPy interface of the stochastic_volatility_model module.
+
+Trajectories: resident memory added while handing a particleFilter result to Python, through the
+copying getParticles() and through the buffer protocol views (numpy.asarray, getParticlesView),
+for double and single precision particles, next to an explicit numpy.array copy as the reference. Observations: time per logLikelihood call with a
+contiguous series, a strided slice of a larger buffer (both read in place) and a float32 series
+(converted into a temporary double copy), with few particles so the argument handling shows.
+
+Usage: python benchmark_numpy_interop.py [seriesLength] [particles]   (Linux, as rows run in forked children)
+"""
+import os
+import resource
+import sys
+import time
+
+import numpy as np
+
+import stochastic_volatility_model as svm
+
+
+def allocated_bytes(function):
+    """Growth of the peak resident set while running function, measured in a forked child.
+
+    tracemalloc only sees Python's allocators, not the Eigen buffer the bindings copy into, hence
+    ru_maxrss (KiB on Linux). A forked child starts its peak from the parent's current resident set,
+    so neither the filter runs nor earlier rows mask the copy.
+    """
+    read, write = os.pipe()
+    pid = os.fork()
+    if pid == 0:
+        os.close(read)
+        before = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+        function()
+        after = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+        os.write(write, str(1024 * (after - before)).encode())
+        os._exit(0)
+    os.close(write)
+    with os.fdopen(read) as pipe:
+        grown = int(pipe.read())
+    os.waitpid(pid, 0)
+    return grown
+
+
+def seconds_per_call(function, repeats=20):
+    start = time.perf_counter()
+    for _ in range(repeats):
+        function()
+    return (time.perf_counter() - start) / repeats
+
+
+def simulate(length, mu=-1.0, phi=0.95, sigma=0.2, seed=42):
+    generator = np.random.default_rng(seed)
+    x = mu
+    y = np.empty(length)
+    for t in range(length):
+        x = mu + phi * (x - mu) + sigma * generator.standard_normal()
+        y[t] = np.exp(0.5 * x) * generator.standard_normal()
+    return y
+
+
+def main():
+    length = int(sys.argv[1]) if len(sys.argv) > 1 else 1000
+    particles = int(sys.argv[2]) if len(sys.argv) > 2 else 10000
+
+    # unconstrained parameters as taken by the model: phi = tanh(2.0), sigma = exp(-1.5)
+    model = svm.StochasticVolatilityModel(-1.0, 2.0, -1.5)
+    y = simulate(length)
+
+    options = svm.FilterOptions()
+    double_result = model.particleFilter(y, particles, 123, options)
+    single_result = model.particleFilterSingle(y, particles, 123, options)
+
+    print(f"T = {length}, N = {particles}, trajectories {length * particles * 8 / 2**20:.1f} MiB in double")
+    print(f"{'trajectories to Python':34s}  {'allocated MiB':>14s}")
+    rows = [
+        ("numpy.array copy (reference)", lambda: np.array(np.asarray(double_result))),
+        ("getParticles() (copy)", lambda: double_result.getParticles()),
+        ("numpy.asarray (view)", lambda: np.asarray(double_result)),
+        ("getParticlesView() (view)", lambda: double_result.getParticlesView()),
+        ("single getParticles() (copy)", lambda: single_result.getParticles()),
+        ("single numpy.asarray (view)", lambda: np.asarray(single_result)),
+    ]
+    measured = {name: allocated_bytes(function) for name, function in rows}
+    for name, grown in measured.items():
+        print(f"{name:34s}  {grown / 2**20:14.2f}")
+    if measured["numpy.array copy (reference)"] < 0.9 * length * particles * 8:
+        print("the reference copy shows less than its size (freed pages reused?), read the rows as lower bounds")
+
+    view = np.asarray(double_result)
+    assert not view.flags.writeable
+    assert np.array_equal(view, double_result.getParticles())
+    del double_result  # the view keeps the particles alive
+    assert np.isfinite(view).all()
+
+    few = 10
+    buffer = np.repeat(y, 2)
+    inputs = [
+        ("contiguous float64", y),
+        ("strided float64 slice", buffer[::2]),
+        ("float32 (converted)", y.astype(np.float32)),
+    ]
+    print(f"\n{'observations, N = ' + str(few):34s}  {'us/call':>14s}")
+    for name, series in inputs:
+        seconds = seconds_per_call(lambda: model.logLikelihood(series, few, 123, options))
+        print(f"{name:34s}  {1e6 * seconds:14.1f}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,122 @@
+#include <cmath>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <functional>
+
+#include <Eigen/Dense>
+
+#include "model/stochastic_volatility_model.h"
+#include "statistics/particles.h"
+#include "statistics/resampling.h"
+
+//Times the per-step Particles path (append, latest, resample) and the full filter for both
+//storage layouts, then the volatility transform exp(x/2) and the 5/50/95% bands per time step through
+//std::function against the templated and built-in paths. Usage: benchmark_particles [nParticles] [seriesLength]
+
+namespace {
+  double bestOf(const int& repetitions, const std::function<void()>& run) {
+    double best = 0.0;
+    for (int r = 0; r < repetitions; ++r) {
+      auto start = std::chrono::steady_clock::now();
+      run();
+      std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+      if (r == 0 || elapsed.count() < best) {
+        best = elapsed.count();
+      }
+    }
+    return best;
+  }
+
+  const char* layoutName(const ParticleLayout& layout) {
+    return layout == ParticleLayout::TimeMajor ? "TimeMajor " : "TraceMajor";
+  }
+}
+
+
+int main(int argc, char** argv) {
+  const unsigned int N = argc > 1 ? std::stoul(argv[1]) : 1000;
+  const unsigned int T = argc > 2 ? std::stoul(argv[2]) : 500;
+  const int repetitions = 5;
+
+  Eigen::VectorXd y = Eigen::VectorXd::Random(T);
+  Eigen::VectorXd cloud = Eigen::VectorXd::Random(N);
+  Eigen::VectorXd weights = Eigen::VectorXd::Random(N).cwiseAbs();
+  StochasticVolatilityModel svm(0.0, 0.5, -0.5);
+
+  std::printf("N = %u, T = %u, best of %d runs [ms]\n", N, T, repetitions);
+  std::printf("%-10s  %12s  %12s  %12s  %12s\n", "layout", "append", "copy", "genealogy", "filter");
+
+  for (ParticleLayout layout : {ParticleLayout::TraceMajor, ParticleLayout::TimeMajor}) {
+    double append = bestOf(repetitions, [&]() {
+      Particles particles(cloud, T+1, layout);
+      for (unsigned int t = 1; t <= T; ++t) {
+        particles.appendParticles(particles.getLatestParticles());
+      }
+    });
+
+    auto resampled = [&](const PathStorage& storage) {
+      return bestOf(repetitions, [&]() {
+        Particles particles(cloud, T+1, layout);
+        particles.setPathStorage(storage);
+        for (unsigned int t = 1; t <= T; ++t) {
+          particles.appendParticles(particles.getLatestParticles());
+          particles.resampleParticles(weights, ResamplingScheme::Systematic, t);
+        }
+      });
+    };
+    double copy = resampled(PathStorage::Copy);
+    double genealogy = resampled(PathStorage::Genealogy);
+
+    FilterOptions options;
+    options.particleLayout = layout;
+    double filter = bestOf(repetitions, [&]() {
+      svm.particleFilter(y, N, 123, options);
+    });
+
+    std::printf("%-10s  %12.2f  %12.2f  %12.2f  %12.2f\n", layoutName(layout), append, copy, genealogy, filter);
+  }
+
+  const unsigned int threads = 4;
+  const std::vector<double> bands = {0.05, 0.5, 0.95};
+  std::printf("\n%-10s  %12s  %12s  %12s  %12s  %12s  %12s\n", "layout", "exp/function", "exp/inlined", "exp/array",
+              "exp/threads", "bands/sort", "bands/select");
+  for (ParticleLayout layout : {ParticleLayout::TraceMajor, ParticleLayout::TimeMajor}) {
+    Particles particles(Eigen::MatrixXd(Eigen::MatrixXd::Random(T+1, N)), T+1, layout);
+
+    auto transformed = [&](const std::function<void(Particles&)>& transform) {
+      return bestOf(repetitions, [&]() {
+        Particles copy = particles;
+        transform(copy);
+      });
+    };
+    double function = transformed([](Particles& p) {
+      p.applyTransformation(std::function<double(double)>([](double v) {return std::exp(0.5 * v);}));
+    });
+    double inlined = transformed([](Particles& p) { p.applyTransformation([](double v) {return std::exp(0.5 * v);}); });
+    double array = transformed([](Particles& p) { p.applyArrayTransformation([](const auto& x) {return (0.5 * x).exp();}); });
+    double parallel = transformed([&](Particles& p) {
+      p.applyArrayTransformation([](const auto& x) {return (0.5 * x).exp();}, threads);
+    });
+
+    double sorted = bestOf(repetitions, [&]() {
+      for (double q : bands) {
+        particles.reduceParticles(std::function<double(const Eigen::VectorXd&)>([&](const Eigen::VectorXd& v) {
+          std::vector<double> values(v.data(), v.data() + v.size());
+          std::sort(values.begin(), values.end());
+          return values[static_cast<size_t>(q * (values.size() - 1))];
+        }));
+      }
+    });
+    double selected = bestOf(repetitions, [&]() {
+      particles.particleQuantiles(bands, threads);
+    });
+
+    std::printf("%-10s  %12.2f  %12.2f  %12.2f  %12.2f  %12.2f  %12.2f\n", layoutName(layout), function, inlined, array,
+                parallel, sorted, selected);
+  }
+
+  return 0;
+}
@@ -0,0 +1,70 @@
+#include <vector>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <random>
+
+#include <Eigen/Dense>
+
+#include "model/stochastic_volatility_model.h"
+
+//Throughput of the bootstrap filter with double and single precision particles, and how far the
+//single precision log-likelihood drifts from the double one. Both average the same seeds, so the
+//difference is the float error plus the Monte Carlo noise of the differing draws.
+//Usage: benchmark_precision [seriesLength] [runs]
+
+namespace {
+  Eigen::VectorXd simulate(const unsigned int& T, const double& mu, const double& phi, const double& sigma) {
+    std::mt19937 generator(42);
+    std::normal_distribution<double> normal(0.0, 1.0);
+
+    Eigen::VectorXd y(T);
+    double x = mu;
+    for (unsigned int t = 0; t < T; ++t) {
+      x = mu + phi * (x - mu) + sigma * normal(generator);
+      y[t] = std::exp(0.5 * x) * normal(generator);
+    }
+    return y;
+  }
+
+  double meanLogLikelihood(StochasticVolatilityModel& svm, const Eigen::VectorXd& y, const unsigned int& N,
+                           const unsigned int& runs, const FilterOptions& options, double& seconds) {
+    double sum = 0.0;
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned int r = 0; r < runs; ++r) {
+      sum += svm.logLikelihood(y, N, 1000 + r, options);
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    seconds = elapsed.count() / runs;
+    return sum / runs;
+  }
+}
+
+
+int main(int argc, char** argv) {
+  const unsigned int T = argc > 1 ? std::stoul(argv[1]) : 500;
+  const unsigned int runs = argc > 2 ? std::stoul(argv[2]) : 10;
+
+  //unconstrained parameters as taken by the model: phi = tanh(2.0), sigma = exp(-1.5)
+  StochasticVolatilityModel svm(-1.0, 2.0, -1.5);
+  Eigen::VectorXd y = simulate(T, -1.0, std::tanh(2.0), std::exp(-1.5));
+
+  FilterOptions doubleOptions;
+  FilterOptions singleOptions;
+  singleOptions.precision = FilterPrecision::Single;
+
+  std::printf("T = %u, %u runs per row\n", T, runs);
+  std::printf("%8s  %16s  %16s  %8s  %14s\n", "N", "double Mstep/s", "single Mstep/s", "speedup", "loglik delta");
+
+  for (unsigned int N : {1000u, 10000u, 100000u}) {
+    double doubleSeconds, singleSeconds;
+    const double doubleLogLike = meanLogLikelihood(svm, y, N, runs, doubleOptions, doubleSeconds);
+    const double singleLogLike = meanLogLikelihood(svm, y, N, runs, singleOptions, singleSeconds);
+
+    const double particleSteps = 1e-6 * N * T;
+    std::printf("%8u  %16.1f  %16.1f  %8.2f  %14.2e\n", N, particleSteps / doubleSeconds, particleSteps / singleSeconds,
+                doubleSeconds / singleSeconds, singleLogLike - doubleLogLike);
+  }
+
+  return 0;
+}
@@ -0,0 +1,100 @@
+#include <vector>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <random>
+
+#include <Eigen/Dense>
+#include <EigenRand/EigenRand>
+
+#include "model/stochastic_volatility_model.h"
+#include "statistics/random_engine.h"
+
+//Cost of the per-step propagation noise: a freshly constructed P8_mt19937_64 per step (as the filters
+//used to), the reseeded Mersenne Twister of the filters and the counter-based Philox stream. Then the
+//bootstrap filter with both engines over 1 and 4 threads, where only Philox keeps the same value.
+//Usage: benchmark_random_engine [particles] [steps]
+
+namespace {
+  template <typename Draw>
+  double nanosecondsPerDraw(const unsigned int& N, const unsigned int& steps, const Draw& draw) {
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned int t = 1; t <= steps; ++t) {
+      draw(t);
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return 1e9 * elapsed.count() / (static_cast<double>(N) * steps);
+  }
+
+  Eigen::VectorXd simulate(const unsigned int& T, const double& mu, const double& phi, const double& sigma) {
+    std::mt19937 generator(42);
+    std::normal_distribution<double> normal(0.0, 1.0);
+
+    Eigen::VectorXd y(T);
+    double x = mu;
+    for (unsigned int t = 0; t < T; ++t) {
+      x = mu + phi * (x - mu) + sigma * normal(generator);
+      y[t] = std::exp(0.5 * x) * normal(generator);
+    }
+    return y;
+  }
+}
+
+
+int main(int argc, char** argv) {
+  const unsigned int N = argc > 1 ? std::stoul(argv[1]) : 1000;
+  const unsigned int steps = argc > 2 ? std::stoul(argv[2]) : 2000;
+
+  Eigen::VectorXd noise(N);
+  double checksum = 0.0;
+
+  const double fresh = nanosecondsPerDraw(N, steps, [&](const unsigned int& t) {
+    Eigen::Rand::P8_mt19937_64 engine{t};
+    noise = Eigen::Rand::normal<Eigen::VectorXd>(N, 1, engine);
+    checksum += noise[0];
+  });
+
+  ReseedableMersenneTwister mersenneTwister;
+  const double reseeded = nanosecondsPerDraw(N, steps, [&](const unsigned int& t) {
+    mersenneTwister.seed(t);
+    mersenneTwister.standardNormal(noise, N);
+    checksum += noise[0];
+  });
+
+  PhiloxEngine philox;
+  const double counterBased = nanosecondsPerDraw(N, steps, [&](const unsigned int& t) {
+    philox.seed(123, t);
+    philox.standardNormal(noise);
+    checksum += noise[0];
+  });
+
+  std::printf("N = %u, %u steps (checksum %.3f)\n", N, steps, checksum);
+  std::printf("%-28s  %8s\n", "noise per step", "ns/draw");
+  std::printf("%-28s  %8.2f\n", "new P8_mt19937_64", fresh);
+  std::printf("%-28s  %8.2f\n", "reseeded Mersenne Twister", reseeded);
+  std::printf("%-28s  %8.2f\n", "Philox", counterBased);
+
+  //unconstrained parameters as taken by the model: phi = tanh(2.0), sigma = exp(-1.5)
+  StochasticVolatilityModel svm(-1.0, 2.0, -1.5);
+  const unsigned int T = 500;
+  Eigen::VectorXd y = simulate(T, -1.0, std::tanh(2.0), std::exp(-1.5));
+
+  std::printf("\nbootstrap filter, N = %u, T = %u\n", N * 10, T);
+  std::printf("%-16s  %8s  %14s  %22s\n", "engine", "threads", "Mstep/s", "loglik");
+  for (RandomEngine randomEngine : {RandomEngine::MersenneTwister, RandomEngine::Philox}) {
+    for (unsigned int threads : {1u, 4u}) {
+      FilterOptions options;
+      options.randomEngine = randomEngine;
+      options.threadCount = threads;
+
+      auto start = std::chrono::steady_clock::now();
+      const double logLikelihood = svm.logLikelihood(y, N * 10, 123, options);
+      std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+      std::printf("%-16s  %8u  %14.1f  %22.15f\n", randomEngine == RandomEngine::Philox ? "Philox" : "MersenneTwister",
+                  threads, 1e-6 * N * 10 * T / elapsed.count(), logLikelihood);
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,400 @@
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include <Eigen/Dense>
+#include <benchmark/benchmark.h>
+
+#include "model/bootstrap_filter.h"
+#include "model/bootstrap_kernels.h"
+#include "model/stochastic_volatility_model.h"
+#include "model/sv_models.h"
+#include "statistics/allocation_counter.h"
+#include "statistics/normal_distribution.h"
+#include "statistics/particles.h"
+#include "statistics/random_engine.h"
+#include "statistics/resampling.h"
+#include "statistics/util_funs.h"
+
+//Google Benchmark suite for regression tracking between releases. Filters sweep the particle count N
+//over 1e2..1e6 and the series length T over 1e2..1e4, the stage benchmarks repeat the pieces of one
+//serial bootstrap step (propagate, weight, normalise, resample) on N particles, BM_ModelLogLikelihood compares
+//the model policies of BootstrapFilter (0 Gaussian, 1 Student-t, 2 leverage) and BM_LikelihoodVariance
+//compares the likelihood variance of the Mersenne Twister and Sobol engines for their cost. Besides the time,
+//every benchmark reports
+//  per_particle_step / per_particle  time per particle and step (per particle for the stages)
+//  allocations, bytes_allocated      heap allocations per iteration (glibc only, see allocation_counter.h)
+//  peak_rss                          resident set high-water mark during the benchmark (Linux only)
+//JSON for comparisons: benchmark_suite --benchmark_out=results.json --benchmark_out_format=json
+//and tools/compare.py of Google Benchmark on two such files. --benchmark_filter selects a subset,
+//the largest filters run for minutes.
+
+
+namespace {
+  //resets the peak RSS of the process (Linux 4.0+), later readings start from the current RSS
+  void resetPeakResidentSetSize() {
+#if defined(__linux__)
+    if (std::FILE* file = std::fopen("/proc/self/clear_refs", "w")) {
+      std::fputs("5", file);
+      std::fclose(file);
+    }
+#endif
+  }
+
+  //VmHWM in bytes, 0 where unavailable
+  double peakResidentSetSize() {
+    double bytes = 0.0;
+#if defined(__linux__)
+    if (std::FILE* file = std::fopen("/proc/self/status", "r")) {
+      char line[256];
+      while (std::fgets(line, sizeof(line), file)) {
+        long kilobytes;
+        if (std::sscanf(line, "VmHWM: %ld kB", &kilobytes) == 1) {
+          bytes = 1024.0 * kilobytes;
+          break;
+        }
+      }
+      std::fclose(file);
+    }
+#endif
+    return bytes;
+  }
+
+  //Counts allocations over the timed loop and fills the memory counters once the loop is done
+  class MemoryCounters {
+    private:
+      long allocationsAtStart_;
+      long bytesAtStart_;
+
+    public:
+      MemoryCounters() {
+        resetPeakResidentSetSize();
+        allocationcounter::enable();
+        allocationsAtStart_ = allocationcounter::count();
+        bytesAtStart_ = allocationcounter::bytes();
+      }
+
+      void report(benchmark::State& state) {
+        const long allocations = allocationcounter::count() - allocationsAtStart_;
+        const long allocatedBytes = allocationcounter::bytes() - bytesAtStart_;
+        allocationcounter::disable();
+        state.counters["allocations"] = benchmark::Counter(allocations, benchmark::Counter::kAvgIterations);
+        state.counters["bytes_allocated"] = benchmark::Counter(allocatedBytes, benchmark::Counter::kAvgIterations,
+                                                               benchmark::Counter::OneK::kIs1024);
+        state.counters["peak_rss"] = benchmark::Counter(peakResidentSetSize(), benchmark::Counter::kDefaults,
+                                                        benchmark::Counter::OneK::kIs1024);
+      }
+  };
+
+  //time per unit of work, `units` per iteration
+  void reportTimePer(benchmark::State& state, const char* name, const double& units) {
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * units));
+    state.counters[name] = benchmark::Counter(units, benchmark::Counter::kIsIterationInvariantRate | benchmark::Counter::kInvert);
+  }
+
+  //simulated series of the benchmark model, the same for every run
+  Eigen::VectorXd simulatedSeries(const unsigned int& T) {
+    const double mu = 0.0, phi = std::tanh(0.5), sigma = std::exp(-0.5);
+    std::mt19937 generator(42);
+    std::normal_distribution<double> normal;
+
+    Eigen::VectorXd y(T);
+    double x = mu;
+    for (unsigned int t = 0; t < T; ++t) {
+      x = mu + phi * (x - mu) + sigma * normal(generator);
+      y[t] = std::exp(0.5 * x) * normal(generator);
+    }
+    return y;
+  }
+
+  const StochasticVolatilityModel benchmarkModel(0.0, 0.5, -0.5);
+
+  //particles spread like the filtering distribution of the benchmark model
+  Eigen::VectorXd cloud(const unsigned int& N) {
+    Eigen::VectorXd particles;
+    ReseedableMersenneTwister engine(7);
+    engine.standardNormal(particles, N);
+    return particles;
+  }
+
+  const char* schemeName(const long& scheme) {
+    static const char* names[] = {"Multinomial", "Stratified", "Systematic", "Residual"};
+    return names[scheme];
+  }
+
+  //N x T grid without the combinations of more than maxParticleSteps particle steps
+  void seriesGrid(benchmark::internal::Benchmark* benchmark, const double& maxParticleSteps) {
+    for (long N = 100; N <= 1000000; N *= 10) {
+      for (long T = 100; T <= 10000; T *= 10) {
+        if (static_cast<double>(N) * T <= maxParticleSteps) {
+          benchmark->Args({N, T});
+        }
+      }
+    }
+  }
+}
+
+
+static void BM_LogLikelihood(benchmark::State& state) {
+  const unsigned int N = state.range(0);
+  const unsigned int T = state.range(1);
+  Eigen::VectorXd y = simulatedSeries(T);
+
+  MemoryCounters memory;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(benchmarkModel.logLikelihood(y, N, 123));
+  }
+  memory.report(state);
+  reportTimePer(state, "per_particle_step", static_cast<double>(N) * T);
+}
+BENCHMARK(BM_LogLikelihood)->ArgNames({"N", "T"})->Apply([](benchmark::internal::Benchmark* b) { seriesGrid(b, 1e10); })
+                           ->Unit(benchmark::kMillisecond);
+
+static void BM_ParticleFilter(benchmark::State& state) {
+  const unsigned int N = state.range(0);
+  const unsigned int T = state.range(1);
+  Eigen::VectorXd y = simulatedSeries(T);
+
+  MemoryCounters memory;
+  for (auto _ : state) {
+    Particles particles = benchmarkModel.particleFilter(y, N, 123);
+    benchmark::DoNotOptimize(particles.getStorage().data());
+  }
+  memory.report(state);
+  reportTimePer(state, "per_particle_step", static_cast<double>(N) * T);
+}
+//trajectories of up to 800 MB
+BENCHMARK(BM_ParticleFilter)->ArgNames({"N", "T"})->Apply([](benchmark::internal::Benchmark* b) { seriesGrid(b, 1e8); })
+                            ->Unit(benchmark::kMillisecond);
+
+//the bootstrap filter of each model policy on the parameters of the benchmark model, nu = 7 and rho = -0.5:
+//the cost of the Student-t density and the leverage term over the Gaussian kernel
+static void BM_ModelLogLikelihood(benchmark::State& state) {
+  const unsigned int N = state.range(0);
+  const unsigned int T = 1000;
+  Eigen::VectorXd y = simulatedSeries(T);
+  const double mu = 0.0, phi = std::tanh(0.5), sigma = std::exp(-0.5);
+  const BootstrapFilter<GaussianSV> gaussian(GaussianSV(mu, phi, sigma));
+  const StudentTStochasticVolatilityModel studentT(StudentTSV(mu, phi, sigma, 7.0));
+  const LeverageStochasticVolatilityModel leverage(LeverageSV(mu, phi, sigma, -0.5));
+
+  MemoryCounters memory;
+  for (auto _ : state) {
+    switch (state.range(1)) {
+      case 0: benchmark::DoNotOptimize(gaussian.logLikelihood(y, N, 123)); break;
+      case 1: benchmark::DoNotOptimize(studentT.logLikelihood(y, N, 123)); break;
+      default: benchmark::DoNotOptimize(leverage.logLikelihood(y, N, 123));
+    }
+  }
+  memory.report(state);
+  reportTimePer(state, "per_particle_step", static_cast<double>(N) * T);
+}
+BENCHMARK(BM_ModelLogLikelihood)->ArgNames({"N", "model"})->ArgsProduct({benchmark::CreateRange(100, 100000, 10), {0, 1, 2}})
+                                ->Unit(benchmark::kMillisecond);
+
+//Monte Carlo against sequential quasi-Monte Carlo noise: one iteration runs 32 seeds on T = 100, the
+//counters give the variance of the log marginal likelihood across them and that variance times the
+//time per run, the work-normalised error the engines are compared by
+static void BM_LikelihoodVariance(benchmark::State& state) {
+  const unsigned int N = state.range(0);
+  const int runs = 32;
+  Eigen::VectorXd y = simulatedSeries(100);
+  FilterOptions options;
+  options.randomEngine = state.range(1) == 0 ? RandomEngine::MersenneTwister : RandomEngine::Sobol;
+
+  Eigen::VectorXd estimates(runs);
+  for (auto _ : state) {
+    for (int i = 0; i < runs; ++i) {
+      estimates[i] = benchmarkModel.logMarginalLikelihood(y, N, 1000 + i, options);
+    }
+  }
+  const double variance = (estimates.array() - estimates.mean()).square().sum() / (runs - 1);
+  state.counters["variance"] = variance;
+  //runs per second over the variance, inverted: the variance times the seconds per run
+  state.counters["variance_x_time"] = benchmark::Counter(runs / variance, benchmark::Counter::kIsIterationInvariantRate
+                                                                          | benchmark::Counter::kInvert);
+}
+BENCHMARK(BM_LikelihoodVariance)->ArgNames({"N", "sobol"})->ArgsProduct({benchmark::CreateRange(128, 32768, 4), {0, 1}})
+                                ->Unit(benchmark::kMillisecond);
+
+
+//Stages of the serial bootstrap step in StochasticVolatilityModel::filterStep, on reused buffers
+
+static void BM_StagePropagate(benchmark::State& state) {
+  const unsigned int N = state.range(0);
+  const double mu = 0.0, phi = std::tanh(0.5), sigma = std::exp(-0.5);
+  Eigen::VectorXd particles = cloud(N);
+  Eigen::VectorXd noise(N);
+  ReseedableMersenneTwister engine;
+
+  MemoryCounters memory;
+  unsigned int seed = 0;
+  for (auto _ : state) {
+    engine.seed(++seed);
+    engine.standardNormal(noise, N);
+    particles = mu + phi * (particles.array() - mu) + noise.array() * sigma;
+    benchmark::DoNotOptimize(particles.data());
+  }
+  memory.report(state);
+  reportTimePer(state, "per_particle", N);
+}
+BENCHMARK(BM_StagePropagate)->ArgName("N")->RangeMultiplier(10)->Range(100, 1000000);
+
+static void BM_StageWeight(benchmark::State& state) {
+  const unsigned int N = state.range(0);
+  const double y = 0.3;
+  Eigen::VectorXd particles = cloud(N);
+  Eigen::VectorXd scratch(N);
+
+  MemoryCounters memory;
+  for (auto _ : state) {
+    scratch = (particles / 2.0).array().exp();
+    scratch = (-0.5 * std::log(2 * M_PI) - scratch.array().log()) - 0.5 * (y / scratch.array()).pow(2);
+    benchmark::DoNotOptimize(scratch.data());
+  }
+  memory.report(state);
+  reportTimePer(state, "per_particle", N);
+}
+BENCHMARK(BM_StageWeight)->ArgName("N")->RangeMultiplier(10)->Range(100, 1000000);
+
+static void BM_StageNormalise(benchmark::State& state) {
+  const unsigned int N = state.range(0);
+  const Eigen::VectorXd logLikelihoods = benchmarkModel.observationLogLikelihoods(cloud(N), 0.3);
+  Eigen::VectorXd logWeights = Eigen::VectorXd::Constant(N, -std::log(N));
+  Eigen::VectorXd scratch(N);
+  Eigen::VectorXd weights(N);
+
+  MemoryCounters memory;
+  for (auto _ : state) {
+    scratch = logLikelihoods + logWeights;
+    const double maxLogWeight = scratch.maxCoeff();
+    weights = (scratch.array() - maxLogWeight).exp();
+    const double weightSum = weights.sum();
+    weights /= weightSum;
+    logWeights = scratch.array() - (maxLogWeight + std::log(weightSum));
+    benchmark::DoNotOptimize(1.0 / weights.squaredNorm());
+  }
+  memory.report(state);
+  reportTimePer(state, "per_particle", N);
+}
+BENCHMARK(BM_StageNormalise)->ArgName("N")->RangeMultiplier(10)->Range(100, 1000000);
+
+//propagate, weight and normalise as the bootstrap step runs them, one pass each of the fused kernels
+static void BM_StageFused(benchmark::State& state) {
+  const unsigned int N = state.range(0);
+  const double mu = 0.0, phi = std::tanh(0.5), sigma = std::exp(-0.5), y = 0.3;
+  Eigen::VectorXd particles = cloud(N);
+  Eigen::VectorXd logWeights = Eigen::VectorXd::Constant(N, -std::log(N));
+  Eigen::VectorXd weights = Eigen::VectorXd::Constant(N, 1.0 / N);
+  Eigen::VectorXd scratch(N);
+  ReseedableMersenneTwister engine;
+
+  const GaussianSV::Step<double> kernel = GaussianSV(mu, phi, sigma).step<double>(0.0, y);
+
+  MemoryCounters memory;
+  unsigned int seed = 0;
+  for (auto _ : state) {
+    engine.seed(++seed);
+    engine.standardNormal(scratch, N);
+    const kernels::WeighResult weighed = kernels::propagateAndWeigh<double>(particles, scratch, logWeights, weights, scratch, kernel);
+    const kernels::ExponentiateResult sums = kernels::exponentiate<double>(scratch, weights, weighed.maxLogWeight);
+    kernels::normalise<double>(scratch, weights, logWeights, sums.weightSum, weighed.maxLogWeight + std::log(sums.weightSum));
+    benchmark::DoNotOptimize(sums.weightSum * sums.weightSum / sums.squaredWeightSum);
+  }
+  memory.report(state);
+  reportTimePer(state, "per_particle", N);
+}
+BENCHMARK(BM_StageFused)->ArgName("N")->RangeMultiplier(10)->Range(100, 1000000);
+
+static void BM_StageResample(benchmark::State& state) {
+  const unsigned int N = state.range(0);
+  const ResamplingScheme scheme = static_cast<ResamplingScheme>(state.range(1));
+  Eigen::VectorXd weights = benchmarkModel.observationLogLikelihoods(cloud(N), 0.3).array().exp();
+  weights /= weights.sum();
+  Eigen::VectorXi ancestors(N);
+  Eigen::VectorXd uniforms(N);
+  Eigen::VectorXd residuals(N);
+  std::mt19937 generator(123);
+
+  MemoryCounters memory;
+  for (auto _ : state) {
+    resampling::ancestorIndices(weights, scheme, generator, ancestors, uniforms, residuals);
+    benchmark::DoNotOptimize(ancestors.data());
+  }
+  memory.report(state);
+  reportTimePer(state, "per_particle", N);
+  state.SetLabel(schemeName(state.range(1)));
+}
+BENCHMARK(BM_StageResample)->ArgNames({"N", "scheme"})->ArgsProduct({benchmark::CreateRange(100, 1000000, 10), {0, 1, 2, 3}});
+
+
+//Public building blocks as called from outside the filters
+
+static void BM_ResampleParticles(benchmark::State& state) {
+  const unsigned int N = state.range(0);
+  const Eigen::VectorXd initial = cloud(N);
+  Eigen::VectorXd weights = benchmarkModel.observationLogLikelihoods(initial, 0.3).array().exp();
+  Particles particles(initial);
+
+  MemoryCounters memory;
+  unsigned int seed = 0;
+  for (auto _ : state) {
+    particles.resampleParticles(weights, ResamplingScheme::Systematic, ++seed);
+  }
+  memory.report(state);
+  reportTimePer(state, "per_particle", N);
+}
+BENCHMARK(BM_ResampleParticles)->ArgName("N")->RangeMultiplier(10)->Range(100, 1000000);
+
+static void BM_IndependentVectorNormalLogLikelihoods(benchmark::State& state) {
+  const unsigned int N = state.range(0);
+  const Eigen::VectorXd stdDevs = (cloud(N) / 2.0).array().exp();
+  IndependentVectorNormal distribution(Eigen::VectorXd::Zero(N), stdDevs);
+
+  MemoryCounters memory;
+  for (auto _ : state) {
+    Eigen::VectorXd logLikelihoods = distribution.logLikelihoods(0.3);
+    benchmark::DoNotOptimize(logLikelihoods.data());
+  }
+  memory.report(state);
+  reportTimePer(state, "per_particle", N);
+}
+BENCHMARK(BM_IndependentVectorNormalLogLikelihoods)->ArgName("N")->RangeMultiplier(10)->Range(100, 1000000);
+
+//5/50/95% bands of a weighted cloud, as SVFilterState::getFilteredQuantiles returns them
+static void BM_WeightedQuantiles(benchmark::State& state) {
+  const unsigned int N = state.range(0);
+  const Eigen::VectorXd particles = cloud(N);
+  const Eigen::VectorXd weights = benchmarkModel.observationLogLikelihoods(particles, 0.3).array().exp();
+  const std::vector<double> bands = {0.05, 0.5, 0.95};
+
+  MemoryCounters memory;
+  for (auto _ : state) {
+    Eigen::VectorXd quantiles = utilfuns::weightedQuantiles(particles, weights, bands);
+    benchmark::DoNotOptimize(quantiles.data());
+  }
+  memory.report(state);
+  reportTimePer(state, "per_particle", N);
+}
+BENCHMARK(BM_WeightedQuantiles)->ArgName("N")->RangeMultiplier(10)->Range(100, 1000000);
+
+//the same bands per time step of a time x particles matrix, split over threads
+static void BM_RowQuantiles(benchmark::State& state) {
+  const unsigned int N = state.range(0);
+  const unsigned int T = 100;
+  const Eigen::MatrixXd samples = Eigen::MatrixXd::Random(T, N);
+  const std::vector<double> bands = {0.05, 0.5, 0.95};
+
+  MemoryCounters memory;
+  for (auto _ : state) {
+    Eigen::MatrixXd quantiles = utilfuns::rowQuantiles(samples, bands, state.range(1));
+    benchmark::DoNotOptimize(quantiles.data());
+  }
+  memory.report(state);
+  reportTimePer(state, "per_particle_step", static_cast<double>(N) * T);
+}
+BENCHMARK(BM_RowQuantiles)->ArgNames({"N", "threads"})->ArgsProduct({benchmark::CreateRange(1000, 100000, 10), {1, 4}})
+                          ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
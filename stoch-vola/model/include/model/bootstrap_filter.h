@@ -0,0 +1,117 @@
+#ifndef BOOTSTRAP_FILTER_H
+#define BOOTSTRAP_FILTER_H
+
+#include <random>
+
+#include <Eigen/Dense>
+
+#include "model/stochastic_volatility_model.h"
+#include "model/sv_models.h"
+#include "statistics/particles.h"
+#include "statistics/quasi_random.h"
+#include "statistics/random_engine.h"
+#include "statistics/resampling.h"
+#include "statistics/thread_pool.h"
+
+
+class FilterWorkspace;
+
+template <typename Scalar>
+struct FilterBuffers;
+struct BlockBuffers;
+
+//Model-independent pieces of the bootstrap filters
+namespace bootstrap {
+    //EigenRand seeds the lanes of an engine with seed, seed+1, ..., so consecutive seeds would share lanes
+    unsigned int stepSeed(const unsigned int& seed, const unsigned int& t);
+
+    //resamples and resets the weights to 1/N, over the particles sorted by state when stateOrdered
+    template <typename Scalar>
+    void resample(ParticlesT<Scalar>& particles, Eigen::Matrix<Scalar, Eigen::Dynamic, 1>& logWeights,
+                  Eigen::Matrix<Scalar, Eigen::Dynamic, 1>& weights, const ResamplingScheme& scheme,
+                  const bool& stateOrdered, const unsigned int& seed, ThreadPool* pool);
+    template <typename Scalar>
+    void resample(FilterBuffers<Scalar>& buffers, std::mt19937& generator, const ResamplingScheme& scheme,
+                  const bool& stateOrdered, const unsigned int& seed, ThreadPool* pool);
+
+    //serial resampling::ancestorIndices over the particles in ascending order of state, as indices into states
+    template <typename Scalar>
+    void stateOrderedAncestors(const Eigen::Ref<const Eigen::Matrix<Scalar, Eigen::Dynamic, 1>>& states,
+                               const Eigen::Ref<const Eigen::VectorXd>& weights, const ResamplingScheme& scheme,
+                               std::mt19937& generator, Eigen::Ref<Eigen::VectorXi> ancestors,
+                               Eigen::Ref<Eigen::VectorXd> uniforms, Eigen::Ref<Eigen::VectorXd> residuals,
+                               StateOrderBuffers& orderBuffers);
+}
+
+
+template <typename Model>
+class BootstrapFilter {
+  //Bootstrap particle filter of a model policy (sv_models.h): the fused packet kernels, thread pool split,
+  //random engines, resampling and precisions of StochasticVolatilityModel, compiled once per policy with
+  //the policy's transition and observation density inlined into the per-particle loops.
+  //StochasticVolatilityModel runs its bootstrap filters on BootstrapFilter<GaussianSV>; the auxiliary
+  //proposal, the smoother and the batch filters stay specific to it. Compiled for GaussianSV, StudentTSV
+  //and LeverageSV.
+  private:
+    Model model_;
+
+    template <typename Scalar>
+    using VectorT = Eigen::Matrix<Scalar, Eigen::Dynamic, 1>;
+
+    //step with Philox noise: the same bits on every thread count, as the element-wise work is split
+    //into packet-aligned chunks and the reductions run on the calling thread
+    template <typename Scalar>
+    bool counterBasedStep(VectorT<Scalar>& particles, VectorT<Scalar>& logWeights, VectorT<Scalar>& weights,
+                          VectorT<Scalar>& scratch, FilterStepStatistics& statistics,
+                          const typename Model::template Step<Scalar>& kernel,
+                          const unsigned int& seed, const unsigned int& t, BlockBuffers& blockBuffers, ThreadPool* pool) const;
+
+  public:
+    explicit BootstrapFilter(const Model& model);
+
+    const Model& getModel() const;
+
+    //propagates the particles in place and moves their normalised (log-)weights by the observation
+    //log-likelihoods of y with a log-sum-exp normaliser for step t of the filter started from seed, split
+    //into one block per pool thread. yPrevious is the observation of step t-1 (0 on the first step). Without
+    //a pool everything happens in the given vectors, with Mersenne Twister noise drawn from engine and
+    //the Sobol noise ordered in orderBuffers; over a pool blockBuffers, resized to its thread count, holds
+    //the engines and partial sums of the blocks.
+    //Returns false, leaving the weights untouched, when every particle has zero likelihood.
+    template <typename Scalar>
+    bool step(VectorT<Scalar>& particles, VectorT<Scalar>& logWeights, VectorT<Scalar>& weights,
+              VectorT<Scalar>& scratch, FilterStepStatistics& statistics, const double& yPrevious, const double& y,
+              const unsigned int& seed, const unsigned int& t, const RandomEngine& randomEngine,
+              ReseedableMersenneTwister& engine, StateOrderBuffers& orderBuffers, BlockBuffers& blockBuffers,
+              ThreadPool* pool) const;
+    //particleFilter with particles and weights held in Scalar
+    template <typename Scalar>
+    ParticlesT<Scalar> trajectories(const SeriesRef& y, const unsigned int& nParticles, const unsigned int& seed,
+                                    const FilterOptions& options) const;
+    //runs the filter without keeping trajectories, summing both per-step log-likelihood terms
+    template <typename Scalar>
+    void logLikelihoods(const SeriesRef& y, const unsigned int& nParticles, const unsigned int& seed,
+                        const FilterOptions& options, FilterWorkspace& workspace,
+                        double& logLikeSum, double& logEvidenceSum) const;
+
+    //as in StochasticVolatilityModel, for the Bootstrap proposal only (std::invalid_argument otherwise)
+    Particles particleFilter(const SeriesRef& y, const unsigned int& M, const unsigned int& seed = 123,
+                             const FilterOptions& options = FilterOptions()) const;
+    double logLikelihood(const SeriesRef& y, const unsigned int& M, const unsigned int& seed = 123,
+                         const FilterOptions& options = FilterOptions()) const;
+    double logLikelihood(const SeriesRef& y, const unsigned int& M, const unsigned int& seed,
+                         const FilterOptions& options, FilterWorkspace& workspace) const;
+    double logMarginalLikelihood(const SeriesRef& y, const unsigned int& M, const unsigned int& seed = 123,
+                                 const FilterOptions& options = FilterOptions()) const;
+    double logMarginalLikelihood(const SeriesRef& y, const unsigned int& M, const unsigned int& seed,
+                                 const FilterOptions& options, FilterWorkspace& workspace) const;
+};
+
+using StudentTStochasticVolatilityModel = BootstrapFilter<StudentTSV>;
+using LeverageStochasticVolatilityModel = BootstrapFilter<LeverageSV>;
+
+extern template class BootstrapFilter<GaussianSV>;
+extern template class BootstrapFilter<StudentTSV>;
+extern template class BootstrapFilter<LeverageSV>;
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef BOOTSTRAP_KERNELS_H
+#define BOOTSTRAP_KERNELS_H
+
+#include <Eigen/Dense>
+
+
+//Per-particle passes of the bootstrap step, one loop each over Eigen's packets (SSE / AVX / AVX-512 exp,
+//scalar loops without vectorisation) with the reductions kept in the packet lanes. Three passes replace the
+//dozen of the expression form: propagate and weigh, exponentiate, normalise. Compiled out of line for float
+//and double (and every model policy), so every step of every filter sees the same bits for the same ranges.
+namespace kernels {
+    struct WeighResult {
+      double weightedLogLikelihood = 0.0; //sum of w_i log p(y | x_i) over the particles with w_i > 0
+      double maxLogWeight = 0.0; //largest updated log-weight, -inf when every particle is impossible
+    };
+
+    struct ExponentiateResult {
+      double weightSum = 0.0;
+      double squaredWeightSum = 0.0;
+    };
+
+    //Moves the particles by x <- step.propagate(x, z) with the standard normals z of noise and writes the
+    //updated log-weights logWeights + step.logDensity(x) into out. step is the Step<Scalar> of a model
+    //policy (sv_models.h), instantiated for every policy there. noise and out may be the same vector.
+    template <typename Scalar, typename Step>
+    WeighResult propagateAndWeigh(Eigen::Ref<Eigen::Matrix<Scalar, Eigen::Dynamic, 1>> particles,
+                                  const Eigen::Ref<const Eigen::Matrix<Scalar, Eigen::Dynamic, 1>>& noise,
+                                  const Eigen::Ref<const Eigen::Matrix<Scalar, Eigen::Dynamic, 1>>& logWeights,
+                                  const Eigen::Ref<const Eigen::Matrix<Scalar, Eigen::Dynamic, 1>>& weights,
+                                  Eigen::Ref<Eigen::Matrix<Scalar, Eigen::Dynamic, 1>> out,
+                                  const Step& step);
+
+    //weights = exp(logWeights - maxLogWeight), returns their sum and sum of squares
+    template <typename Scalar>
+    ExponentiateResult exponentiate(const Eigen::Ref<const Eigen::Matrix<Scalar, Eigen::Dynamic, 1>>& logWeights,
+                                    Eigen::Ref<Eigen::Matrix<Scalar, Eigen::Dynamic, 1>> weights,
+                                    const double& maxLogWeight);
+
+    //weights /= weightSum and normalisedLogWeights = logWeights - logEvidence
+    template <typename Scalar>
+    void normalise(const Eigen::Ref<const Eigen::Matrix<Scalar, Eigen::Dynamic, 1>>& logWeights,
+                   Eigen::Ref<Eigen::Matrix<Scalar, Eigen::Dynamic, 1>> weights,
+                   Eigen::Ref<Eigen::Matrix<Scalar, Eigen::Dynamic, 1>> normalisedLogWeights,
+                   const double& weightSum, const double& logEvidence);
+}
+
+#endif
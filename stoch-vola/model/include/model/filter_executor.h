@@ -0,0 +1,55 @@
+#ifndef FILTER_EXECUTOR_H
+#define FILTER_EXECUTOR_H
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+
+#include <Eigen/Dense>
+
+#include "model/stochastic_volatility_model.h"
+#include "model/filter_workspace.h"
+
+
+class FilterExecutor {
+  //Queue of likelihood evaluations served by a fixed set of worker threads, for callers that want many
+  //independent filter runs in flight at once (e.g. a Python service, which waits on the futures without
+  //holding the GIL). Every worker owns a FilterWorkspace that it reuses from one task to the next.
+  //Each task runs its filter serially unless its options ask for more threads, so results equal a direct
+  //logLikelihood / logMarginalLikelihood call with the same arguments, whatever worker picks the task up.
+  //The destructor finishes the queued tasks before it joins the workers.
+  private:
+    std::vector<std::thread> workers_;
+    std::deque<std::packaged_task<double(FilterWorkspace&)>> tasks_;
+    mutable std::mutex mutex_;
+    std::condition_variable taskCondition_;
+    bool stopping_;
+
+    void workerLoop();
+    std::shared_future<double> enqueue(std::packaged_task<double(FilterWorkspace&)> task);
+
+  public:
+    explicit FilterExecutor(const unsigned int& threadCount);
+    ~FilterExecutor();
+
+    FilterExecutor(const FilterExecutor&) = delete;
+    FilterExecutor& operator=(const FilterExecutor&) = delete;
+
+    //y is copied into the task, parameters are the unconstrained (mu, phi, sigma) of StochasticVolatilityModel.
+    //Errors of the filter are rethrown by get() on the returned future.
+    std::shared_future<double> submitLogLikelihood(const SeriesRef& y, const Eigen::Vector3d& parameters,
+                                                   const unsigned int& M, const unsigned int& seed = 123,
+                                                   const FilterOptions& options = FilterOptions());
+    std::shared_future<double> submitLogMarginalLikelihood(const SeriesRef& y, const Eigen::Vector3d& parameters,
+                                                           const unsigned int& M, const unsigned int& seed = 123,
+                                                           const FilterOptions& options = FilterOptions());
+
+    unsigned int getThreadCount() const;
+    //tasks submitted but not yet picked up by a worker
+    unsigned int getQueuedCount() const;
+};
+
+#endif
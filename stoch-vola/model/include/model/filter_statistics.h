@@ -0,0 +1,72 @@
+#ifndef FILTER_STATISTICS_H
+#define FILTER_STATISTICS_H
+
+#include <vector>
+#include <chrono>
+
+//Instrumentation of particleFilter, logLikelihood and logMarginalLikelihood, compiled in with
+//SV_FILTER_INSTRUMENTATION (CMake option ENABLE_FILTER_INSTRUMENTATION) and out entirely otherwise.
+#ifdef SV_FILTER_INSTRUMENTATION
+#define SV_INSTRUMENT(...) __VA_ARGS__
+#else
+#define SV_INSTRUMENT(...)
+#endif
+
+
+struct FilterStatistics {
+  //Record of one filter run, attached through FilterOptions::statistics and reset when the run starts.
+  //Stage times are wall seconds summed over the steps. Where the noise is drawn inside the propagation
+  //(auxiliary proposal, Mersenne Twister over a pool) it counts to propagateSeconds; over a pool the
+  //stages are timed on the calling thread's block and the wait for the other blocks counts to normalise.
+  double noiseSeconds = 0.0; //random engine
+  double propagateSeconds = 0.0; //fused bootstrap move and log-densities, proposal move of the auxiliary filter
+  double weightSeconds = 0.0; //bootstrap exponentiation, first-stage and second-stage weights of the auxiliary filter
+  double normaliseSeconds = 0.0; //log-sum-exp normalisation and effective sample size
+  double resampleSeconds = 0.0;
+  double totalSeconds = 0.0; //the whole run, setup included
+  std::vector<double> effectiveSampleSizes; //after every step, NaN on degenerate steps
+  unsigned int stepCount = 0;
+  unsigned int resampleCount = 0;
+  unsigned int degenerateStepCount = 0; //steps on which every particle had zero likelihood
+  long allocationCount = 0; //malloc, calloc, realloc and operator new calls during the filter loop, glibc only;
+                            //in the Python module only those made by the module's own code
+
+  void reset();
+  //whether this build records anything at all
+  static bool isEnabled();
+};
+
+//seconds between consecutive lap() calls, the first one counting from construction
+class StageTimer {
+  private:
+    std::chrono::steady_clock::time_point last_;
+
+  public:
+    StageTimer();
+    double lap();
+};
+
+struct FilterStepStatistics;
+
+//Collects the FilterStatistics of one run into statistics (nothing when null), finished by the destructor
+class FilterRecorder {
+  private:
+    FilterStatistics* statistics_;
+    long allocationsAtStart_;
+    StageTimer total_;
+    StageTimer resampling_;
+
+  public:
+    FilterRecorder(FilterStatistics* statistics, const unsigned int& T);
+    ~FilterRecorder();
+
+    FilterRecorder(const FilterRecorder&) = delete;
+    FilterRecorder& operator=(const FilterRecorder&) = delete;
+
+    //adds the stage times of the step and clears them for the next one
+    void recordStep(FilterStepStatistics& step, const bool& updated);
+    void startResampling();
+    void finishResampling();
+};
+
+#endif
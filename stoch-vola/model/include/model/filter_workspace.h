@@ -0,0 +1,101 @@
+#ifndef FILTER_WORKSPACE_H
+#define FILTER_WORKSPACE_H
+
+#include <random>
+#include <memory>
+#include <vector>
+
+#include <Eigen/Dense>
+
+#include "model/bootstrap_kernels.h"
+#include "model/stochastic_volatility_model.h"
+#include "statistics/quasi_random.h"
+#include "statistics/random_engine.h"
+#include "statistics/resampling.h"
+#include "statistics/thread_pool.h"
+
+
+//per-particle state and scratch of one filter run in Scalar precision
+template <typename Scalar>
+struct FilterBuffers {
+  using Vector = Eigen::Matrix<Scalar, Eigen::Dynamic, 1>;
+
+  Vector particles;
+  Vector logWeights;
+  Vector weights;
+  Vector scratch;
+  Vector gathered; //resampled particles before they are swapped in
+  Eigen::VectorXd resamplingWeights; //double copy of the weights, Scalar = float only
+  Eigen::VectorXd uniforms;
+  Eigen::VectorXd residuals;
+  Eigen::VectorXi ancestors;
+  StateOrderBuffers orderBuffers;
+  PooledResamplingBuffers pooledResampling; //sized by the first resampling over a pool
+  //Gaussian proposal of the auxiliary step: prior means, expansion points, y^2 exp(-x*), precisions and shifts
+  Vector means;
+  Vector modes;
+  Vector scaled;
+  Vector precisions;
+  Vector shifts;
+
+  void resize(const unsigned int& nParticles);
+  //the weights as handed to the resampling schemes, copied into resamplingWeights for Scalar = float
+  const Eigen::VectorXd& doubleWeights();
+};
+
+//per-block random engines and partial sums of a step split over a thread pool, kept between steps so
+//that they are sized once; the engines are restarted with seed() on every step
+struct BlockBuffers {
+  std::vector<ReseedableMersenneTwister> engines;
+  std::vector<double> maxLogWeights;
+  std::vector<double> weightedLogLikelihoods;
+  std::vector<double> weightSums;
+  std::vector<double> squaredWeightSums;
+  std::vector<kernels::WeighResult> chunkWeighed; //per 1024-chunk sums of the Philox step
+  std::vector<kernels::ExponentiateResult> chunkSums;
+
+  void resize(const unsigned int& blocks);
+};
+
+
+class FilterWorkspace {
+  //Buffers and random engines of a bootstrap filter run, owned outside the filter so that repeated
+  //logLikelihood / logMarginalLikelihood calls (e.g. from an optimiser) reuse them. Buffers are only
+  //(re)allocated when the particle count or the precision changes, after that a serial bootstrap run
+  //does no heap allocation at all. The same holds over a thread pool, which the workspace keeps together with
+  //the per-block engines and sums until the thread count changes. Trajectories are never kept, so nothing
+  //depends on the series length. A workspace must not be shared by concurrent filter runs.
+  private:
+    FilterBuffers<double> doubleBuffers_;
+    FilterBuffers<float> singleBuffers_;
+    ReseedableMersenneTwister engine_;
+    std::mt19937 generator_;
+    std::unique_ptr<ThreadPool> pool_;
+    BlockBuffers blockBuffers_;
+
+    template <typename Scalar>
+    FilterBuffers<Scalar>& buffers();
+    //pool of threadCount threads, created on first use and kept while the count stays; null for one thread
+    ThreadPool* pool(const unsigned int& threadCount);
+
+    friend class StochasticVolatilityModel;
+    template <typename Model>
+    friend class BootstrapFilter;
+
+  public:
+    explicit FilterWorkspace(const unsigned int& nParticles = 0, const FilterPrecision& precision = FilterPrecision::Double);
+
+    //allocates the buffers for nParticles in the given precision up front
+    void reserve(const unsigned int& nParticles, const FilterPrecision& precision = FilterPrecision::Double);
+    unsigned int getParticleCount(const FilterPrecision& precision = FilterPrecision::Double) const;
+};
+
+template <>
+FilterBuffers<double>& FilterWorkspace::buffers<double>();
+template <>
+FilterBuffers<float>& FilterWorkspace::buffers<float>();
+
+extern template struct FilterBuffers<double>;
+extern template struct FilterBuffers<float>;
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef PMMH_SAMPLER_H
+#define PMMH_SAMPLER_H
+
+#include <vector>
+
+#include <Eigen/Dense>
+
+#include "model/stochastic_volatility_model.h"
+#include "model/filter_workspace.h"
+
+
+struct PMMHResult {
+  std::vector<Eigen::MatrixXd> chains; //one nIterations x 3 matrix of (mu, phi, sigma) per chain
+  Eigen::MatrixXd logMarginalLikelihoods; //nIterations x nChains, estimate for the current state of each chain
+  Eigen::VectorXd acceptanceRates; //one per chain
+};
+
+
+class PMMHSampler {
+  //Particle marginal Metropolis-Hastings (Andrieu, Doucet, Holenstein 2010) with Gaussian random-walk
+  //proposals on the unconstrained parameters (mu, phi, sigma) taken by StochasticVolatilityModel,
+  //independent normal priors on the same scale and logMarginalLikelihood as likelihood estimator.
+  //Every chain draws from its own generator, so results only depend on the seed, never on threadCount.
+  private:
+    Eigen::VectorXd y_;
+    unsigned int particleCount_;
+    Eigen::Vector3d proposalScales_;
+    Eigen::Vector3d priorStdDevs_;
+    FilterOptions options_;
+
+    double logPrior(const Eigen::Vector3d& parameters) const;
+    double logMarginalLikelihood(const Eigen::Vector3d& parameters, const unsigned int& seed, FilterWorkspace& workspace) const;
+    void runChain(const Eigen::Vector3d& initialParameters, const unsigned int& chain, const unsigned int& seed,
+                  PMMHResult& result) const;
+
+  public:
+    PMMHSampler(const SeriesRef& y, const unsigned int& nParticles, const Eigen::Vector3d& proposalScales,
+                const Eigen::Vector3d& priorStdDevs = Eigen::Vector3d::Constant(10.0),
+                const FilterOptions& options = FilterOptions());
+
+    PMMHResult sample(const Eigen::Vector3d& initialParameters, const unsigned int& nIterations,
+                      const unsigned int& nChains = 4, const unsigned int& seed = 123,
+                      const unsigned int& threadCount = 4) const;
+};
+
+#endif
@@ -3,11 +3,99 @@
 
 #include <vector>
 #include <cmath>
+#include <memory>
+#include <string>
+#include <random>
 
 #include <Eigen/Dense>
 
+#include "model/filter_statistics.h"
 #include "statistics/normal_distribution.h"
 #include "statistics/particles.h"
+#include "statistics/quasi_random.h"
+#include "statistics/random_engine.h"
+#include "statistics/resampling.h"
+#include "statistics/thread_pool.h"
+
+
+//Observations as the filters take them: any vector of doubles with a constant stride, so NumPy arrays,
+//slices of them included, reach the filters without a copy. batchFilter's panel may be strided either way.
+using SeriesRef = Eigen::Ref<const Eigen::VectorXd, 0, Eigen::InnerStride<>>;
+using PanelRef = Eigen::Ref<const Eigen::MatrixXd, 0, Eigen::Stride<Eigen::Dynamic, Eigen::Dynamic>>;
+
+//Bootstrap propagates from the AR(1) prior. Auxiliary (Pitt, Shephard 1999) looks ahead on y_t through a
+//second-order expansion of log N(y_t; 0, exp(x)) at the predicted mean: first-stage weights from the
+//resulting Gaussian integral, resampling on them when their effective sample size drops below
+//essThreshold * N, and the Gaussian posterior of the expansion as proposal.
+enum class FilterProposal {
+  Bootstrap,
+  Auxiliary
+};
+
+//Double or Single precision particles and weights in particleFilter, logLikelihood and logMarginalLikelihood.
+//Single halves the memory traffic and doubles the SIMD width of the per-particle work; the per-step
+//log-likelihood terms are still summed in double. Smoother, batch filters and SVFilterState run in double.
+enum class FilterPrecision {
+  Double,
+  Single
+};
+
+//Source of the propagation noise of the bootstrap step. MersenneTwister restarts the P8_mt19937_64 stream
+//of stepSeed(seed, t) on every step and, over a pool, gives every thread its own stream, so results depend
+//on the thread count. Philox addresses the counter-based stream (seed, t) directly at each particle's
+//index, and then the filters return the same bits for any thread count (resampling stays on the calling thread).
+//Sobol is sequential quasi-Monte Carlo: the scrambled Sobol points of (seed, t) are handed to the particles in
+//order of state and resampling runs over the particles sorted by state, which lowers the variance of the
+//likelihood estimates for a given N. Its steps and resampling always run on the calling thread.
+enum class RandomEngine {
+  MersenneTwister,
+  Philox,
+  Sobol
+};
+
+struct FilterOptions {
+  FilterProposal proposal = FilterProposal::Bootstrap; //used by particleFilter, logLikelihood and logMarginalLikelihood
+  ResamplingScheme resamplingScheme = ResamplingScheme::Systematic;
+  unsigned int threadCount = 1; //results are deterministic for a given seed and thread count
+  double essThreshold = 0.5; //resample once the effective sample size drops below essThreshold * N, > 1 resamples every step
+  ParticleLayout particleLayout = ParticleLayout::TimeMajor; //storage of the trajectories in particleFilter
+  FilterPrecision precision = FilterPrecision::Double;
+  RandomEngine randomEngine = RandomEngine::MersenneTwister; //bootstrap steps only, the auxiliary proposal and the batch filters keep their own streams
+  //filled by particleFilter, logLikelihood and logMarginalLikelihood in instrumented builds, one per concurrent run
+  std::shared_ptr<FilterStatistics> statistics;
+  //trajectory file particleFilter keeps its particles and genealogy in (mapped_file.h) instead of memory, overwritten
+  //if it exists; Single precision results of particleFilter are still converted to double in memory
+  std::string storageFile;
+};
+
+struct FilterStepStatistics {
+  double weightedLogLikelihood = 0.0; //mean observation log-likelihood under the previous weights
+  double logEvidence = 0.0; //log of the unbiased estimate of p(y_t | y_1, ..., y_t-1)
+  double effectiveSampleSize = 0.0;
+  //stage times of the step and whether it resampled (auxiliary step), only set in instrumented builds
+  double noiseSeconds = 0.0;
+  double propagateSeconds = 0.0;
+  double weightSeconds = 0.0;
+  double normaliseSeconds = 0.0;
+  double resampleSeconds = 0.0;
+  bool resampled = false;
+};
+
+struct BatchFilterResult {
+  Eigen::VectorXd logLikelihoods; //as logLikelihood, averaged over the observed steps of every asset
+  Eigen::VectorXd logMarginalLikelihoods; //as logMarginalLikelihood
+  Eigen::VectorXi observationCounts;
+  Eigen::MatrixXd filteredMeans; //assets x time, weighted mean of the log-variance x_t given y up to t
+  Eigen::MatrixXd filteredStdDevs; //assets x time
+};
+
+class FilterWorkspace;
+
+template <typename Scalar>
+struct FilterBuffers;
+struct BlockBuffers;
+
+struct GaussianSV;
 
 
 class StochasticVolatilityModel {
@@ -20,10 +108,91 @@ class StochasticVolatilityModel {
     double phi_;
     double sigma_;
 
+    template <typename Scalar>
+    using VectorT = Eigen::Matrix<Scalar, Eigen::Dynamic, 1>;
+
+    //the model as the policy of BootstrapFilter, which runs its bootstrap filters
+    GaussianSV policy() const;
+    //BootstrapFilter<GaussianSV>::step, see bootstrap_filter.h
+    template <typename Scalar>
+    bool filterStep(VectorT<Scalar>& particles, VectorT<Scalar>& logWeights, VectorT<Scalar>& weights,
+                    VectorT<Scalar>& scratch, FilterStepStatistics& statistics, const double& y,
+                    const unsigned int& seed, const unsigned int& t, const RandomEngine& randomEngine,
+                    ReseedableMersenneTwister& engine, StateOrderBuffers& orderBuffers, BlockBuffers& blockBuffers,
+                    ThreadPool* pool) const;
+    //auxiliary particle filter step on the cloud in buffers: resamples it by the first-stage weights when
+    //their effective sample size is low, then propagates it in place and updates the weights. The noise is
+    //drawn as in the bootstrap step, from engine or over a pool from the engines of blockBuffers.
+    //Returns true when it resampled, buffers.ancestors then holds the ancestor of every new particle.
+    template <typename Scalar>
+    bool auxiliaryStep(FilterBuffers<Scalar>& buffers, FilterStepStatistics& statistics, const double& y,
+                       const ResamplingScheme& scheme, const double& essThreshold, const unsigned int& seed,
+                       ReseedableMersenneTwister& engine, std::mt19937& generator, BlockBuffers& blockBuffers,
+                       ThreadPool* pool) const;
+    //particleFilter with particles and weights held in Scalar
+    template <typename Scalar>
+    ParticlesT<Scalar> filterTrajectories(const SeriesRef& y, const unsigned int& nParticles, const unsigned int& seed,
+                                          const FilterOptions& options) const;
+    //runs the filter without keeping trajectories, summing both per-step log-likelihood terms
+    template <typename Scalar>
+    void filterLogLikelihoods(const SeriesRef& y, const unsigned int& nParticles, const unsigned int& seed,
+                              const FilterOptions& options, FilterWorkspace& workspace,
+                              double& logLikeSum, double& logEvidenceSum) const;
+    static unsigned int stepSeed(const unsigned int& seed, const unsigned int& t);
+    template <typename Scalar>
+    static double weightedSum(const Eigen::Ref<const VectorT<Scalar>>& weights,
+                              const Eigen::Ref<const VectorT<Scalar>>& values);
+
+    friend class SVFilterState;
+
   public:
     StochasticVolatilityModel(double mu, double phi, double sigma);
-    Particles particleFilter(const Eigen::VectorXd& y, const unsigned int& M, const unsigned int& seed = 123);
-    double logLikelihood(const Eigen::VectorXd& y, const unsigned int& M, const unsigned int& seed = 123);
+
+    //Every filter below is const and keeps its random engines and buffers local to the call, so one model
+    //can be filtered from several threads at once (a FilterWorkspace still belongs to one call at a time).
+
+    //building blocks of one bootstrap filter step, shared with SVFilterState
+    IndependentVectorNormal initialDistribution(const unsigned int& nParticles) const;
+    Eigen::VectorXd propagate(const Eigen::Ref<const Eigen::VectorXd>& particles, const unsigned int& seed) const;
+    Eigen::VectorXd observationLogLikelihoods(const Eigen::Ref<const Eigen::VectorXd>& particles, const double& y) const;
+
+    Particles particleFilter(const SeriesRef& y, const unsigned int& M, const unsigned int& seed = 123,
+                             const FilterOptions& options = FilterOptions()) const;
+    //particleFilter in single precision whatever options.precision, the trajectories kept as float
+    ParticlesT<float> particleFilterSingle(const SeriesRef& y, const unsigned int& M, const unsigned int& seed = 123,
+                                           const FilterOptions& options = FilterOptions()) const;
+    double logLikelihood(const SeriesRef& y, const unsigned int& M, const unsigned int& seed = 123,
+                         const FilterOptions& options = FilterOptions()) const;
+    //as above, reusing the buffers of workspace (see FilterWorkspace)
+    double logLikelihood(const SeriesRef& y, const unsigned int& M, const unsigned int& seed,
+                         const FilterOptions& options, FilterWorkspace& workspace) const;
+    //forward filtering backward simulation (FFBSi): nTrajectories paths drawn from the joint smoothing
+    //distribution, each backward index found by rejection sampling against the AR(1) transition density
+    //(exact O(N) backward weights only after repeated rejections). The forward filter and the
+    //backward paths both run over options.threadCount threads.
+    Particles particleSmoother(const SeriesRef& y, const unsigned int& M, const unsigned int& nTrajectories,
+                               const unsigned int& seed = 123, const FilterOptions& options = FilterOptions()) const;
+    //log of the particle filter's unbiased estimate of p(y), the likelihood estimator behind PMMH
+    double logMarginalLikelihood(const SeriesRef& y, const unsigned int& M, const unsigned int& seed = 123,
+                                 const FilterOptions& options = FilterOptions()) const;
+    double logMarginalLikelihood(const SeriesRef& y, const unsigned int& M, const unsigned int& seed,
+                                 const FilterOptions& options, FilterWorkspace& workspace) const;
+
+    //bootstrap filters (whatever options.proposal) for a universe of assets: y holds one series per row
+    //(assets x time, NaN marks a missing observation, so shorter series are padded with NaN) and parameters
+    //one (mu, phi, sigma) row per asset. Assets are filtered as particles x assets arrays, split over
+    //options.threadCount threads. Asset a uses seed ThreadPool::blockSeed(seed, a), so a fully observed
+    //asset matches logLikelihood and logMarginalLikelihood and nothing depends on the thread count.
+    static BatchFilterResult batchFilter(const Eigen::MatrixXd& parameters, const PanelRef& y,
+                                         const unsigned int& M, const unsigned int& seed = 123,
+                                         const FilterOptions& options = FilterOptions());
+    //logLikelihood for K parameter rows (mu, phi, sigma) in one pass over y. All K filters share
+    //their random numbers, so entry k equals logLikelihood of the model with parameters k. Only the default
+    //double precision Mersenne Twister bootstrap filter is batched, other options.precision, options.proposal
+    //or options.randomEngine throw std::invalid_argument.
+    static Eigen::VectorXd batchLogLikelihood(const Eigen::MatrixXd& parameters, const SeriesRef& y,
+                                              const unsigned int& M, const unsigned int& seed = 123,
+                                              const FilterOptions& options = FilterOptions());
 };
 
 #endif
@@ -0,0 +1,90 @@
+#ifndef SV_FILTER_STATE_H
+#define SV_FILTER_STATE_H
+
+#include <random>
+#include <vector>
+#include <string>
+#include <cstdint>
+
+#include <Eigen/Dense>
+
+#include "model/filter_workspace.h"
+#include "model/stochastic_volatility_model.h"
+#include "statistics/random_engine.h"
+
+
+//Checkpoint file of SVFilterState: this 88-byte header in native byte order, then the particles, the
+//log-weights and the weights as particleCount doubles each. The random streams of step t are keyed by
+//(seed, t), so seed and stepCount restore them exactly.
+struct FilterCheckpointHeader {
+  char magic[8]; //"SVCKPT" and two zero bytes
+  std::uint32_t version;
+  std::uint32_t particleCount;
+  double mu;
+  double phi;
+  double sigma;
+  std::uint32_t seed;
+  std::uint32_t stepCount;
+  double logLikeSum;
+  double effectiveSampleSize;
+  double essThreshold;
+  std::uint32_t resamplingScheme; //ResamplingScheme in declaration order
+  std::uint32_t randomEngine; //RandomEngine in declaration order
+  std::uint32_t equallyWeighted;
+  std::uint32_t reserved;
+};
+
+static_assert(sizeof(FilterCheckpointHeader) == 88, "checkpoint header must stay 88 bytes");
+
+
+class SVFilterState {
+  //Online bootstrap filter: keeps only the latest particle cloud, so memory stays O(N)
+  //however many observations are pushed. Fed with the same series and seed it reproduces
+  //StochasticVolatilityModel::logLikelihood. All buffers are allocated in the constructor, step() allocates nothing.
+  private:
+    StochasticVolatilityModel model_;
+    unsigned int particleCount_;
+    unsigned int seed_;
+    FilterOptions options_;
+    Eigen::VectorXd particles_;
+    Eigen::VectorXd logWeights_;
+    Eigen::VectorXd weights_;
+    Eigen::VectorXd scratch_;
+    Eigen::VectorXd buffer_;
+    Eigen::VectorXi ancestors_;
+    Eigen::VectorXd uniforms_;
+    Eigen::VectorXd residuals_;
+    StateOrderBuffers orderBuffers_;
+    BlockBuffers blockBuffers_; //stays empty, the state steps without a pool
+    unsigned int stepCount_;
+    double logLikeSum_;
+    double effectiveSampleSize_;
+    bool equallyWeighted_;
+    std::mt19937 generator_;
+    ReseedableMersenneTwister engine_;
+
+  public:
+    SVFilterState(const StochasticVolatilityModel& model, const unsigned int& nParticles,
+                  const unsigned int& seed = 123, const FilterOptions& options = FilterOptions());
+
+    void step(const double& y);
+
+    double getLogLikelihood() const; //normalised as in StochasticVolatilityModel::logLikelihood
+    double getFilteredMean() const;
+    double getFilteredQuantile(const double& q) const;
+    //interpolated as utilfuns::quantile while equally weighted, the weighted quantiles otherwise
+    Eigen::VectorXd getFilteredQuantiles(const std::vector<double>& probabilities) const;
+    double getEffectiveSampleSize() const;
+    Eigen::VectorXd getParticles() const;
+    Eigen::VectorXd getWeights() const;
+
+    unsigned int getParticleCount() const;
+    unsigned int getStepCount() const;
+
+    //Checkpoint written and read through one mapping each; a loaded state steps on with the same bits as
+    //the saved one would have. Options other than the resampling scheme, threshold and engine are not kept.
+    void save(const std::string& path) const;
+    static SVFilterState load(const std::string& path);
+};
+
+#endif
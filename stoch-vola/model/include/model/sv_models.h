@@ -0,0 +1,196 @@
+#ifndef SV_MODELS_H
+#define SV_MODELS_H
+
+#include <cmath>
+#include <stdexcept>
+
+#include <Eigen/Dense>
+
+
+//Model policies of BootstrapFilter (bootstrap_filter.h). All of them share the latent AR(1) log-variance
+//x_t = mu + phi (x_t-1 - mu) + sigma eta_t of StochasticVolatilityModel, started from N(mu, sigma^2), and
+//differ in the transition noise or the observation density. A policy holds the natural parameters, maps
+//unconstrained ones onto them (fromUnconstrained) and hands out the kernel of one step, Step<Scalar>, with
+//  P propagate(const P& x, const P& z) const   x_t from x_t-1 and a standard normal z
+//  P logDensity(const P& x) const              log p(y_t | x_t)
+//templated on P, an Eigen packet or Scalar itself, so one definition is inlined into both the vectorised
+//loops of the bootstrap kernels and their scalar tails.
+
+//y_t = exp(x_t / 2) eps_t with standard normal eps_t, StochasticVolatilityModel itself
+struct GaussianSV {
+  static constexpr int parameterCount = 3;
+
+  double mu;
+  double phi; //in [-1, 1]
+  double sigma; //>= 0
+
+  GaussianSV(const double& mu, const double& phi, const double& sigma) : mu(mu), phi(phi), sigma(sigma) {
+    if (!(std::abs(phi) <= 1.0) || !(sigma >= 0.0)) {
+      throw std::invalid_argument("GaussianSV needs |phi| <= 1 and sigma >= 0.");
+    }
+  }
+
+  //(mu, atanh phi, log sigma), the parametrisation of StochasticVolatilityModel
+  static GaussianSV fromUnconstrained(const Eigen::Ref<const Eigen::VectorXd>& theta) {
+    if (theta.size() != parameterCount) {
+      throw std::invalid_argument("GaussianSV takes 3 unconstrained parameters.");
+    }
+    return GaussianSV(theta[0], std::tanh(theta[1]), std::exp(theta[2]));
+  }
+
+  double initialMean() const {
+    return mu;
+  }
+
+  double initialStdDev() const {
+    return sigma;
+  }
+
+  template <typename Scalar>
+  struct Step {
+    Scalar mu, phi, sigma, ySquared, logTwoPi;
+
+    template <typename P>
+    P propagate(const P& x, const P& z) const {
+      using namespace Eigen::internal;
+      const P m = pset1<P>(mu);
+      return padd(padd(m, pmul(pset1<P>(phi), psub(x, m))), pmul(z, pset1<P>(sigma)));
+    }
+
+    //log N(y; 0, exp(x)) taken directly as -(log(2 pi) + x + y^2 exp(-x)) / 2
+    template <typename P>
+    P logDensity(const P& x) const {
+      using namespace Eigen::internal;
+      return pmul(pset1<P>(Scalar(-0.5)), padd(padd(pset1<P>(logTwoPi), x), pmul(pset1<P>(ySquared), pexp(pnegate(x)))));
+    }
+  };
+
+  template <typename Scalar>
+  Step<Scalar> step(const double& /*yPrevious*/, const double& y) const {
+    return Step<Scalar>{static_cast<Scalar>(mu), static_cast<Scalar>(phi), static_cast<Scalar>(sigma),
+                        static_cast<Scalar>(y * y), static_cast<Scalar>(std::log(2 * M_PI))};
+  }
+};
+
+
+//y_t = exp(x_t / 2) eps_t with Student-t eps_t of nu degrees of freedom, for the heavier tails of daily returns
+struct StudentTSV {
+  static constexpr int parameterCount = 4;
+
+  double mu;
+  double phi;
+  double sigma;
+  double nu; //> 0
+
+  StudentTSV(const double& mu, const double& phi, const double& sigma, const double& nu) : mu(mu), phi(phi), sigma(sigma), nu(nu) {
+    if (!(std::abs(phi) <= 1.0) || !(sigma >= 0.0) || !(nu > 0.0)) {
+      throw std::invalid_argument("StudentTSV needs |phi| <= 1, sigma >= 0 and nu > 0.");
+    }
+  }
+
+  //(mu, atanh phi, log sigma, log(nu - 2)), which keeps the variance of eps_t finite
+  static StudentTSV fromUnconstrained(const Eigen::Ref<const Eigen::VectorXd>& theta) {
+    if (theta.size() != parameterCount) {
+      throw std::invalid_argument("StudentTSV takes 4 unconstrained parameters.");
+    }
+    return StudentTSV(theta[0], std::tanh(theta[1]), std::exp(theta[2]), 2.0 + std::exp(theta[3]));
+  }
+
+  double initialMean() const {
+    return mu;
+  }
+
+  double initialStdDev() const {
+    return sigma;
+  }
+
+  template <typename Scalar>
+  struct Step {
+    GaussianSV::Step<Scalar> transition; //its logDensity is not used
+    Scalar logNormaliser, yScaled, exponent;
+
+    template <typename P>
+    P propagate(const P& x, const P& z) const {
+      return transition.propagate(x, z);
+    }
+
+    //log Gamma((nu+1)/2) - log Gamma(nu/2) - log(nu pi) / 2 - x / 2 - (nu+1)/2 log(1 + y^2 exp(-x) / nu)
+    template <typename P>
+    P logDensity(const P& x) const {
+      using namespace Eigen::internal;
+      const P tail = plog(padd(pset1<P>(Scalar(1)), pmul(pset1<P>(yScaled), pexp(pnegate(x)))));
+      return psub(psub(pset1<P>(logNormaliser), pmul(pset1<P>(Scalar(0.5)), x)), pmul(pset1<P>(exponent), tail));
+    }
+  };
+
+  template <typename Scalar>
+  Step<Scalar> step(const double& yPrevious, const double& y) const {
+    const double logNormaliser = std::lgamma(0.5 * (nu + 1.0)) - std::lgamma(0.5 * nu) - 0.5 * std::log(nu * M_PI);
+    return Step<Scalar>{GaussianSV(mu, phi, sigma).step<Scalar>(yPrevious, y), static_cast<Scalar>(logNormaliser),
+                        static_cast<Scalar>(y * y / nu), static_cast<Scalar>(0.5 * (nu + 1.0))};
+  }
+};
+
+
+//Gaussian observations whose shocks move the next log-variance, corr(eps_t, eta_t+1) = rho (rho < 0 for the
+//leverage effect of equities): x_t = mu + phi (x_t-1 - mu) + sigma (rho eps_t-1 + sqrt(1 - rho^2) z_t) with
+//eps_t-1 = y_t-1 exp(-x_t-1 / 2). The first step has no previous observation and takes eps_0 = 0.
+struct LeverageSV {
+  static constexpr int parameterCount = 4;
+
+  double mu;
+  double phi;
+  double sigma;
+  double rho; //in [-1, 1]
+
+  LeverageSV(const double& mu, const double& phi, const double& sigma, const double& rho) : mu(mu), phi(phi), sigma(sigma), rho(rho) {
+    if (!(std::abs(phi) <= 1.0) || !(sigma >= 0.0) || !(std::abs(rho) <= 1.0)) {
+      throw std::invalid_argument("LeverageSV needs |phi| <= 1, sigma >= 0 and |rho| <= 1.");
+    }
+  }
+
+  //(mu, atanh phi, log sigma, atanh rho)
+  static LeverageSV fromUnconstrained(const Eigen::Ref<const Eigen::VectorXd>& theta) {
+    if (theta.size() != parameterCount) {
+      throw std::invalid_argument("LeverageSV takes 4 unconstrained parameters.");
+    }
+    return LeverageSV(theta[0], std::tanh(theta[1]), std::exp(theta[2]), std::tanh(theta[3]));
+  }
+
+  double initialMean() const {
+    return mu;
+  }
+
+  double initialStdDev() const {
+    return sigma;
+  }
+
+  template <typename Scalar>
+  struct Step {
+    GaussianSV::Step<Scalar> observation; //AR(1) part with the scaled down noise, observation density
+    Scalar leverage; //sigma rho y_t-1, 0 skips the term (and exp(-x/2) overflowing into 0 * inf)
+
+    template <typename P>
+    P propagate(const P& x, const P& z) const {
+      using namespace Eigen::internal;
+      const P autoregressive = observation.propagate(x, z);
+      if (leverage == Scalar(0)) {
+        return autoregressive;
+      }
+      return padd(autoregressive, pmul(pset1<P>(leverage), pexp(pmul(pset1<P>(Scalar(-0.5)), x))));
+    }
+
+    template <typename P>
+    P logDensity(const P& x) const {
+      return observation.logDensity(x);
+    }
+  };
+
+  template <typename Scalar>
+  Step<Scalar> step(const double& yPrevious, const double& y) const {
+    const GaussianSV autoregressive(mu, phi, sigma * std::sqrt(1.0 - rho * rho));
+    return Step<Scalar>{autoregressive.step<Scalar>(yPrevious, y), static_cast<Scalar>(sigma * rho * yPrevious)};
+  }
+};
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef ALLOCATION_COUNTER_H
+#define ALLOCATION_COUNTER_H
+
+
+//Process-wide count of heap allocations. Every allocation, Eigen's and EigenRand's included, ends in
+//malloc, calloc, realloc or operator new; on glibc allocation_counter.cpp replaces all of them to count
+//the calls and requested bytes while counting is switched on. Only targets that measure allocations
+//compile it in, elsewhere the C library's allocator stays untouched.
+namespace allocationcounter {
+    //switches counting on and off for the whole process; calls nest, so counting stays on
+    //until every enable() has been matched by a disable()
+    void enable();
+    void disable();
+
+    //calls and requested bytes counted so far, callers take differences; always 0 off glibc
+    long count();
+    long bytes();
+}
+
+#endif
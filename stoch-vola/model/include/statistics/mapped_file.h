@@ -0,0 +1,91 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+#include <Eigen/Dense>
+
+
+enum class MappingMode {
+  Create, //creates or truncates the file to the requested size
+  ReadWrite,
+  ReadOnly
+};
+
+class MappedFile {
+  //Shared mapping of a whole file (POSIX mmap), unmapped and closed by the destructor. Writes reach
+  //the page cache straight away and the file once the kernel flushes them, so mappings far larger
+  //than the RAM only keep the recently touched pages resident.
+  private:
+    std::string path_;
+    int descriptor_;
+    void* data_;
+    std::size_t size_;
+    MappingMode mode_;
+
+  public:
+    MappedFile(const std::string& path, const MappingMode& mode, const std::size_t& size = 0);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    void* data();
+    const void* data() const;
+    std::size_t size() const;
+    const std::string& getPath() const;
+    MappingMode getMode() const;
+};
+
+
+//Trajectory file of ParticlesT: this 64-byte header in native byte order, then the stored particles as a
+//column-major particleCount x particleLength (TimeMajor) or particleLength x particleCount (TraceMajor)
+//matrix of scalarSize-byte floats at dataOffset, then for Genealogy storage the int32 parent indices
+//laid out the same way at parentsOffset. The particles read as a NumPy memmap of shape
+//(particleLength, particleCount) with offset=dataOffset, in C order for TimeMajor, Fortran order for TraceMajor.
+struct TrajectoryFileHeader {
+  char magic[8]; //"SVTRAJ" and two zero bytes
+  std::uint32_t version;
+  std::uint32_t scalarSize; //4 float, 8 double
+  std::uint32_t layout; //0 TraceMajor, 1 TimeMajor
+  std::uint32_t pathStorage; //0 Copy, 1 Genealogy (rows are not yet traced back into trajectories)
+  std::uint64_t particleCount;
+  std::uint64_t particleLength;
+  std::uint64_t currentRow; //latest appended time step, the initial particles being row 0
+  std::uint64_t dataOffset;
+  std::uint64_t parentsOffset;
+};
+
+static_assert(sizeof(TrajectoryFileHeader) == 64, "trajectory file header must stay 64 bytes");
+
+namespace trajectoryfile {
+    constexpr std::uint32_t version = 1;
+
+    TrajectoryFileHeader makeHeader(const std::uint32_t& scalarSize, const std::uint32_t& layout,
+                                    const std::uint64_t& particleCount, const std::uint64_t& particleLength);
+    //bytes of a file holding the particles and the parent indices
+    std::size_t fileSize(const TrajectoryFileHeader& header);
+    //throws std::invalid_argument unless header is a trajectory header of this version that fits in fileSize bytes
+    void validateHeader(const TrajectoryFileHeader& header, const std::size_t& fileSize);
+    TrajectoryFileHeader readHeader(const std::string& path);
+    TrajectoryFileHeader readHeader(const MappedFile& file);
+}
+
+
+class MappedSeries {
+  //Return series stored as raw doubles in native byte order (as written by numpy.ndarray.tofile),
+  //from offset bytes on, mapped read-only and handed to the filters without a copy.
+  private:
+    MappedFile file_;
+    Eigen::Map<const Eigen::VectorXd> series_;
+
+  public:
+    explicit MappedSeries(const std::string& path, const std::size_t& offset = 0);
+
+    const Eigen::Map<const Eigen::VectorXd>& getSeries() const;
+    Eigen::Index size() const;
+};
+
+#endif
@@ -4,48 +4,241 @@
 #include <random>
 #include <vector>
 #include <cmath>
+#include <string>
+#include <memory>
+#include <algorithm>
 #include <functional>
 
 #include <Eigen/Dense>
 
 #include "normal_distribution.h"
+#include "resampling.h"
+#include "mapped_file.h"
+#include "thread_pool.h"
+
+//Copy moves whole trajectories on every resample, Genealogy only reorders the latest
+//row and records ancestor indices, reconstructing the trajectories on demand
+enum class PathStorage {
+  Copy,
+  Genealogy
+};
+
+//TraceMajor stores time x particles column-major, so every trajectory is contiguous.
+//TimeMajor stores the transpose, so the particle cloud of every time step is contiguous,
+//which is what the per-step appendParticles/getLatestParticles/resampling path touches.
+enum class ParticleLayout {
+  TraceMajor,
+  TimeMajor
+};
+
+//Scalar is double or float (explicitly instantiated in particles.cpp); weights stay double.
+template <typename Scalar>
+class ParticlesT {
+  public:
+    using Vector = Eigen::Matrix<Scalar, Eigen::Dynamic, 1>;
+    using RowVector = Eigen::Matrix<Scalar, 1, Eigen::Dynamic>;
+    using Matrix = Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic>;
 
-class Particles {
   private:
-    Eigen::MatrixXd particles_;
-    unsigned int particleCount_;
-    unsigned int particleLength_;
-    unsigned int currentRow_;
-    mutable std::mt19937 generator_;
-    void setSeed(const unsigned int& seed) const;
+    //The stored particles live in memory_ and parentMemory_, or in a trajectory file (mapped_file.h) when a
+    //storage file is given; particles_ and parents_ view whichever holds them.
+    Matrix memory_;
+    Eigen::MatrixXi parentMemory_;
+    std::unique_ptr<MappedFile> file_;
+    Eigen::Map<Matrix> particles_{nullptr, 0, 0}; //time x particles for TraceMajor, particles x time for TimeMajor
+    Eigen::Map<Eigen::MatrixXi> parents_{nullptr, 0, 0}; //Genealogy only: parent of particle j at time t in t-1, laid out as particles_
+    unsigned int particleCount_ = 0;
+    unsigned int particleLength_ = 0;
+    unsigned int currentRow_ = 0;
+    ParticleLayout layout_ = ParticleLayout::TraceMajor;
+    PathStorage pathStorage_ = PathStorage::Copy;
+    void allocateParticles(const Eigen::Ref<const Vector>& initialParticles, const std::string& storageFile); //zeros after the first time step
+    void storeParticles(const Matrix& particles); //particles given as time x particles
+    Matrix tracedParticles() const; //always time x particles
+    void traceInPlace(); //Genealogy rows rewritten as the trajectories, one time step at a time
+    void bindStorage(); //points particles_ and parents_ at the current storage
+    void copyStorage(const ParticlesT& other); //into memory, whatever holds other's particles
+    void writeHeader(); //file storage only
+    TrajectoryFileHeader* header();
+    void readHeader(const TrajectoryFileHeader& header); //sizes and storage modes
+    //trajectory file at path holding a copy of the particles, with room for a genealogy unless compact
+    std::unique_ptr<MappedFile> writeFile(const std::string& path, const bool& compact) const;
+    ParticlesT() = default; //empty, for openStorageFile
+    //the particles with whole trajectories in their rows or columns: the storage itself with PathStorage::Copy,
+    //traced into buffer otherwise; timeMajor tells whether time runs along the columns
+    Eigen::Map<const Matrix> tracedView(Matrix& buffer, bool& timeMajor) const;
+    //block(begin, end) over [0, n) in contiguous blocks, one per thread of a ThreadPool once the elementCount
+    //elements give every thread at least minParallelElements
+    template <typename F>
+    static void forEachBlock(const long& n, const long& elementCount, const unsigned int& threadCount, const F& block);
 
   public:
-    Particles(const std::vector<double>& initialParticles, const unsigned int& particleLength = 1);
-    Particles(const Eigen::VectorXd& initialParticles, const unsigned int& particleLength = 1);
-    Particles(const Eigen::MatrixXd& initialParticles, const unsigned int& particleLength = 1);
-    Particles(const std::vector<std::vector<double>>& initialParticles, const unsigned int& particleLength = 1);
-    Particles(const NormalDistribution& dist, const unsigned int& nParticles,
-              const unsigned int& particleLength = 1,
-              const unsigned int& seed = 123);
-
-    Particles(const IndependentVectorNormal& dist,
+    //A non-empty storageFile keeps the stored particles in a trajectory file created (or overwritten) there.
+    ParticlesT(const std::vector<Scalar>& initialParticles, const unsigned int& particleLength = 1,
+               const ParticleLayout& layout = ParticleLayout::TraceMajor, const std::string& storageFile = "");
+    ParticlesT(const Vector& initialParticles, const unsigned int& particleLength = 1,
+               const ParticleLayout& layout = ParticleLayout::TraceMajor, const std::string& storageFile = "");
+    ParticlesT(const Matrix& initialParticles, const unsigned int& particleLength = 1,
+               const ParticleLayout& layout = ParticleLayout::TraceMajor);
+    ParticlesT(const std::vector<std::vector<Scalar>>& initialParticles, const unsigned int& particleLength = 1,
+               const ParticleLayout& layout = ParticleLayout::TraceMajor);
+    ParticlesT(const NormalDistribution& dist, const unsigned int& nParticles,
+               const unsigned int& particleLength = 1,
+               const unsigned int& seed = 123,
+               const ParticleLayout& layout = ParticleLayout::TraceMajor,
+               const std::string& storageFile = "");
+
+    ParticlesT(const IndependentVectorNormalT<Scalar>& dist,
             const unsigned int& particleLength = 1,
-            const unsigned int& seed = 123);
+            const unsigned int& seed = 123,
+            const ParticleLayout& layout = ParticleLayout::TraceMajor,
+            const std::string& storageFile = "");
+
+    //copies hold their particles in memory, moves keep the storage file
+    ParticlesT(const ParticlesT& other);
+    ParticlesT(ParticlesT&& other);
+    ParticlesT& operator=(const ParticlesT& other);
+    ParticlesT& operator=(ParticlesT&& other);
 
+    //reopens the trajectory file at path, read-write, with the particles and genealogy as last stored
+    static ParticlesT openStorageFile(const std::string& path);
+    //Snapshot in the trajectory file format (without the unused genealogy room), written and read back in
+    //memory through one mapping each; load restores every bit of the saved state.
+    void save(const std::string& path) const;
+    static ParticlesT load(const std::string& path);
 
-    void appendParticles(const Eigen::VectorXd& newParticles);
+
+    void appendParticles(const Vector& newParticles);
     void resampleParticles(const std::vector<double>& weights, const unsigned int& seed = 123);
-    void applyTransformation(const std::function<double(double)>& func);
-    Eigen::VectorXd getLatestParticles() const;
-    Eigen::VectorXd reduceParticles(const std::function<double(const Eigen::VectorXd&)>& func) const; //reduce over particles
-    Eigen::VectorXd reduceTraces(const std::function<double(const Eigen::VectorXd&)>& func) const; //reduce over all elements of a particle
-    Eigen::MatrixXd getParticlesAsEigenMatrix() const;
-    Particles getParticlesWithoutInit() const;
+    void resampleParticles(const Eigen::Ref<const Eigen::VectorXd>& weights,
+                           const ResamplingScheme& scheme,
+                           const unsigned int& seed = 123);
+    void applyAncestors(const Eigen::VectorXi& ancestors); //resample with precomputed ancestor indices
+    void applyTransformation(const std::function<Scalar(Scalar)>& func);
+    Vector getLatestParticles() const;
+    Vector reduceParticles(const std::function<Scalar(const Vector&)>& func) const; //reduce over particles
+    Vector reduceTraces(const std::function<Scalar(const Vector&)>& func) const; //reduce over all elements of a particle
+
+    //Templated counterparts of the three above for C++ callers, with func inlined rather than called through
+    //std::function. Storages of at least minParallelElements elements per thread are split over threadCount
+    //threads; the results do not depend on threadCount.
+    static const long minParallelElements = 1L << 16;
+    //func(Scalar) -> Scalar on every stored element
+    template <typename F>
+    void applyTransformation(const F& func, const unsigned int& threadCount = 1);
+    //func takes an Eigen array over a contiguous block of the storage and returns an array expression,
+    //e.g. [](const auto& x) { return (x / 2).exp(); } for volatilities, which Eigen evaluates with SIMD
+    template <typename F>
+    void applyArrayTransformation(const F& func, const unsigned int& threadCount = 1);
+    //func takes an Eigen vector expression over the particles of one time step (reduceParticles) or one
+    //trajectory (reduceTraces). Taken as const auto& it reads the storage where the layout makes that
+    //vector contiguous; a const Vector& parameter still works, through a copy.
+    template <typename F>
+    Vector reduceParticles(const F& func, const unsigned int& threadCount = 1) const;
+    template <typename F>
+    Vector reduceTraces(const F& func, const unsigned int& threadCount = 1) const;
+
+    //per time step over the particles: means, variances (divisor N) and, as time x probabilities, the
+    //quantiles of utilfuns::quantile through utilfuns::selectQuantiles
+    Vector particleMeans(const unsigned int& threadCount = 1) const;
+    Vector particleVariances(const unsigned int& threadCount = 1) const;
+    Matrix particleQuantiles(const std::vector<double>& probabilities, const unsigned int& threadCount = 1) const;
+    Matrix getParticlesAsEigenMatrix() const;
+    //the stored particles as laid out by getLayout(), whole trajectories only with PathStorage::Copy
+    Eigen::Map<const Matrix> getStorage() const;
+    ParticlesT getParticlesWithoutInit() const;
+    //as getParticlesWithoutInit, but in place, so file storage stays in its file
+    void removeInitialParticles();
+
+    void setPathStorage(const PathStorage& storage);
+    PathStorage getPathStorage() const;
+    ParticleLayout getLayout() const;
+
+    //moves the stored particles into a trajectory file created (or overwritten) at path, back into memory for ""
+    void setStorageFile(const std::string& path);
+    std::string getStorageFile() const; //empty while in memory
  
-    bool operator==(const Particles& other) const;
+    bool operator==(const ParticlesT& other) const;
 
     unsigned int getParticleCount() const;
     unsigned int getParticleLength() const;
 };
 
+template <typename Scalar>
+template <typename F>
+void ParticlesT<Scalar>::forEachBlock(const long& n, const long& elementCount, const unsigned int& threadCount, const F& block) {
+  const long threads = std::min({static_cast<long>(threadCount), elementCount / minParallelElements, n});
+  if (threads <= 1) {
+    block(0L, n);
+    return;
+  }
+  ThreadPool pool(threads);
+  pool.run([&](unsigned int i) {
+    block(ThreadPool::blockBegin(n, threads, i), ThreadPool::blockBegin(n, threads, i+1));
+  });
+}
+
+template <typename Scalar>
+template <typename F>
+void ParticlesT<Scalar>::applyTransformation(const F& func, const unsigned int& threadCount) {
+  Scalar* data = particles_.data();
+  forEachBlock(particles_.size(), particles_.size(), threadCount, [&](const long& begin, const long& end) {
+    Eigen::Map<Eigen::Array<Scalar, Eigen::Dynamic, 1>> block(data + begin, end - begin);
+    block = block.unaryExpr(func);
+  });
+}
+
+template <typename Scalar>
+template <typename F>
+void ParticlesT<Scalar>::applyArrayTransformation(const F& func, const unsigned int& threadCount) {
+  Scalar* data = particles_.data();
+  forEachBlock(particles_.size(), particles_.size(), threadCount, [&](const long& begin, const long& end) {
+    Eigen::Map<Eigen::Array<Scalar, Eigen::Dynamic, 1>> block(data + begin, end - begin);
+    block = func(block);
+  });
+}
+
+template <typename Scalar>
+template <typename F>
+typename ParticlesT<Scalar>::Vector ParticlesT<Scalar>::reduceParticles(const F& func, const unsigned int& threadCount) const {
+  Matrix buffer;
+  bool timeMajor;
+  Eigen::Map<const Matrix> particles = tracedView(buffer, timeMajor);
+  Vector result(particleLength_);
+  forEachBlock(particleLength_, particles.size(), threadCount, [&](const long& begin, const long& end) {
+    for (long t = begin; t < end; ++t) {
+      if (timeMajor) {
+        result[t] = func(particles.col(t));
+      } else {
+        result[t] = func(particles.row(t).transpose());
+      }
+    }
+  });
+  return result;
+}
+
+template <typename Scalar>
+template <typename F>
+typename ParticlesT<Scalar>::Vector ParticlesT<Scalar>::reduceTraces(const F& func, const unsigned int& threadCount) const {
+  Matrix buffer;
+  bool timeMajor;
+  Eigen::Map<const Matrix> particles = tracedView(buffer, timeMajor);
+  Vector result(particleCount_);
+  forEachBlock(particleCount_, particles.size(), threadCount, [&](const long& begin, const long& end) {
+    for (long i = begin; i < end; ++i) {
+      if (timeMajor) {
+        result[i] = func(particles.row(i).transpose());
+      } else {
+        result[i] = func(particles.col(i));
+      }
+    }
+  });
+  return result;
+}
+
+using Particles = ParticlesT<double>;
+
+extern template class ParticlesT<double>;
+extern template class ParticlesT<float>;
+
 #endif
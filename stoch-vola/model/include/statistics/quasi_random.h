@@ -0,0 +1,60 @@
+#ifndef QUASI_RANDOM_H
+#define QUASI_RANDOM_H
+
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <utility>
+
+#include <Eigen/Dense>
+
+
+class ScrambledSobol {
+  //First two dimensions of the Sobol sequence (Joe, Kuo - Constructing Sobol sequences with better
+  //two-dimensional projections (2008)), randomised by a random linear matrix scramble and a digital shift
+  //(Matousek - On the L2-discrepancy for anchored boxes (1998)) drawn from the Philox stream (seed, step).
+  //Every point is uniform on [0,1)^2 while the first 2^m points stay a (0,m,2)-net, which is what gives
+  //randomised quasi-Monte Carlo estimates their faster than 1/sqrt(N) variance decay in low dimension.
+  private:
+    std::array<std::array<std::uint32_t, 32>, 2> directions_; //scrambled direction numbers
+    std::array<std::uint32_t, 2> shifts_;
+
+  public:
+    ScrambledSobol(const std::uint64_t& seed, const std::uint32_t& step);
+
+    //both coordinates of point index as 32-bit fractions of 1
+    std::pair<std::uint32_t, std::uint32_t> point(const std::uint32_t& index) const;
+};
+
+//Scratch of the state-ordered noise and resampling; once reserved for N particles, steps on N particles
+//reuse it without heap allocation
+struct StateOrderBuffers {
+  std::vector<int> order;
+  std::vector<std::pair<std::uint32_t, std::uint32_t>> points;
+  Eigen::VectorXd sortedWeights;
+
+  void reserve(const unsigned int& nParticles);
+};
+
+namespace quasirandom {
+    //Standard normal quantile: Acklam's rational approximation refined by one Halley step on erfc,
+    //accurate to a few ulp over (0, 1); -inf and inf at 0 and 1
+    double normalQuantile(const double& p);
+
+    //centre of the 2^-32 cell of a 32-bit fraction, strictly inside (0, 1)
+    double toUnit(const std::uint32_t& fraction);
+
+    //indices of states in ascending order of state, ties in index order
+    template <typename Scalar>
+    void stateOrder(const Eigen::Ref<const Eigen::Matrix<Scalar, Eigen::Dynamic, 1>>& states, std::vector<int>& order);
+
+    //Sequential quasi-Monte Carlo noise (Gerber, Chopin - Sequential quasi Monte Carlo (2015)) for one step:
+    //the scrambled Sobol points of (seed, step), ordered by their first coordinate, go to the particles
+    //ordered by state, and each particle takes the normal quantile of its point's second coordinate.
+    template <typename Scalar>
+    void stateOrderedNormals(const Eigen::Ref<const Eigen::Matrix<Scalar, Eigen::Dynamic, 1>>& states,
+                             Eigen::Ref<Eigen::Matrix<Scalar, Eigen::Dynamic, 1>> out,
+                             const std::uint64_t& seed, const std::uint32_t& step, StateOrderBuffers& buffers);
+}
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef RANDOM_ENGINE_H
+#define RANDOM_ENGINE_H
+
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <limits>
+
+#include <Eigen/Dense>
+#include <EigenRand/EigenRand>
+
+
+class ReseedableMersenneTwister {
+  //Yields the same stream as Eigen::Rand::P8_mt19937_64 for the same seed, but seed() restarts it in place.
+  //The lanes and output buffers are allocated once in the constructor, so a filter can restart the
+  //stream on every step without touching the heap.
+  private:
+    using LaneEngine = Eigen::Rand::Vmt19937_64;
+
+    std::vector<LaneEngine, Eigen::aligned_allocator<LaneEngine>> lanes_;
+    std::vector<std::uint64_t, Eigen::aligned_allocator<std::uint64_t>> buffer_;
+    std::vector<float, Eigen::aligned_allocator<float>> floatBuffer_;
+    std::size_t bufferIndex_;
+    std::size_t floatBufferIndex_;
+
+    void refillBuffer();
+    void refillFloatBuffer();
+
+  public:
+    using result_type = std::uint64_t;
+
+    explicit ReseedableMersenneTwister(const std::uint64_t& seed = std::uint64_t(LaneEngine::default_seed));
+
+    void seed(const std::uint64_t& seed);
+
+    static constexpr result_type min() {
+      return std::numeric_limits<result_type>::min();
+    }
+
+    static constexpr result_type max() {
+      return std::numeric_limits<result_type>::max();
+    }
+
+    result_type operator()();
+    float uniform_real();
+
+    //Standard normal draws into out, resized to size. Generated out of line so that every caller runs the
+    //same code for the packet log and sincos approximations, whichever translation unit it lives in.
+    void standardNormal(Eigen::VectorXd& out, const Eigen::Index& size);
+    void standardNormal(Eigen::VectorXf& out, const Eigen::Index& size);
+    //standard normal draws filling out, e.g. one block's segment of a larger vector
+    void standardNormal(Eigen::Ref<Eigen::VectorXd> out);
+    void standardNormal(Eigen::Ref<Eigen::VectorXf> out);
+};
+
+
+class PhiloxEngine {
+  //Counter-based Philox4x32-10 generator (Salmon et al. - Parallel Random Numbers: As Easy as 1, 2, 3 (2011)).
+  //Word k of the stream (seed, step, stream) is a pure function of those four numbers, so every step and
+  //every block of particles within it is reached in O(1) through seed() and discard(), and construction
+  //costs nothing. Usable wherever EigenRand takes a scalar 64-bit engine.
+  private:
+    std::array<std::uint32_t, 2> key_;
+    std::uint32_t step_;
+    std::uint32_t stream_;
+    std::uint64_t position_; //index of the next 64-bit word
+    std::uint64_t cachedCounter_;
+    std::uint64_t cachedWords_[2];
+
+  public:
+    using result_type = std::uint64_t;
+
+    explicit PhiloxEngine(const std::uint64_t& seed = 0, const std::uint32_t& step = 0, const std::uint32_t& stream = 0);
+
+    //moves to the start of stream (seed, step, stream)
+    void seed(const std::uint64_t& seed, const std::uint32_t& step = 0, const std::uint32_t& stream = 0);
+    //skips n positions in O(1)
+    void discard(const std::uint64_t& n);
+    std::uint64_t getPosition() const;
+
+    static constexpr result_type min() {
+      return std::numeric_limits<result_type>::min();
+    }
+
+    static constexpr result_type max() {
+      return std::numeric_limits<result_type>::max();
+    }
+
+    result_type operator()();
+
+    //Standard normals by Box-Muller, the two words of counter j giving the normals at positions 2j and 2j+1.
+    //The value at a position is therefore the same however the draws are split between calls or threads.
+    //Advances the position by out.size().
+    void standardNormal(Eigen::Ref<Eigen::VectorXd> out);
+    void standardNormal(Eigen::Ref<Eigen::VectorXf> out);
+
+    //the Philox4x32-10 bijection itself: the stream is block({seed}, {j, j >> 32, step, stream}) for j = 0, 1, ...
+    static std::array<std::uint32_t, 4> block(const std::array<std::uint32_t, 2>& key,
+                                              const std::array<std::uint32_t, 4>& counter);
+};
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef RESAMPLING_H
+#define RESAMPLING_H
+
+#include <random>
+#include <vector>
+
+#include <Eigen/Dense>
+
+#include "thread_pool.h"
+
+enum class ResamplingScheme {
+  Multinomial,
+  Stratified,
+  Systematic,
+  Residual
+};
+
+//Scratch of the pooled ancestorIndices: cumulative weights and the per-block offsets, sized by the
+//first call and reused by later ones of the same length and thread count
+struct PooledResamplingBuffers {
+  Eigen::VectorXd cumulative;
+  std::vector<double> offsets;
+  std::vector<double> spacingOffsets;
+  std::vector<char> negative;
+};
+
+namespace resampling {
+    //Ancestor indices for one resampling step; weights do not need to be normalised.
+    //All schemes run in O(N) by inverting a sorted set of uniforms in a single sweep.
+    Eigen::VectorXi ancestorIndices(const Eigen::Ref<const Eigen::VectorXd>& weights,
+                                    const ResamplingScheme& scheme,
+                                    std::mt19937& generator);
+
+    //Same as above, writing into ancestors and using uniforms (and residuals, Residual only) as
+    //scratch, all of the length of weights, so calls with reused buffers allocate nothing.
+    void ancestorIndices(const Eigen::Ref<const Eigen::VectorXd>& weights,
+                         const ResamplingScheme& scheme,
+                         std::mt19937& generator,
+                         Eigen::Ref<Eigen::VectorXi> ancestors,
+                         Eigen::Ref<Eigen::VectorXd> uniforms,
+                         Eigen::Ref<Eigen::VectorXd> residuals);
+
+    //Same schemes split over the pool: cumulative weights via a blocked parallel prefix sum,
+    //then every thread inverts its own block of sorted uniforms. Deterministic for a given
+    //seed and thread count (systematic does not depend on the thread count at all).
+    //Residual resampling runs serially.
+    Eigen::VectorXi ancestorIndices(const Eigen::Ref<const Eigen::VectorXd>& weights,
+                                    const ResamplingScheme& scheme,
+                                    const unsigned int& seed,
+                                    ThreadPool& pool);
+
+    //Same as above, writing into ancestors and using uniforms (of the length of weights) and buffers
+    //as scratch, so calls with reused buffers allocate nothing.
+    void ancestorIndices(const Eigen::Ref<const Eigen::VectorXd>& weights,
+                         const ResamplingScheme& scheme,
+                         const unsigned int& seed,
+                         ThreadPool& pool,
+                         Eigen::Ref<Eigen::VectorXi> ancestors,
+                         Eigen::Ref<Eigen::VectorXd> uniforms,
+                         PooledResamplingBuffers& buffers);
+
+    //Writes the ancestor of every (ascending) uniform in [0,1) into ancestors
+    void invertSortedUniforms(const Eigen::Ref<const Eigen::VectorXd>& weights,
+                              const Eigen::Ref<const Eigen::VectorXd>& sortedUniforms,
+                              Eigen::Ref<Eigen::VectorXi> ancestors);
+}
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+
+
+class ThreadPool {
+  //Fixed set of workers that run one task per thread and block until all are done.
+  //Tasks receive their thread index, so work is split into a deterministic set of blocks.
+  private:
+    std::vector<std::thread> workers_;
+    unsigned int threadCount_;
+    std::mutex mutex_;
+    std::condition_variable startCondition_;
+    std::condition_variable doneCondition_;
+    const std::function<void(unsigned int)>* task_;
+    unsigned long generation_;
+    unsigned int pending_;
+    bool stopping_;
+    std::exception_ptr error_;
+
+    void workerLoop(const unsigned int& index);
+    void runTask(const std::function<void(unsigned int)>& task);
+
+  public:
+    explicit ThreadPool(const unsigned int& threadCount);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    //runs task(i) for every i < threadCount, the calling thread takes i = 0. The task is only referenced
+    //for the duration of the call, so a lambda of any size reaches the workers without a heap allocation.
+    template <typename Task>
+    void run(Task&& task) {
+      runTask(std::function<void(unsigned int)>(std::ref(task)));
+    }
+
+    unsigned int getThreadCount() const;
+
+    //first index of block `block` when splitting n items into `blocks` contiguous blocks
+    static long blockBegin(const long& n, const unsigned int& blocks, const unsigned int& block);
+    //seed of the random stream owned by block `block`, block 0 keeps the base seed
+    static unsigned long long blockSeed(const unsigned long long& seed, const unsigned int& block);
+};
+
+#endif
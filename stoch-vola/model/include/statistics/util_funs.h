@@ -2,11 +2,75 @@
 #define UTIL_FUNS_H
 
 #include <vector>
+#include <algorithm>
+
+#include <Eigen/Dense>
 
 namespace utilfuns {
+    //a batch of samples, one per row, in either storage order: a time x particles matrix, or the transpose
+    //of a TimeMajor Particles storage, binds without a copy
+    using SampleMatrixRef = Eigen::Ref<const Eigen::MatrixXd, 0, Eigen::Stride<Eigen::Dynamic, Eigen::Dynamic>>;
+
     double mean(const std::vector<double>& data);
     double standardDeviation(const std::vector<double>& data, const int& ddof = 0);
     double quantile(const std::vector<double>& data, double q);
+
+    //first two moments of a sample, the variance with divisor weightSum (the count when unweighted)
+    struct Moments {
+      double weightSum = 0.0;
+      double mean = 0.0;
+      double variance = 0.0;
+    };
+    Moments moments(const Eigen::Ref<const Eigen::VectorXd>& data);
+    //weights >= 0, normalised or not
+    Moments moments(const Eigen::Ref<const Eigen::VectorXd>& data, const Eigen::Ref<const Eigen::VectorXd>& weights);
+
+    //indices of probabilities in ascending order of probability, std::invalid_argument outside [0, 1]
+    std::vector<int> quantileOrder(const std::vector<double>& probabilities);
+    //quantile(data, probabilities[k]) into out[k * outStride] for the n values at first, which are reordered:
+    //ascending probabilities (order from quantileOrder) select with nth_element into the part above the last
+    //selected order statistic, so many quantiles cost little more than one
+    template <typename Scalar>
+    void selectQuantiles(Scalar* first, const long& n, const std::vector<double>& probabilities,
+                         const std::vector<int>& order, double* out, const long& outStride = 1);
+
+    //the quantiles of quantile at every probability, by selection over one copy of data
+    Eigen::VectorXd quantiles(const Eigen::Ref<const Eigen::VectorXd>& data, const std::vector<double>& probabilities);
+    //inverse of the weighted empirical distribution, the smallest value whose cumulative weight reaches
+    //probability * weightSum, by a weighted multi-quickselect instead of a sort
+    Eigen::VectorXd weightedQuantiles(const Eigen::Ref<const Eigen::VectorXd>& data, const Eigen::Ref<const Eigen::VectorXd>& weights,
+                                      const std::vector<double>& probabilities);
+
+    //the above per row of samples (weights of the same shape), rows split over threadCount threads once every
+    //thread gets at least 2^16 values: rows x probabilities, and rows x (mean, variance) for the moments
+    Eigen::MatrixXd rowQuantiles(const SampleMatrixRef& samples, const std::vector<double>& probabilities,
+                                 const unsigned int& threadCount = 1);
+    Eigen::MatrixXd rowWeightedQuantiles(const SampleMatrixRef& samples, const SampleMatrixRef& weights,
+                                         const std::vector<double>& probabilities, const unsigned int& threadCount = 1);
+    Eigen::MatrixXd rowMoments(const SampleMatrixRef& samples, const unsigned int& threadCount = 1);
+    Eigen::MatrixXd rowWeightedMoments(const SampleMatrixRef& samples, const SampleMatrixRef& weights,
+                                       const unsigned int& threadCount = 1);
+}
+
+template <typename Scalar>
+void utilfuns::selectQuantiles(Scalar* first, const long& n, const std::vector<double>& probabilities,
+                               const std::vector<int>& order, double* out, const long& outStride) {
+  long start = 0;
+  for (int k : order) {
+    const double position = probabilities[k] * (n - 1);
+    const long lower = static_cast<long>(position);
+    const double weight = position - lower;
+    if (lower >= start) {
+      std::nth_element(first + start, first + lower, first + n);
+      start = lower + 1;
+    }
+    double value = first[lower];
+    if (lower + 1 < n) {//the next order statistic is the least value above the selected one
+      const double upper = *std::min_element(first + lower + 1, first + n);
+      value = value * (1.0 - weight) + upper * weight;
+    }
+    out[k * outStride] = value;
+  }
 }
 
 #endif
@@ -0,0 +1,552 @@
+#include <vector>
+#include <cmath>
+#include <memory>
+#include <random>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+
+#include <Eigen/Dense>
+
+#include "model/bootstrap_filter.h"
+#include "model/bootstrap_kernels.h"
+#include "model/filter_statistics.h"
+#include "model/filter_workspace.h"
+#include "model/sv_models.h"
+#include "statistics/normal_distribution.h"
+#include "statistics/particles.h"
+#include "statistics/quasi_random.h"
+#include "statistics/random_engine.h"
+#include "statistics/resampling.h"
+#include "statistics/thread_pool.h"
+
+
+namespace {
+  template <typename Scalar>
+  using VectorT = Eigen::Matrix<Scalar, Eigen::Dynamic, 1>;
+
+  //Chunks of the counter-based step, a multiple of every packet size: split at chunk boundaries, each
+  //particle falls into the same packet (or scalar tail) of the vectorised loops as in a single pass.
+  constexpr long counterChunkSize = 1024;
+
+  //runs body(begin, length) once without a pool, otherwise on every thread's contiguous run of chunks
+  template <typename Body>
+  void forEachChunk(const long& n, ThreadPool* pool, const Body& body) {
+    if (pool == nullptr) {
+      body(0L, n);
+      return;
+    }
+
+    const long chunks = (n + counterChunkSize - 1) / counterChunkSize;
+    const unsigned int blocks = pool->getThreadCount();
+    pool->run([&](unsigned int block) {
+      const long begin = ThreadPool::blockBegin(chunks, blocks, block) * counterChunkSize;
+      const long end = std::min(n, ThreadPool::blockBegin(chunks, blocks, block + 1) * counterChunkSize);
+      if (begin < end) {
+        body(begin, end - begin);
+      }
+    });
+  }
+}
+
+
+unsigned int bootstrap::stepSeed(const unsigned int& seed, const unsigned int& t) {
+  return seed + t * 0x9E3779B9u;
+}
+
+template <typename Scalar>
+void bootstrap::resample(ParticlesT<Scalar>& particles, VectorT<Scalar>& logWeights, VectorT<Scalar>& weights,
+                         const ResamplingScheme& scheme, const bool& stateOrdered, const unsigned int& seed, ThreadPool* pool) {
+  if (stateOrdered) {
+    const long nParticles = weights.size();
+    std::mt19937 generator(seed);
+    Eigen::VectorXi ancestors(nParticles);
+    Eigen::VectorXd uniforms(nParticles), residuals(nParticles);
+    StateOrderBuffers orderBuffers;
+    stateOrderedAncestors<Scalar>(particles.getLatestParticles(), weights.template cast<double>(), scheme, generator,
+                                  ancestors, uniforms, residuals, orderBuffers);
+    particles.applyAncestors(ancestors);
+  } else if (pool == nullptr) {
+    particles.resampleParticles(weights.template cast<double>(), scheme, seed);
+  } else {
+    particles.applyAncestors(resampling::ancestorIndices(weights.template cast<double>(), scheme, seed, *pool));
+  }
+
+  const double nParticles = weights.size();
+  weights.setConstant(static_cast<Scalar>(1.0 / nParticles));
+  logWeights.setConstant(static_cast<Scalar>(-std::log(nParticles)));
+}
+
+template <typename Scalar>
+void bootstrap::resample(FilterBuffers<Scalar>& buffers, std::mt19937& generator, const ResamplingScheme& scheme,
+                         const bool& stateOrdered, const unsigned int& seed, ThreadPool* pool) {
+  const Eigen::VectorXd& weights = buffers.doubleWeights();
+  if (stateOrdered) {
+    generator.seed(seed);
+    stateOrderedAncestors<Scalar>(buffers.particles, weights, scheme, generator, buffers.ancestors, buffers.uniforms, buffers.residuals,
+                                  buffers.orderBuffers);
+  } else if (pool == nullptr) {
+    generator.seed(seed);
+    resampling::ancestorIndices(weights, scheme, generator, buffers.ancestors, buffers.uniforms, buffers.residuals);
+  } else {
+    resampling::ancestorIndices(weights, scheme, seed, *pool, buffers.ancestors, buffers.uniforms, buffers.pooledResampling);
+  }
+
+  const long nParticles = buffers.particles.size();
+  for (long i = 0; i < nParticles; ++i) {
+    buffers.gathered[i] = buffers.particles[buffers.ancestors[i]];
+  }
+  buffers.particles.swap(buffers.gathered);
+
+  buffers.weights.setConstant(static_cast<Scalar>(1.0 / nParticles));
+  buffers.logWeights.setConstant(static_cast<Scalar>(-std::log(nParticles)));
+}
+
+template <typename Scalar>
+void bootstrap::stateOrderedAncestors(const Eigen::Ref<const VectorT<Scalar>>& states,
+                                      const Eigen::Ref<const Eigen::VectorXd>& weights,
+                                      const ResamplingScheme& scheme, std::mt19937& generator,
+                                      Eigen::Ref<Eigen::VectorXi> ancestors,
+                                      Eigen::Ref<Eigen::VectorXd> uniforms, Eigen::Ref<Eigen::VectorXd> residuals,
+                                      StateOrderBuffers& orderBuffers) {
+  std::vector<int>& order = orderBuffers.order;
+  quasirandom::stateOrder<Scalar>(states, order);
+  const long nParticles = weights.size();
+  Eigen::VectorXd& sortedWeights = orderBuffers.sortedWeights;
+  sortedWeights.resize(nParticles);
+  for (long i = 0; i < nParticles; ++i) {
+    sortedWeights[i] = weights[order[i]];
+  }
+
+  resampling::ancestorIndices(sortedWeights, scheme, generator, ancestors, uniforms, residuals);
+  for (long i = 0; i < nParticles; ++i) {
+    ancestors[i] = order[ancestors[i]];
+  }
+}
+
+template void bootstrap::resample<double>(ParticlesT<double>&, VectorT<double>&, VectorT<double>&, const ResamplingScheme&,
+                                          const bool&, const unsigned int&, ThreadPool*);
+template void bootstrap::resample<float>(ParticlesT<float>&, VectorT<float>&, VectorT<float>&, const ResamplingScheme&,
+                                         const bool&, const unsigned int&, ThreadPool*);
+template void bootstrap::stateOrderedAncestors<double>(const Eigen::Ref<const VectorT<double>>&, const Eigen::Ref<const Eigen::VectorXd>&,
+                                                       const ResamplingScheme&, std::mt19937&, Eigen::Ref<Eigen::VectorXi>,
+                                                       Eigen::Ref<Eigen::VectorXd>, Eigen::Ref<Eigen::VectorXd>, StateOrderBuffers&);
+
+
+template <typename Model>
+BootstrapFilter<Model>::BootstrapFilter(const Model& model) : model_(model) {}
+
+template <typename Model>
+const Model& BootstrapFilter<Model>::getModel() const {
+  return model_;
+}
+
+
+template <typename Model>
+template <typename Scalar>
+bool BootstrapFilter<Model>::step(VectorT<Scalar>& particles, VectorT<Scalar>& logWeights, VectorT<Scalar>& weights,
+                                  VectorT<Scalar>& scratch, FilterStepStatistics& statistics, const double& yPrevious, const double& y,
+                                  const unsigned int& seed, const unsigned int& t, const RandomEngine& randomEngine,
+                                  ReseedableMersenneTwister& engine, StateOrderBuffers& orderBuffers, BlockBuffers& blockBuffers,
+                                  ThreadPool* pool) const {
+  const typename Model::template Step<Scalar> kernel = model_.template step<Scalar>(yPrevious, y);
+  if (randomEngine == RandomEngine::Philox) {
+    return counterBasedStep(particles, logWeights, weights, scratch, statistics, kernel, seed, t, blockBuffers, pool);
+  }
+
+  const unsigned int loopSeed = bootstrap::stepSeed(seed, t);
+
+  SV_INSTRUMENT(StageTimer timer;)
+
+  if (pool == nullptr || randomEngine == RandomEngine::Sobol) {
+    //propagate and the observation log-densities fused into one pass over the draws
+    if (randomEngine == RandomEngine::Sobol) {
+      scratch.resize(particles.size());
+      quasirandom::stateOrderedNormals<Scalar>(particles, scratch, seed, t, orderBuffers);
+    } else {
+      engine.seed(loopSeed);
+      engine.standardNormal(scratch, particles.size());
+    }
+    SV_INSTRUMENT(statistics.noiseSeconds = timer.lap();)
+    const kernels::WeighResult weighed = kernels::propagateAndWeigh<Scalar>(particles, scratch, logWeights, weights, scratch, kernel);
+    statistics.weightedLogLikelihood = weighed.weightedLogLikelihood;
+    SV_INSTRUMENT(statistics.propagateSeconds = timer.lap();)
+
+    if (!std::isfinite(weighed.maxLogWeight)) {//every particle is impossible, keep the previous weights
+      statistics.logEvidence = weighed.maxLogWeight;
+      return false;
+    }
+
+    const kernels::ExponentiateResult sums = kernels::exponentiate<Scalar>(scratch, weights, weighed.maxLogWeight);
+    SV_INSTRUMENT(statistics.weightSeconds = timer.lap();)
+    statistics.logEvidence = weighed.maxLogWeight + std::log(sums.weightSum);
+    kernels::normalise<Scalar>(scratch, weights, logWeights, sums.weightSum, statistics.logEvidence);
+
+    statistics.effectiveSampleSize = sums.weightSum * sums.weightSum / sums.squaredWeightSum;
+    SV_INSTRUMENT(statistics.normaliseSeconds = timer.lap();)
+    return true;
+  }
+
+  const unsigned int blocks = pool->getThreadCount();
+  const long nParticles = particles.size();
+  std::vector<double>& maxLogWeights = blockBuffers.maxLogWeights;
+  std::vector<double>& weightedLogLikelihoods = blockBuffers.weightedLogLikelihoods;
+  std::vector<double>& weightSums = blockBuffers.weightSums;
+  std::vector<double>& squaredWeightSums = blockBuffers.squaredWeightSums;
+  maxLogWeights.assign(blocks, -std::numeric_limits<double>::infinity());
+  weightedLogLikelihoods.assign(blocks, 0.0);
+  weightSums.assign(blocks, 0.0);
+  squaredWeightSums.assign(blocks, 0.0);
+
+  scratch.resize(nParticles);
+
+  pool->run([&](unsigned int block) {
+    const long begin = ThreadPool::blockBegin(nParticles, blocks, block);
+    const long length = ThreadPool::blockBegin(nParticles, blocks, block + 1) - begin;
+    if (length == 0) {
+      return;
+    }
+
+    //every block draws its propagation noise from its own stream, straight into its segment of scratch
+    ReseedableMersenneTwister& blockEngine = blockBuffers.engines[block];
+    blockEngine.seed(static_cast<unsigned int>(ThreadPool::blockSeed(loopSeed, block)));
+    blockEngine.standardNormal(scratch.segment(begin, length));
+
+    const kernels::WeighResult weighed = kernels::propagateAndWeigh<Scalar>(particles.segment(begin, length), scratch.segment(begin, length),
+                                                                            logWeights.segment(begin, length),
+                                                                            weights.segment(begin, length),
+                                                                            scratch.segment(begin, length), kernel);
+    weightedLogLikelihoods[block] = weighed.weightedLogLikelihood;
+    maxLogWeights[block] = weighed.maxLogWeight;
+    SV_INSTRUMENT(if (block == 0) statistics.propagateSeconds = timer.lap();)
+  });
+
+  //combined in block order so the result only depends on seed and thread count
+  statistics.weightedLogLikelihood = 0.0;
+  double maxLogWeight = -std::numeric_limits<double>::infinity();
+  for (unsigned int block = 0; block < blocks; ++block) {
+    statistics.weightedLogLikelihood += weightedLogLikelihoods[block];
+    maxLogWeight = std::max(maxLogWeight, maxLogWeights[block]);
+  }
+  if (!std::isfinite(maxLogWeight)) {//every particle is impossible, keep the previous weights
+    statistics.logEvidence = maxLogWeight;
+    return false;
+  }
+
+  pool->run([&](unsigned int block) {
+    const long begin = ThreadPool::blockBegin(nParticles, blocks, block);
+    const long length = ThreadPool::blockBegin(nParticles, blocks, block + 1) - begin;
+
+    const kernels::ExponentiateResult sums = kernels::exponentiate<Scalar>(scratch.segment(begin, length),
+                                                                           weights.segment(begin, length), maxLogWeight);
+    weightSums[block] = sums.weightSum;
+    squaredWeightSums[block] = sums.squaredWeightSum;
+    SV_INSTRUMENT(if (block == 0) statistics.weightSeconds = timer.lap();)
+  });
+
+  double weightSum = 0.0;
+  double squaredWeightSum = 0.0;
+  for (unsigned int block = 0; block < blocks; ++block) {
+    weightSum += weightSums[block];
+    squaredWeightSum += squaredWeightSums[block];
+  }
+  statistics.logEvidence = maxLogWeight + std::log(weightSum);
+
+  pool->run([&](unsigned int block) {
+    const long begin = ThreadPool::blockBegin(nParticles, blocks, block);
+    const long length = ThreadPool::blockBegin(nParticles, blocks, block + 1) - begin;
+
+    kernels::normalise<Scalar>(scratch.segment(begin, length), weights.segment(begin, length),
+                               logWeights.segment(begin, length), weightSum, statistics.logEvidence);
+  });
+
+  statistics.effectiveSampleSize = weightSum * weightSum / squaredWeightSum;
+  SV_INSTRUMENT(statistics.normaliseSeconds = timer.lap();)
+  return true;
+}
+
+template <typename Model>
+template <typename Scalar>
+bool BootstrapFilter<Model>::counterBasedStep(VectorT<Scalar>& particles, VectorT<Scalar>& logWeights, VectorT<Scalar>& weights,
+                                              VectorT<Scalar>& scratch, FilterStepStatistics& statistics,
+                                              const typename Model::template Step<Scalar>& kernel,
+                                              const unsigned int& seed, const unsigned int& t, BlockBuffers& blockBuffers,
+                                              ThreadPool* pool) const {
+  const long nParticles = particles.size();
+
+  scratch.resize(nParticles);
+  SV_INSTRUMENT(StageTimer timer;)
+
+  //Particle i takes the normal at position i of the stream (seed, t), wherever its chunk runs. The sums are
+  //taken per 1024-chunk and added up in chunk order: as they come without a pool, stored per chunk over one.
+  const long chunks = (nParticles + counterChunkSize - 1) / counterChunkSize;
+  std::vector<kernels::WeighResult>& weighed = blockBuffers.chunkWeighed;
+  std::vector<kernels::ExponentiateResult>& sums = blockBuffers.chunkSums;
+  weighed.resize(pool == nullptr ? 0 : chunks);
+  sums.resize(pool == nullptr ? 0 : chunks);
+  statistics.weightedLogLikelihood = 0.0;
+  double maxLogWeight = -std::numeric_limits<double>::infinity();
+  double weightSum = 0.0;
+  double squaredWeightSum = 0.0;
+
+  auto addWeighed = [&](const kernels::WeighResult& partial) {
+    statistics.weightedLogLikelihood += partial.weightedLogLikelihood;
+    maxLogWeight = std::max(maxLogWeight, partial.maxLogWeight);
+  };
+  auto addSums = [&](const kernels::ExponentiateResult& partial) {
+    weightSum += partial.weightSum;
+    squaredWeightSum += partial.squaredWeightSum;
+  };
+
+  forEachChunk(nParticles, pool, [&](const long& begin, const long& length) {
+    SV_INSTRUMENT(const bool timed = begin == 0;) //the calling thread's chunks
+
+    PhiloxEngine engine(seed, t);
+    engine.discard(begin);
+    engine.standardNormal(scratch.segment(begin, length));
+    SV_INSTRUMENT(if (timed) statistics.noiseSeconds = timer.lap();)
+
+    for (long chunk = begin; chunk < begin + length; chunk += counterChunkSize) {
+      const long size = std::min(counterChunkSize, begin + length - chunk);
+      kernels::WeighResult partial = kernels::propagateAndWeigh<Scalar>(particles.segment(chunk, size), scratch.segment(chunk, size),
+                                                                        logWeights.segment(chunk, size), weights.segment(chunk, size),
+                                                                        scratch.segment(chunk, size), kernel);
+      if (pool == nullptr) {
+        addWeighed(partial);
+      } else {
+        weighed[chunk / counterChunkSize] = partial;
+      }
+    }
+    SV_INSTRUMENT(if (timed) statistics.propagateSeconds = timer.lap();)
+  });
+  std::for_each(weighed.begin(), weighed.end(), addWeighed);
+
+  if (!std::isfinite(maxLogWeight)) {//every particle is impossible, keep the previous weights
+    statistics.logEvidence = maxLogWeight;
+    return false;
+  }
+
+  forEachChunk(nParticles, pool, [&](const long& begin, const long& length) {
+    for (long chunk = begin; chunk < begin + length; chunk += counterChunkSize) {
+      const long size = std::min(counterChunkSize, begin + length - chunk);
+      kernels::ExponentiateResult partial = kernels::exponentiate<Scalar>(scratch.segment(chunk, size), weights.segment(chunk, size),
+                                                                          maxLogWeight);
+      if (pool == nullptr) {
+        addSums(partial);
+      } else {
+        sums[chunk / counterChunkSize] = partial;
+      }
+    }
+  });
+  std::for_each(sums.begin(), sums.end(), addSums);
+  statistics.logEvidence = maxLogWeight + std::log(weightSum);
+  SV_INSTRUMENT(statistics.weightSeconds = timer.lap();)
+
+  forEachChunk(nParticles, pool, [&](const long& begin, const long& length) {
+    kernels::normalise<Scalar>(scratch.segment(begin, length), weights.segment(begin, length),
+                               logWeights.segment(begin, length), weightSum, statistics.logEvidence);
+  });
+
+  statistics.effectiveSampleSize = weightSum * weightSum / squaredWeightSum;
+  SV_INSTRUMENT(statistics.normaliseSeconds = timer.lap();)
+  return true;
+}
+
+template <typename Model>
+template <typename Scalar>
+ParticlesT<Scalar> BootstrapFilter<Model>::trajectories(const SeriesRef& y, const unsigned int& nParticles,
+                                                        const unsigned int& seed, const FilterOptions& options) const {
+  if (options.proposal != FilterProposal::Bootstrap) {
+    throw std::invalid_argument("Only the bootstrap proposal is available for this model.");
+  }
+  unsigned int T = y.size();
+  SV_INSTRUMENT(FilterRecorder recorder(options.statistics.get(), T);)
+
+  IndependentVectorNormalT<Scalar> initial(static_cast<Scalar>(model_.initialMean()), static_cast<Scalar>(model_.initialStdDev()),
+                                           nParticles);
+  ParticlesT<Scalar> particles = ParticlesT<Scalar>(initial, T+1, seed, options.particleLayout, options.storageFile);
+  particles.setPathStorage(PathStorage::Genealogy); //trajectories are only traced back once at the end
+
+  std::unique_ptr<ThreadPool> pool;
+  BlockBuffers blockBuffers;
+  if (options.threadCount > 1) {
+    pool.reset(new ThreadPool(options.threadCount));
+    blockBuffers.resize(options.threadCount);
+  }
+
+  VectorT<Scalar> logWeights = VectorT<Scalar>::Constant(nParticles, static_cast<Scalar>(-std::log(nParticles)));
+  VectorT<Scalar> weights = VectorT<Scalar>::Constant(nParticles, static_cast<Scalar>(1.0 / nParticles));
+  VectorT<Scalar> scratch;
+  ReseedableMersenneTwister engine;
+  StateOrderBuffers orderBuffers;
+  FilterStepStatistics statistics;
+  bool equallyWeighted = true;
+  ThreadPool* resamplingPool = options.randomEngine == RandomEngine::MersenneTwister ? pool.get() : nullptr;
+  const bool stateOrdered = options.randomEngine == RandomEngine::Sobol;
+
+  for (unsigned int t=1; t<=T; t++) {
+    unsigned int loopSeed = bootstrap::stepSeed(seed, t); //unique seed for each loop iteration
+    VectorT<Scalar> latestParticles = particles.getLatestParticles(); //particles at t-1
+    bool updated = step(latestParticles, logWeights, weights, scratch, statistics, t > 1 ? y[t-2] : 0.0, y[t-1], seed, t,
+                        options.randomEngine, engine, orderBuffers, blockBuffers, pool.get());
+    SV_INSTRUMENT(recorder.recordStep(statistics, updated);)
+
+    particles.appendParticles(latestParticles); //particles at t
+    
+    if (updated) {
+      equallyWeighted = false;
+      if (statistics.effectiveSampleSize < options.essThreshold * nParticles) {
+        SV_INSTRUMENT(recorder.startResampling();)
+        bootstrap::resample(particles, logWeights, weights, options.resamplingScheme, stateOrdered, loopSeed, resamplingPool);
+        SV_INSTRUMENT(recorder.finishResampling();)
+        equallyWeighted = true;
+      }
+    }
+  }
+
+  if (!equallyWeighted) {//returned trajectories carry no weights
+    SV_INSTRUMENT(recorder.startResampling();)
+    bootstrap::resample(particles, logWeights, weights, options.resamplingScheme, stateOrdered, bootstrap::stepSeed(seed, T+1),
+                        resamplingPool);
+    SV_INSTRUMENT(recorder.finishResampling();)
+  }
+
+  if (options.storageFile.empty()) {
+    return particles.getParticlesWithoutInit();
+  }
+  particles.removeInitialParticles(); //traced and trimmed within the file
+  return particles;
+}
+
+template <typename Model>
+template <typename Scalar>
+void BootstrapFilter<Model>::logLikelihoods(const SeriesRef& y, const unsigned int& nParticles, const unsigned int& seed,
+                                            const FilterOptions& options, FilterWorkspace& workspace,
+                                            double& logLikeSum, double& logEvidenceSum) const {
+  if (nParticles == 0) {
+    throw std::invalid_argument("Number of particles must be greater than zero.");
+  }
+  if (options.proposal != FilterProposal::Bootstrap) {
+    throw std::invalid_argument("Only the bootstrap proposal is available for this model.");
+  }
+  unsigned int T = y.size();
+  SV_INSTRUMENT(FilterRecorder recorder(options.statistics.get(), T);)
+
+  FilterBuffers<Scalar>& buffers = workspace.buffers<Scalar>();
+  buffers.resize(nParticles);
+
+  //the draw of the initial distribution in particleFilter, straight into the buffer
+  workspace.engine_.seed(seed);
+  workspace.engine_.standardNormal(buffers.particles, nParticles);
+  buffers.particles *= static_cast<Scalar>(model_.initialStdDev());
+  buffers.particles.array() += static_cast<Scalar>(model_.initialMean());
+
+  //the pool and its block buffers persist in the workspace across calls with the same thread count
+  ThreadPool* pool = workspace.pool(options.threadCount);
+  ThreadPool* resamplingPool = options.randomEngine == RandomEngine::MersenneTwister ? pool : nullptr;
+  const bool stateOrdered = options.randomEngine == RandomEngine::Sobol;
+
+  //per-step terms are accumulated in double whatever the particle precision
+  logLikeSum = 0.0;
+  logEvidenceSum = 0.0;
+  buffers.logWeights.setConstant(static_cast<Scalar>(-std::log(nParticles)));
+  buffers.weights.setConstant(static_cast<Scalar>(1.0 / nParticles));
+  FilterStepStatistics statistics;
+
+  for (unsigned int t=1; t<=T; t++) {
+    unsigned int loopSeed = bootstrap::stepSeed(seed, t); //unique seed for each loop iteration
+    bool updated = step(buffers.particles, buffers.logWeights, buffers.weights, buffers.scratch, statistics,
+                        t > 1 ? y[t-2] : 0.0, y[t-1], seed, t, options.randomEngine, workspace.engine_, buffers.orderBuffers,
+                        workspace.blockBuffers_, pool);
+    SV_INSTRUMENT(recorder.recordStep(statistics, updated);)
+
+    logLikeSum += statistics.weightedLogLikelihood;
+    logEvidenceSum += statistics.logEvidence;
+
+    if (updated && statistics.effectiveSampleSize < options.essThreshold * nParticles) {
+      SV_INSTRUMENT(recorder.startResampling();)
+      bootstrap::resample(buffers, workspace.generator_, options.resamplingScheme, stateOrdered, loopSeed, resamplingPool);
+      SV_INSTRUMENT(recorder.finishResampling();)
+    }
+  }
+}
+
+
+template <typename Model>
+Particles BootstrapFilter<Model>::particleFilter(const SeriesRef& y, const unsigned int& nParticles, const unsigned int& seed,
+                                                 const FilterOptions& options) const {
+  if (options.precision == FilterPrecision::Single) {
+    ParticlesT<float> particles = trajectories<float>(y, nParticles, seed, options);
+    return Particles(Eigen::MatrixXd(particles.getParticlesAsEigenMatrix().cast<double>()),
+                     particles.getParticleLength(), options.particleLayout);
+  }
+
+  return trajectories<double>(y, nParticles, seed, options);
+}
+
+template <typename Model>
+double BootstrapFilter<Model>::logLikelihood(const SeriesRef& y, const unsigned int& nParticles, const unsigned int& seed,
+                                             const FilterOptions& options) const {
+  FilterWorkspace workspace(nParticles, options.precision);
+  return logLikelihood(y, nParticles, seed, options, workspace);
+}
+
+template <typename Model>
+double BootstrapFilter<Model>::logLikelihood(const SeriesRef& y, const unsigned int& nParticles, const unsigned int& seed,
+                                             const FilterOptions& options, FilterWorkspace& workspace) const {
+  double logLikeSum, logEvidenceSum;
+  if (options.precision == FilterPrecision::Single) {
+    logLikelihoods<float>(y, nParticles, seed, options, workspace, logLikeSum, logEvidenceSum);
+  } else {
+    logLikelihoods<double>(y, nParticles, seed, options, workspace, logLikeSum, logEvidenceSum);
+  }
+
+  return logLikeSum / y.size();
+}
+
+template <typename Model>
+double BootstrapFilter<Model>::logMarginalLikelihood(const SeriesRef& y, const unsigned int& nParticles, const unsigned int& seed,
+                                                     const FilterOptions& options) const {
+  FilterWorkspace workspace(nParticles, options.precision);
+  return logMarginalLikelihood(y, nParticles, seed, options, workspace);
+}
+
+template <typename Model>
+double BootstrapFilter<Model>::logMarginalLikelihood(const SeriesRef& y, const unsigned int& nParticles, const unsigned int& seed,
+                                                     const FilterOptions& options, FilterWorkspace& workspace) const {
+  double logLikeSum, logEvidenceSum;
+  if (options.precision == FilterPrecision::Single) {
+    logLikelihoods<float>(y, nParticles, seed, options, workspace, logLikeSum, logEvidenceSum);
+  } else {
+    logLikelihoods<double>(y, nParticles, seed, options, workspace, logLikeSum, logEvidenceSum);
+  }
+
+  return logEvidenceSum;
+}
+
+
+//every policy of sv_models.h in both precisions
+#define SV_INSTANTIATE_BOOTSTRAP_FILTER(Model) \
+  template class BootstrapFilter<Model>; \
+  template bool BootstrapFilter<Model>::step<double>(VectorT<double>&, VectorT<double>&, VectorT<double>&, VectorT<double>&, \
+                                                     FilterStepStatistics&, const double&, const double&, const unsigned int&, \
+                                                     const unsigned int&, const RandomEngine&, ReseedableMersenneTwister&, \
+                                                     StateOrderBuffers&, BlockBuffers&, ThreadPool*) const; \
+  template bool BootstrapFilter<Model>::step<float>(VectorT<float>&, VectorT<float>&, VectorT<float>&, VectorT<float>&, \
+                                                    FilterStepStatistics&, const double&, const double&, const unsigned int&, \
+                                                    const unsigned int&, const RandomEngine&, ReseedableMersenneTwister&, \
+                                                    StateOrderBuffers&, BlockBuffers&, ThreadPool*) const; \
+  template ParticlesT<double> BootstrapFilter<Model>::trajectories<double>(const SeriesRef&, const unsigned int&, \
+                                                                           const unsigned int&, const FilterOptions&) const; \
+  template ParticlesT<float> BootstrapFilter<Model>::trajectories<float>(const SeriesRef&, const unsigned int&, \
+                                                                         const unsigned int&, const FilterOptions&) const; \
+  template void BootstrapFilter<Model>::logLikelihoods<double>(const SeriesRef&, const unsigned int&, const unsigned int&, \
+                                                               const FilterOptions&, FilterWorkspace&, double&, double&) const; \
+  template void BootstrapFilter<Model>::logLikelihoods<float>(const SeriesRef&, const unsigned int&, const unsigned int&, \
+                                                              const FilterOptions&, FilterWorkspace&, double&, double&) const;
+
+SV_INSTANTIATE_BOOTSTRAP_FILTER(GaussianSV)
+SV_INSTANTIATE_BOOTSTRAP_FILTER(StudentTSV)
+SV_INSTANTIATE_BOOTSTRAP_FILTER(LeverageSV)
+
+#undef SV_INSTANTIATE_BOOTSTRAP_FILTER
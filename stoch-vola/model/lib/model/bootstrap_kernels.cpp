@@ -0,0 +1,166 @@
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+#include <Eigen/Dense>
+
+#include "model/bootstrap_kernels.h"
+#include "model/sv_models.h"
+
+
+namespace {
+  template <typename Scalar>
+  using Packet = typename Eigen::internal::packet_traits<Scalar>::type;
+
+  //number of leading elements that fill whole packets
+  template <typename Scalar>
+  long packedLength(const long& n) {
+    constexpr long size = Eigen::internal::packet_traits<Scalar>::size;
+    return n - n % size;
+  }
+}
+
+
+template <typename Scalar, typename Step>
+kernels::WeighResult kernels::propagateAndWeigh(Eigen::Ref<Eigen::Matrix<Scalar, Eigen::Dynamic, 1>> particles,
+                                                const Eigen::Ref<const Eigen::Matrix<Scalar, Eigen::Dynamic, 1>>& noise,
+                                                const Eigen::Ref<const Eigen::Matrix<Scalar, Eigen::Dynamic, 1>>& logWeights,
+                                                const Eigen::Ref<const Eigen::Matrix<Scalar, Eigen::Dynamic, 1>>& weights,
+                                                Eigen::Ref<Eigen::Matrix<Scalar, Eigen::Dynamic, 1>> out,
+                                                const Step& step) {
+  using namespace Eigen::internal;
+  using P = Packet<Scalar>;
+  constexpr long size = packet_traits<Scalar>::size;
+  const long n = particles.size();
+  const long packed = packedLength<Scalar>(n);
+
+  Scalar* x = particles.data();
+  const Scalar* z = noise.data();
+  const Scalar* previous = logWeights.data();
+  const Scalar* w = weights.data();
+  Scalar* updated = out.data();
+
+  const Scalar lowest = -std::numeric_limits<Scalar>::infinity();
+  const P zero = pset1<P>(Scalar(0));
+  P weighted = zero;
+  P maximum = pset1<P>(lowest);
+
+  for (long i = 0; i < packed; i += size) {
+    P particle = step.propagate(ploadu<P>(x + i), ploadu<P>(z + i));
+    P density = step.logDensity(particle);
+    P weight = ploadu<P>(w + i);
+    P logWeight = padd(ploadu<P>(previous + i), density);
+
+    pstoreu(x + i, particle);
+    pstoreu(updated + i, logWeight);
+    weighted = padd(weighted, pand(pcmp_lt(zero, weight), pmul(weight, density))); //0 * -inf must not give NaN
+    maximum = pmax(maximum, logWeight);
+  }
+
+  kernels::WeighResult result;
+  result.weightedLogLikelihood = packed > 0 ? predux(weighted) : Scalar(0);
+  result.maxLogWeight = packed > 0 ? predux_max(maximum) : lowest;
+
+  for (long i = packed; i < n; ++i) {
+    Scalar particle = step.propagate(x[i], z[i]);
+    Scalar density = step.logDensity(particle);
+    Scalar logWeight = previous[i] + density;
+
+    x[i] = particle;
+    updated[i] = logWeight;
+    result.weightedLogLikelihood += w[i] > Scalar(0) ? w[i] * density : Scalar(0);
+    result.maxLogWeight = std::max<double>(result.maxLogWeight, logWeight);
+  }
+
+  return result;
+}
+
+template <typename Scalar>
+kernels::ExponentiateResult kernels::exponentiate(const Eigen::Ref<const Eigen::Matrix<Scalar, Eigen::Dynamic, 1>>& logWeights,
+                                                  Eigen::Ref<Eigen::Matrix<Scalar, Eigen::Dynamic, 1>> weights,
+                                                  const double& maxLogWeight) {
+  using namespace Eigen::internal;
+  using P = Packet<Scalar>;
+  constexpr long size = packet_traits<Scalar>::size;
+  const long n = logWeights.size();
+  const long packed = packedLength<Scalar>(n);
+
+  const Scalar* logWeight = logWeights.data();
+  Scalar* weight = weights.data();
+  const Scalar shift = static_cast<Scalar>(maxLogWeight);
+  const P pShift = pset1<P>(shift);
+  P sum = pset1<P>(Scalar(0));
+  P squaredSum = sum;
+
+  for (long i = 0; i < packed; i += size) {
+    P value = pexp(psub(ploadu<P>(logWeight + i), pShift));
+    pstoreu(weight + i, value);
+    sum = padd(sum, value);
+    squaredSum = padd(squaredSum, pmul(value, value));
+  }
+
+  kernels::ExponentiateResult result;
+  result.weightSum = packed > 0 ? predux(sum) : Scalar(0);
+  result.squaredWeightSum = packed > 0 ? predux(squaredSum) : Scalar(0);
+
+  for (long i = packed; i < n; ++i) {
+    Scalar value = std::exp(logWeight[i] - shift);
+    weight[i] = value;
+    result.weightSum += value;
+    result.squaredWeightSum += value * value;
+  }
+
+  return result;
+}
+
+template <typename Scalar>
+void kernels::normalise(const Eigen::Ref<const Eigen::Matrix<Scalar, Eigen::Dynamic, 1>>& logWeights,
+                        Eigen::Ref<Eigen::Matrix<Scalar, Eigen::Dynamic, 1>> weights,
+                        Eigen::Ref<Eigen::Matrix<Scalar, Eigen::Dynamic, 1>> normalisedLogWeights,
+                        const double& weightSum, const double& logEvidence) {
+  using namespace Eigen::internal;
+  using P = Packet<Scalar>;
+  constexpr long size = packet_traits<Scalar>::size;
+  const long n = logWeights.size();
+  const long packed = packedLength<Scalar>(n);
+
+  const Scalar* logWeight = logWeights.data();
+  Scalar* weight = weights.data();
+  Scalar* normalised = normalisedLogWeights.data();
+  const Scalar sum = static_cast<Scalar>(weightSum);
+  const Scalar evidence = static_cast<Scalar>(logEvidence);
+  const P pSum = pset1<P>(sum), pEvidence = pset1<P>(evidence);
+
+  for (long i = 0; i < packed; i += size) {
+    pstoreu(weight + i, pdiv(ploadu<P>(weight + i), pSum));
+    pstoreu(normalised + i, psub(ploadu<P>(logWeight + i), pEvidence));
+  }
+  for (long i = packed; i < n; ++i) {
+    weight[i] /= sum;
+    normalised[i] = logWeight[i] - evidence;
+  }
+}
+
+
+//every policy of sv_models.h in both precisions
+#define SV_INSTANTIATE_PROPAGATE_AND_WEIGH(Scalar, Model) \
+  template kernels::WeighResult kernels::propagateAndWeigh<Scalar, Model::Step<Scalar>>( \
+      Eigen::Ref<Eigen::Matrix<Scalar, Eigen::Dynamic, 1>>, const Eigen::Ref<const Eigen::Matrix<Scalar, Eigen::Dynamic, 1>>&, \
+      const Eigen::Ref<const Eigen::Matrix<Scalar, Eigen::Dynamic, 1>>&, const Eigen::Ref<const Eigen::Matrix<Scalar, Eigen::Dynamic, 1>>&, \
+      Eigen::Ref<Eigen::Matrix<Scalar, Eigen::Dynamic, 1>>, const Model::Step<Scalar>&);
+
+SV_INSTANTIATE_PROPAGATE_AND_WEIGH(double, GaussianSV)
+SV_INSTANTIATE_PROPAGATE_AND_WEIGH(float, GaussianSV)
+SV_INSTANTIATE_PROPAGATE_AND_WEIGH(double, StudentTSV)
+SV_INSTANTIATE_PROPAGATE_AND_WEIGH(float, StudentTSV)
+SV_INSTANTIATE_PROPAGATE_AND_WEIGH(double, LeverageSV)
+SV_INSTANTIATE_PROPAGATE_AND_WEIGH(float, LeverageSV)
+
+#undef SV_INSTANTIATE_PROPAGATE_AND_WEIGH
+
+template kernels::ExponentiateResult kernels::exponentiate<double>(const Eigen::Ref<const Eigen::VectorXd>&, Eigen::Ref<Eigen::VectorXd>, const double&);
+template kernels::ExponentiateResult kernels::exponentiate<float>(const Eigen::Ref<const Eigen::VectorXf>&, Eigen::Ref<Eigen::VectorXf>, const double&);
+template void kernels::normalise<double>(const Eigen::Ref<const Eigen::VectorXd>&, Eigen::Ref<Eigen::VectorXd>, Eigen::Ref<Eigen::VectorXd>,
+                                         const double&, const double&);
+template void kernels::normalise<float>(const Eigen::Ref<const Eigen::VectorXf>&, Eigen::Ref<Eigen::VectorXf>, Eigen::Ref<Eigen::VectorXf>,
+                                        const double&, const double&);
@@ -0,0 +1,100 @@
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <stdexcept>
+
+#include <Eigen/Dense>
+
+#include "model/filter_executor.h"
+#include "model/filter_workspace.h"
+#include "model/stochastic_volatility_model.h"
+
+
+FilterExecutor::FilterExecutor(const unsigned int& threadCount) : stopping_(false) {
+  if (threadCount == 0) {
+    throw std::invalid_argument("Thread count must be greater than zero.");
+  }
+
+  for (unsigned int i = 0; i < threadCount; ++i) {
+    workers_.emplace_back(&FilterExecutor::workerLoop, this);
+  }
+}
+
+FilterExecutor::~FilterExecutor() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  taskCondition_.notify_all();
+
+  for (std::thread& worker : workers_) {
+    worker.join();
+  }
+}
+
+
+void FilterExecutor::workerLoop() {
+  FilterWorkspace workspace;
+
+  while (true) {
+    std::packaged_task<double(FilterWorkspace&)> task;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      taskCondition_.wait(lock, [&] { return stopping_ || !tasks_.empty(); });
+      if (tasks_.empty()) {//stopping with nothing left to do
+        return;
+      }
+      task = std::move(tasks_.front());
+      tasks_.pop_front();
+    }
+
+    task(workspace); //exceptions end up in the future
+  }
+}
+
+std::shared_future<double> FilterExecutor::enqueue(std::packaged_task<double(FilterWorkspace&)> task) {
+  std::shared_future<double> result = task.get_future().share();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tasks_.push_back(std::move(task));
+  }
+  taskCondition_.notify_one();
+
+  return result;
+}
+
+
+std::shared_future<double> FilterExecutor::submitLogLikelihood(const SeriesRef& y, const Eigen::Vector3d& parameters,
+                                                               const unsigned int& nParticles, const unsigned int& seed,
+                                                               const FilterOptions& options) {
+  Eigen::VectorXd series = y;
+  return enqueue(std::packaged_task<double(FilterWorkspace&)>(
+    [series, parameters, nParticles, seed, options](FilterWorkspace& workspace) {
+      StochasticVolatilityModel model(parameters(0), parameters(1), parameters(2));
+      return model.logLikelihood(series, nParticles, seed, options, workspace);
+    }));
+}
+
+std::shared_future<double> FilterExecutor::submitLogMarginalLikelihood(const SeriesRef& y, const Eigen::Vector3d& parameters,
+                                                                       const unsigned int& nParticles, const unsigned int& seed,
+                                                                       const FilterOptions& options) {
+  Eigen::VectorXd series = y;
+  return enqueue(std::packaged_task<double(FilterWorkspace&)>(
+    [series, parameters, nParticles, seed, options](FilterWorkspace& workspace) {
+      StochasticVolatilityModel model(parameters(0), parameters(1), parameters(2));
+      return model.logMarginalLikelihood(series, nParticles, seed, options, workspace);
+    }));
+}
+
+
+unsigned int FilterExecutor::getThreadCount() const {
+  return workers_.size();
+}
+
+unsigned int FilterExecutor::getQueuedCount() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return tasks_.size();
+}
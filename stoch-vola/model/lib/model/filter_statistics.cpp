@@ -0,0 +1,85 @@
+#include <vector>
+#include <chrono>
+#include <limits>
+#include <cstddef>
+
+#include "model/filter_statistics.h"
+#include "model/stochastic_volatility_model.h"
+#include "statistics/allocation_counter.h"
+
+
+void FilterStatistics::reset() {
+  noiseSeconds = propagateSeconds = weightSeconds = normaliseSeconds = resampleSeconds = totalSeconds = 0.0;
+  effectiveSampleSizes.clear(); //keeps the capacity, so a reused object records without allocating
+  stepCount = resampleCount = degenerateStepCount = 0;
+  allocationCount = 0;
+}
+
+bool FilterStatistics::isEnabled() {
+#ifdef SV_FILTER_INSTRUMENTATION
+  return true;
+#else
+  return false;
+#endif
+}
+
+
+StageTimer::StageTimer() : last_(std::chrono::steady_clock::now()) {}
+
+double StageTimer::lap() {
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  std::chrono::duration<double> elapsed = now - last_;
+  last_ = now;
+  return elapsed.count();
+}
+
+
+FilterRecorder::FilterRecorder(FilterStatistics* statistics, const unsigned int& T)
+    : statistics_(statistics), allocationsAtStart_(0) {
+  if (statistics_) {
+#ifdef SV_FILTER_INSTRUMENTATION
+    allocationcounter::enable();
+    allocationsAtStart_ = allocationcounter::count();
+#endif
+    statistics_->reset();
+    statistics_->effectiveSampleSizes.reserve(T);
+  }
+}
+
+FilterRecorder::~FilterRecorder() {
+  if (statistics_) {
+    statistics_->totalSeconds = total_.lap();
+#ifdef SV_FILTER_INSTRUMENTATION
+    statistics_->allocationCount = allocationcounter::count() - allocationsAtStart_;
+    allocationcounter::disable();
+#endif
+  }
+}
+
+void FilterRecorder::recordStep(FilterStepStatistics& step, const bool& updated) {
+  if (statistics_) {
+    statistics_->noiseSeconds += step.noiseSeconds;
+    statistics_->propagateSeconds += step.propagateSeconds;
+    statistics_->weightSeconds += step.weightSeconds;
+    statistics_->normaliseSeconds += step.normaliseSeconds;
+    statistics_->resampleSeconds += step.resampleSeconds;
+    statistics_->resampleCount += step.resampled;
+    statistics_->degenerateStepCount += !updated;
+    statistics_->effectiveSampleSizes.push_back(updated ? step.effectiveSampleSize
+                                                        : std::numeric_limits<double>::quiet_NaN());
+    statistics_->stepCount++;
+  }
+  step.noiseSeconds = step.propagateSeconds = step.weightSeconds = step.normaliseSeconds = step.resampleSeconds = 0.0;
+  step.resampled = false;
+}
+
+void FilterRecorder::startResampling() {
+  resampling_.lap();
+}
+
+void FilterRecorder::finishResampling() {
+  if (statistics_) {
+    statistics_->resampleSeconds += resampling_.lap();
+    statistics_->resampleCount++;
+  }
+}
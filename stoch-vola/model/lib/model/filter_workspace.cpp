@@ -0,0 +1,104 @@
+#include <random>
+#include <type_traits>
+
+#include <Eigen/Dense>
+
+#include "model/filter_workspace.h"
+#include "model/stochastic_volatility_model.h"
+#include "statistics/random_engine.h"
+#include "statistics/thread_pool.h"
+
+
+namespace {
+  const Eigen::VectorXd& asDouble(const Eigen::VectorXd& values, Eigen::VectorXd&) {
+    return values;
+  }
+
+  const Eigen::VectorXd& asDouble(const Eigen::VectorXf& values, Eigen::VectorXd& copy) {
+    copy = values.cast<double>();
+    return copy;
+  }
+}
+
+
+template <typename Scalar>
+void FilterBuffers<Scalar>::resize(const unsigned int& nParticles) {
+  if (particles.size() == nParticles) {
+    return;
+  }
+
+  particles.resize(nParticles);
+  logWeights.resize(nParticles);
+  weights.resize(nParticles);
+  scratch.resize(nParticles);
+  gathered.resize(nParticles);
+  resamplingWeights.resize(std::is_same<Scalar, double>::value ? 0 : nParticles);
+  uniforms.resize(nParticles);
+  residuals.resize(nParticles);
+  ancestors.resize(nParticles);
+  orderBuffers.reserve(nParticles);
+  means.resize(nParticles);
+  modes.resize(nParticles);
+  scaled.resize(nParticles);
+  precisions.resize(nParticles);
+  shifts.resize(nParticles);
+}
+
+template <typename Scalar>
+const Eigen::VectorXd& FilterBuffers<Scalar>::doubleWeights() {
+  return asDouble(weights, resamplingWeights);
+}
+
+template struct FilterBuffers<double>;
+template struct FilterBuffers<float>;
+
+
+void BlockBuffers::resize(const unsigned int& blocks) {
+  engines.resize(blocks);
+  maxLogWeights.resize(blocks);
+  weightedLogLikelihoods.resize(blocks);
+  weightSums.resize(blocks);
+  squaredWeightSums.resize(blocks);
+}
+
+
+FilterWorkspace::FilterWorkspace(const unsigned int& nParticles, const FilterPrecision& precision) {
+  reserve(nParticles, precision);
+}
+
+void FilterWorkspace::reserve(const unsigned int& nParticles, const FilterPrecision& precision) {
+  if (precision == FilterPrecision::Single) {
+    singleBuffers_.resize(nParticles);
+  } else {
+    doubleBuffers_.resize(nParticles);
+  }
+}
+
+ThreadPool* FilterWorkspace::pool(const unsigned int& threadCount) {
+  if (threadCount <= 1) {
+    return nullptr;
+  }
+  if (!pool_ || pool_->getThreadCount() != threadCount) {
+    pool_.reset(new ThreadPool(threadCount));
+    blockBuffers_.resize(threadCount);
+  }
+  return pool_.get();
+}
+
+unsigned int FilterWorkspace::getParticleCount(const FilterPrecision& precision) const {
+  if (precision == FilterPrecision::Single) {
+    return singleBuffers_.particles.size();
+  }
+  return doubleBuffers_.particles.size();
+}
+
+
+template <>
+FilterBuffers<double>& FilterWorkspace::buffers<double>() {
+  return doubleBuffers_;
+}
+
+template <>
+FilterBuffers<float>& FilterWorkspace::buffers<float>() {
+  return singleBuffers_;
+}
@@ -0,0 +1,120 @@
+#include <vector>
+#include <cmath>
+#include <random>
+#include <algorithm>
+#include <stdexcept>
+
+#include <Eigen/Dense>
+
+#include "model/pmmh_sampler.h"
+#include "model/stochastic_volatility_model.h"
+#include "model/filter_workspace.h"
+#include "statistics/normal_distribution.h"
+#include "statistics/thread_pool.h"
+
+
+PMMHSampler::PMMHSampler(const SeriesRef& y, const unsigned int& nParticles, const Eigen::Vector3d& proposalScales,
+                         const Eigen::Vector3d& priorStdDevs, const FilterOptions& options)
+    : y_(y), particleCount_(nParticles), proposalScales_(proposalScales), priorStdDevs_(priorStdDevs), options_(options) {
+  if (nParticles == 0) {
+    throw std::invalid_argument("Number of particles must be greater than zero.");
+  }
+  if (proposalScales.minCoeff() < 0.0) {
+    throw std::invalid_argument("Proposal scales must be non-negative.");
+  }
+  if (priorStdDevs.minCoeff() <= 0.0) {
+    throw std::invalid_argument("Prior standard deviations must be positive.");
+  }
+}
+
+
+double PMMHSampler::logPrior(const Eigen::Vector3d& parameters) const {
+  double logDensity = 0.0;
+  for (int i = 0; i < 3; ++i) {
+    logDensity += NormalDistribution(0.0, priorStdDevs_[i]).logLikelihood(parameters[i]);
+  }
+
+  return logDensity;
+}
+
+double PMMHSampler::logMarginalLikelihood(const Eigen::Vector3d& parameters, const unsigned int& seed,
+                                          FilterWorkspace& workspace) const {
+  StochasticVolatilityModel model(parameters[0], parameters[1], parameters[2]);
+  return model.logMarginalLikelihood(y_, particleCount_, seed, options_, workspace);
+}
+
+
+void PMMHSampler::runChain(const Eigen::Vector3d& initialParameters, const unsigned int& chain, const unsigned int& seed,
+                           PMMHResult& result) const {
+  std::mt19937 generator(static_cast<unsigned int>(ThreadPool::blockSeed(seed, chain)));
+  std::normal_distribution<double> normal(0.0, 1.0);
+  std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+  Eigen::MatrixXd& samples = result.chains[chain];
+  const long nIterations = samples.rows();
+
+  //one filter workspace per chain, reused by every likelihood evaluation
+  FilterWorkspace workspace(particleCount_, options_.precision);
+
+  Eigen::Vector3d current = initialParameters;
+  double currentLogLike = logMarginalLikelihood(current, generator(), workspace);
+  double currentLogTarget = currentLogLike + logPrior(current);
+  if (!std::isfinite(currentLogTarget)) {
+    throw std::invalid_argument("Initial parameters must have a finite log-likelihood.");
+  }
+
+  long accepted = 0;
+  for (long i = 0; i < nIterations; ++i) {
+    Eigen::Vector3d proposal;
+    for (int k = 0; k < 3; ++k) {
+      proposal[k] = current[k] + proposalScales_[k] * normal(generator);
+    }
+
+    //fresh filter randomness for every proposal, the current estimate is kept as it is
+    const double proposalLogLike = logMarginalLikelihood(proposal, generator(), workspace);
+    const double proposalLogTarget = proposalLogLike + logPrior(proposal);
+
+    if (std::isfinite(proposalLogTarget) && std::log(uniform(generator)) < proposalLogTarget - currentLogTarget) {
+      current = proposal;
+      currentLogLike = proposalLogLike;
+      currentLogTarget = proposalLogTarget;
+      accepted++;
+    }
+
+    samples.row(i) = current.transpose();
+    result.logMarginalLikelihoods(i, chain) = currentLogLike;
+  }
+
+  result.acceptanceRates[chain] = static_cast<double>(accepted) / nIterations;
+}
+
+
+PMMHResult PMMHSampler::sample(const Eigen::Vector3d& initialParameters, const unsigned int& nIterations,
+                               const unsigned int& nChains, const unsigned int& seed,
+                               const unsigned int& threadCount) const {
+  if (nChains == 0) {
+    throw std::invalid_argument("Number of chains must be greater than zero.");
+  }
+  if (nIterations == 0) {
+    throw std::invalid_argument("Number of iterations must be greater than zero.");
+  }
+
+  PMMHResult result;
+  result.chains.assign(nChains, Eigen::MatrixXd(nIterations, 3));
+  result.logMarginalLikelihoods.resize(nIterations, nChains);
+  result.acceptanceRates.resize(nChains);
+
+  //chains are independent, every thread runs a contiguous block of them
+  ThreadPool pool(std::max(1u, std::min(threadCount, nChains)));
+  const unsigned int blocks = pool.getThreadCount();
+
+  pool.run([&](unsigned int block) {
+    const long begin = ThreadPool::blockBegin(nChains, blocks, block);
+    const long end = ThreadPool::blockBegin(nChains, blocks, block + 1);
+    for (long chain = begin; chain < end; ++chain) {
+      runChain(initialParameters, static_cast<unsigned int>(chain), seed, result);
+    }
+  });
+
+  return result;
+}
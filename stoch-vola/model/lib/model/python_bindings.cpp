@@ -0,0 +1,394 @@
+#include <memory>
+#include <string>
+#include <stdexcept>
+#include <future>
+#include <chrono>
+
+#include <Eigen/Dense>
+
+#include "pybind11/pybind11.h"
+#include "pybind11/eigen.h"
+#include "pybind11/numpy.h"
+#include "pybind11/stl.h"
+
+#include "model/stochastic_volatility_model.h"
+#include "model/bootstrap_filter.h"
+#include "model/filter_executor.h"
+#include "model/filter_statistics.h"
+#include "model/filter_workspace.h"
+#include "model/sv_filter_state.h"
+#include "model/pmmh_sampler.h"
+#include "statistics/mapped_file.h"
+#include "statistics/particles.h"
+#include "statistics/resampling.h"
+
+
+namespace py = pybind11;
+
+namespace {
+  //Read-only time x particles buffer over the stored particles, Genealogy storage is traced in place first.
+  //The strides follow the layout: TimeMajor reads as a C-contiguous array, TraceMajor as a Fortran-ordered one.
+  template <typename Scalar>
+  py::buffer_info particlesBuffer(ParticlesT<Scalar>& particles) {
+    particles.setPathStorage(PathStorage::Copy);
+
+    Eigen::Map<const typename ParticlesT<Scalar>::Matrix> storage = particles.getStorage();
+    const bool timeMajor = particles.getLayout() == ParticleLayout::TimeMajor;
+    const py::ssize_t itemSize = sizeof(Scalar);
+    const py::ssize_t rowStride = timeMajor ? itemSize * storage.rows() : itemSize;
+    const py::ssize_t columnStride = timeMajor ? itemSize : itemSize * storage.rows();
+
+    return py::buffer_info(const_cast<Scalar*>(storage.data()), itemSize, py::format_descriptor<Scalar>::format(), 2,
+                           {static_cast<py::ssize_t>(particles.getParticleLength()),
+                            static_cast<py::ssize_t>(particles.getParticleCount())},
+                           {rowStride, columnStride}, true);
+  }
+
+  //numpy.asarray(particles) goes through the buffer protocol, getParticlesView returns the same view
+  //directly; both keep the Python object alive. getParticles still returns a copy.
+  template <typename Scalar>
+  void bindParticles(py::module_& m, const char* name) {
+	py::class_<ParticlesT<Scalar>>(m, name, py::buffer_protocol())
+		.def_buffer(&particlesBuffer<Scalar>)
+		.def("getParticles", &ParticlesT<Scalar>::getParticlesAsEigenMatrix)
+		.def("getParticlesView", [](py::object self) {
+				py::array view(particlesBuffer(self.cast<ParticlesT<Scalar>&>()), self);
+				view.attr("setflags")(py::arg("write") = false);
+				return view;
+			})
+		.def("getParticleCount", &ParticlesT<Scalar>::getParticleCount)
+		.def("getParticleLength", &ParticlesT<Scalar>::getParticleLength)
+		.def("particleMeans", &ParticlesT<Scalar>::particleMeans,
+				py::arg("threadCount") = 1,
+				py::call_guard<py::gil_scoped_release>())
+		.def("particleVariances", &ParticlesT<Scalar>::particleVariances,
+				py::arg("threadCount") = 1,
+				py::call_guard<py::gil_scoped_release>())
+		.def("particleQuantiles", &ParticlesT<Scalar>::particleQuantiles,
+				py::arg("probabilities"),
+				py::arg("threadCount") = 1,
+				py::call_guard<py::gil_scoped_release>())
+		.def("getLayout", &ParticlesT<Scalar>::getLayout)
+		.def("getStorageFile", &ParticlesT<Scalar>::getStorageFile)
+		.def("setStorageFile", &ParticlesT<Scalar>::setStorageFile, py::arg("path"))
+		.def_static("openStorageFile", &ParticlesT<Scalar>::openStorageFile, py::arg("path"))
+		.def("save", &ParticlesT<Scalar>::save, py::arg("path"), py::call_guard<py::gil_scoped_release>())
+		.def_static("load", &ParticlesT<Scalar>::load, py::arg("path"), py::call_guard<py::gil_scoped_release>());
+  }
+
+  //filters of the models run on BootstrapFilter, which take the Bootstrap proposal only
+  template <typename Model>
+  void bindBootstrapFilter(py::class_<BootstrapFilter<Model>>& model) {
+	using Filter = BootstrapFilter<Model>;
+	model
+		.def("particleFilter", &Filter::particleFilter,
+				py::call_guard<py::gil_scoped_release>(),
+				py::arg("y"),
+				py::arg("nParticles"),
+				py::arg("seed") = 123,
+				py::arg("options") = FilterOptions())
+		.def("logLikelihood", py::overload_cast<const SeriesRef&, const unsigned int&, const unsigned int&,
+				                                 const FilterOptions&>(&Filter::logLikelihood, py::const_),
+				py::call_guard<py::gil_scoped_release>(),
+				py::arg("y"),
+				py::arg("nParticles"),
+				py::arg("seed") = 123,
+				py::arg("options") = FilterOptions())
+		.def("logLikelihood", py::overload_cast<const SeriesRef&, const unsigned int&, const unsigned int&,
+				                                 const FilterOptions&, FilterWorkspace&>(&Filter::logLikelihood, py::const_),
+				py::call_guard<py::gil_scoped_release>(),
+				py::arg("y"),
+				py::arg("nParticles"),
+				py::arg("seed"),
+				py::arg("options"),
+				py::arg("workspace"))
+		.def("logMarginalLikelihood", py::overload_cast<const SeriesRef&, const unsigned int&, const unsigned int&,
+				                                         const FilterOptions&>(&Filter::logMarginalLikelihood, py::const_),
+				py::call_guard<py::gil_scoped_release>(),
+				py::arg("y"),
+				py::arg("nParticles"),
+				py::arg("seed") = 123,
+				py::arg("options") = FilterOptions())
+		.def("logMarginalLikelihood", py::overload_cast<const SeriesRef&, const unsigned int&, const unsigned int&,
+				                                         const FilterOptions&, FilterWorkspace&>(&Filter::logMarginalLikelihood, py::const_),
+				py::call_guard<py::gil_scoped_release>(),
+				py::arg("y"),
+				py::arg("nParticles"),
+				py::arg("seed"),
+				py::arg("options"),
+				py::arg("workspace"));
+  }
+
+  //numpy.memmap over the particles of a trajectory file, time x particles whatever the layout
+  py::object trajectoryMemmap(const std::string& path, const std::string& mode) {
+	TrajectoryFileHeader header = trajectoryfile::readHeader(path);
+	if (header.pathStorage == 1) {
+		throw std::invalid_argument("Trajectory file still holds Genealogy storage, its rows are not trajectories yet.");
+	}
+	return py::module_::import("numpy").attr("memmap")(path,
+			py::arg("dtype") = header.scalarSize == 4 ? "float32" : "float64",
+			py::arg("mode") = mode,
+			py::arg("offset") = header.dataOffset,
+			py::arg("shape") = py::make_tuple(header.particleLength, header.particleCount),
+			py::arg("order") = header.layout == 1 ? "C" : "F");
+  }
+}
+
+PYBIND11_MODULE(stochastic_volatility_model,m) {
+	py::enum_<ResamplingScheme>(m, "ResamplingScheme")
+		.value("Multinomial", ResamplingScheme::Multinomial)
+		.value("Stratified", ResamplingScheme::Stratified)
+		.value("Systematic", ResamplingScheme::Systematic)
+		.value("Residual", ResamplingScheme::Residual);
+
+	py::enum_<FilterProposal>(m, "FilterProposal")
+		.value("Bootstrap", FilterProposal::Bootstrap)
+		.value("Auxiliary", FilterProposal::Auxiliary);
+
+	py::enum_<ParticleLayout>(m, "ParticleLayout")
+		.value("TraceMajor", ParticleLayout::TraceMajor)
+		.value("TimeMajor", ParticleLayout::TimeMajor);
+
+	py::enum_<FilterPrecision>(m, "FilterPrecision")
+		.value("Double", FilterPrecision::Double)
+		.value("Single", FilterPrecision::Single);
+
+	py::enum_<RandomEngine>(m, "RandomEngine")
+		.value("MersenneTwister", RandomEngine::MersenneTwister)
+		.value("Philox", RandomEngine::Philox)
+		.value("Sobol", RandomEngine::Sobol);
+
+	py::class_<FilterStatistics, std::shared_ptr<FilterStatistics>>(m, "FilterStatistics")
+		.def(py::init<>())
+		.def_readonly("noiseSeconds", &FilterStatistics::noiseSeconds)
+		.def_readonly("propagateSeconds", &FilterStatistics::propagateSeconds)
+		.def_readonly("weightSeconds", &FilterStatistics::weightSeconds)
+		.def_readonly("normaliseSeconds", &FilterStatistics::normaliseSeconds)
+		.def_readonly("resampleSeconds", &FilterStatistics::resampleSeconds)
+		.def_readonly("totalSeconds", &FilterStatistics::totalSeconds)
+		.def_readonly("effectiveSampleSizes", &FilterStatistics::effectiveSampleSizes)
+		.def_readonly("stepCount", &FilterStatistics::stepCount)
+		.def_readonly("resampleCount", &FilterStatistics::resampleCount)
+		.def_readonly("degenerateStepCount", &FilterStatistics::degenerateStepCount)
+		.def_readonly("allocationCount", &FilterStatistics::allocationCount)
+		.def("reset", &FilterStatistics::reset)
+		.def_static("isEnabled", &FilterStatistics::isEnabled);
+
+	py::class_<FilterOptions>(m, "FilterOptions")
+		.def(py::init<>())
+		.def_readwrite("proposal", &FilterOptions::proposal)
+		.def_readwrite("resamplingScheme", &FilterOptions::resamplingScheme)
+		.def_readwrite("threadCount", &FilterOptions::threadCount)
+		.def_readwrite("essThreshold", &FilterOptions::essThreshold)
+		.def_readwrite("particleLayout", &FilterOptions::particleLayout)
+		.def_readwrite("precision", &FilterOptions::precision)
+		.def_readwrite("randomEngine", &FilterOptions::randomEngine)
+		.def_readwrite("statistics", &FilterOptions::statistics)
+		.def_readwrite("storageFile", &FilterOptions::storageFile);
+
+	py::class_<MappedSeries>(m, "MappedSeries", py::buffer_protocol())
+		.def(py::init<const std::string&, const std::size_t&>(),
+				py::arg("path"),
+				py::arg("offset") = 0)
+		.def_buffer([](MappedSeries& series) {
+				return py::buffer_info(const_cast<double*>(series.getSeries().data()), series.size(), true);
+			})
+		.def("size", &MappedSeries::size);
+
+	m.def("trajectoryMemmap", &trajectoryMemmap,
+			py::arg("path"),
+			py::arg("mode") = "r");
+
+	py::class_<FilterWorkspace>(m, "FilterWorkspace")
+		.def(py::init<const unsigned int&, const FilterPrecision&>(),
+				py::arg("nParticles") = 0,
+				py::arg("precision") = FilterPrecision::Double)
+		.def("reserve", &FilterWorkspace::reserve,
+				py::arg("nParticles"),
+				py::arg("precision") = FilterPrecision::Double)
+		.def("getParticleCount", &FilterWorkspace::getParticleCount,
+				py::arg("precision") = FilterPrecision::Double);
+
+	py::class_<StochasticVolatilityModel>(m, "StochasticVolatilityModel")
+		.def(py::init<double, double, double>(),
+				py::arg("mu") = 0.0,
+				py::arg("phi") = 0.0,
+				py::arg("sigma") = 0.0)
+		.def("particleFilter", &StochasticVolatilityModel::particleFilter,
+				py::call_guard<py::gil_scoped_release>(),
+				py::arg("y"),
+				py::arg("nParticles"),
+				py::arg("seed") = 123,
+				py::arg("options") = FilterOptions())
+		.def("particleFilterSingle", &StochasticVolatilityModel::particleFilterSingle,
+				py::call_guard<py::gil_scoped_release>(),
+				py::arg("y"),
+				py::arg("nParticles"),
+				py::arg("seed") = 123,
+				py::arg("options") = FilterOptions())
+		.def("logLikelihood", py::overload_cast<const SeriesRef&, const unsigned int&, const unsigned int&,
+				                                 const FilterOptions&>(&StochasticVolatilityModel::logLikelihood, py::const_),
+				py::call_guard<py::gil_scoped_release>(),
+				py::arg("y"),
+				py::arg("nParticles"),
+				py::arg("seed") = 123,
+				py::arg("options") = FilterOptions())
+		.def("logLikelihood", py::overload_cast<const SeriesRef&, const unsigned int&, const unsigned int&,
+				                                 const FilterOptions&, FilterWorkspace&>(&StochasticVolatilityModel::logLikelihood, py::const_),
+				py::call_guard<py::gil_scoped_release>(),
+				py::arg("y"),
+				py::arg("nParticles"),
+				py::arg("seed"),
+				py::arg("options"),
+				py::arg("workspace"))
+		.def("particleSmoother", &StochasticVolatilityModel::particleSmoother,
+				py::call_guard<py::gil_scoped_release>(),
+				py::arg("y"),
+				py::arg("nParticles"),
+				py::arg("nTrajectories"),
+				py::arg("seed") = 123,
+				py::arg("options") = FilterOptions())
+		.def("logMarginalLikelihood", py::overload_cast<const SeriesRef&, const unsigned int&, const unsigned int&,
+				                                         const FilterOptions&>(&StochasticVolatilityModel::logMarginalLikelihood, py::const_),
+				py::call_guard<py::gil_scoped_release>(),
+				py::arg("y"),
+				py::arg("nParticles"),
+				py::arg("seed") = 123,
+				py::arg("options") = FilterOptions())
+		.def("logMarginalLikelihood", py::overload_cast<const SeriesRef&, const unsigned int&, const unsigned int&,
+				                                         const FilterOptions&, FilterWorkspace&>(&StochasticVolatilityModel::logMarginalLikelihood, py::const_),
+				py::call_guard<py::gil_scoped_release>(),
+				py::arg("y"),
+				py::arg("nParticles"),
+				py::arg("seed"),
+				py::arg("options"),
+				py::arg("workspace"))
+		.def_static("batchLogLikelihood", &StochasticVolatilityModel::batchLogLikelihood,
+				py::call_guard<py::gil_scoped_release>(),
+				py::arg("parameters"),
+				py::arg("y"),
+				py::arg("nParticles"),
+				py::arg("seed") = 123,
+				py::arg("options") = FilterOptions())
+		.def_static("batchFilter", &StochasticVolatilityModel::batchFilter,
+				py::call_guard<py::gil_scoped_release>(),
+				py::arg("parameters"),
+				py::arg("y"),
+				py::arg("nParticles"),
+				py::arg("seed") = 123,
+				py::arg("options") = FilterOptions());
+
+	//unconstrained parameters as in StochasticVolatilityModel, nu enters as log(nu - 2) and rho as atanh(rho)
+	py::class_<StudentTStochasticVolatilityModel> studentT(m, "StudentTStochasticVolatilityModel");
+	studentT.def(py::init([](double mu, double phi, double sigma, double nu) {
+				return StudentTStochasticVolatilityModel(StudentTSV::fromUnconstrained(Eigen::Vector4d(mu, phi, sigma, nu)));
+			}),
+			py::arg("mu") = 0.0,
+			py::arg("phi") = 0.0,
+			py::arg("sigma") = 0.0,
+			py::arg("nu") = 0.0);
+	bindBootstrapFilter(studentT);
+
+	py::class_<LeverageStochasticVolatilityModel> leverage(m, "LeverageStochasticVolatilityModel");
+	leverage.def(py::init([](double mu, double phi, double sigma, double rho) {
+				return LeverageStochasticVolatilityModel(LeverageSV::fromUnconstrained(Eigen::Vector4d(mu, phi, sigma, rho)));
+			}),
+			py::arg("mu") = 0.0,
+			py::arg("phi") = 0.0,
+			py::arg("sigma") = 0.0,
+			py::arg("rho") = 0.0);
+	bindBootstrapFilter(leverage);
+
+	m.def("batchLogLikelihood", &StochasticVolatilityModel::batchLogLikelihood,
+			py::call_guard<py::gil_scoped_release>(),
+			py::arg("parameters"),
+			py::arg("y"),
+			py::arg("nParticles"),
+			py::arg("seed") = 123,
+			py::arg("options") = FilterOptions());
+
+	py::class_<BatchFilterResult>(m, "BatchFilterResult")
+		.def_readonly("logLikelihoods", &BatchFilterResult::logLikelihoods)
+		.def_readonly("logMarginalLikelihoods", &BatchFilterResult::logMarginalLikelihoods)
+		.def_readonly("observationCounts", &BatchFilterResult::observationCounts)
+		.def_readonly("filteredMeans", &BatchFilterResult::filteredMeans)
+		.def_readonly("filteredStdDevs", &BatchFilterResult::filteredStdDevs);
+
+	m.def("batchFilter", &StochasticVolatilityModel::batchFilter,
+			py::call_guard<py::gil_scoped_release>(),
+			py::arg("parameters"),
+			py::arg("y"),
+			py::arg("nParticles"),
+			py::arg("seed") = 123,
+			py::arg("options") = FilterOptions());
+
+	bindParticles<double>(m, "Particles");
+	bindParticles<float>(m, "ParticlesSingle");
+
+	py::class_<SVFilterState>(m, "SVFilterState")
+		.def(py::init<const StochasticVolatilityModel&, const unsigned int&, const unsigned int&, const FilterOptions&>(),
+				py::arg("model"),
+				py::arg("nParticles"),
+				py::arg("seed") = 123,
+				py::arg("options") = FilterOptions())
+		.def("step", &SVFilterState::step, py::arg("y"), py::call_guard<py::gil_scoped_release>())
+		.def("getLogLikelihood", &SVFilterState::getLogLikelihood)
+		.def("getFilteredMean", &SVFilterState::getFilteredMean)
+		.def("getFilteredQuantile", &SVFilterState::getFilteredQuantile, py::arg("q"))
+		.def("getFilteredQuantiles", &SVFilterState::getFilteredQuantiles, py::arg("probabilities"))
+		.def("getEffectiveSampleSize", &SVFilterState::getEffectiveSampleSize)
+		.def("getParticles", &SVFilterState::getParticles)
+		.def("getWeights", &SVFilterState::getWeights)
+		.def("getStepCount", &SVFilterState::getStepCount)
+		.def("save", &SVFilterState::save, py::arg("path"), py::call_guard<py::gil_scoped_release>())
+		.def_static("load", &SVFilterState::load, py::arg("path"), py::call_guard<py::gil_scoped_release>());
+
+	py::class_<PMMHResult>(m, "PMMHResult")
+		.def_readonly("chains", &PMMHResult::chains)
+		.def_readonly("logMarginalLikelihoods", &PMMHResult::logMarginalLikelihoods)
+		.def_readonly("acceptanceRates", &PMMHResult::acceptanceRates);
+
+	py::class_<PMMHSampler>(m, "PMMHSampler")
+		.def(py::init<const Eigen::VectorXd&, const unsigned int&, const Eigen::Vector3d&, const Eigen::Vector3d&, const FilterOptions&>(),
+				py::arg("y"),
+				py::arg("nParticles"),
+				py::arg("proposalScales"),
+				py::arg("priorStdDevs") = Eigen::Vector3d::Constant(10.0),
+				py::arg("options") = FilterOptions())
+		.def("sample", &PMMHSampler::sample,
+				py::call_guard<py::gil_scoped_release>(),
+				py::arg("initialParameters"),
+				py::arg("nIterations"),
+				py::arg("nChains") = 4,
+				py::arg("seed") = 123,
+				py::arg("threadCount") = 4);
+
+	//result() and wait() block without the GIL, so other Python threads keep running meanwhile
+	py::class_<std::shared_future<double>>(m, "FilterFuture")
+		.def("result", [](const std::shared_future<double>& future) {
+				return future.get();
+			}, py::call_guard<py::gil_scoped_release>())
+		.def("wait", [](const std::shared_future<double>& future) {
+				future.wait();
+			}, py::call_guard<py::gil_scoped_release>())
+		.def("done", [](const std::shared_future<double>& future) {
+				return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+			});
+
+	py::class_<FilterExecutor>(m, "FilterExecutor")
+		.def(py::init<const unsigned int&>(), py::arg("threadCount"))
+		.def("submitLogLikelihood", &FilterExecutor::submitLogLikelihood,
+				py::arg("y"),
+				py::arg("parameters"),
+				py::arg("nParticles"),
+				py::arg("seed") = 123,
+				py::arg("options") = FilterOptions())
+		.def("submitLogMarginalLikelihood", &FilterExecutor::submitLogMarginalLikelihood,
+				py::arg("y"),
+				py::arg("parameters"),
+				py::arg("nParticles"),
+				py::arg("seed") = 123,
+				py::arg("options") = FilterOptions())
+		.def("getThreadCount", &FilterExecutor::getThreadCount)
+		.def("getQueuedCount", &FilterExecutor::getQueuedCount);
+}
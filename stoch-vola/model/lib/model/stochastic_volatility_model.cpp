@@ -1,107 +1,788 @@
 #include <vector>
 #include <cmath>
+#include <memory>
+#include <string>
+#include <random>
+#include <algorithm>
+#include <limits>
+#include <numeric>
 #include <stdexcept>
 
 #include <Eigen/Dense>
-
-#include "pybind11/pybind11.h"
-#include "pybind11/eigen.h"
-#include "pybind11/stl.h"
+#include <EigenRand/EigenRand>
 
 #include "model/stochastic_volatility_model.h"
+#include "model/bootstrap_filter.h"
+#include "model/filter_workspace.h"
+#include "model/sv_models.h"
 #include "statistics/normal_distribution.h"
 #include "statistics/particles.h"
+#include "statistics/random_engine.h"
+#include "statistics/resampling.h"
+#include "statistics/thread_pool.h"
+
+
+namespace {
+  template <typename Scalar>
+  Eigen::Matrix<Scalar, Eigen::Dynamic, 1> propagateParticles(const Eigen::Ref<const Eigen::Matrix<Scalar, Eigen::Dynamic, 1>>& particles,
+                                                              const double& mu, const double& phi, const double& sigma,
+                                                              const unsigned int& seed) {
+    const Scalar m = static_cast<Scalar>(mu);
+    const Scalar p = static_cast<Scalar>(phi);
+    unsigned int nParticles = particles.size();
+
+    return m + p * (particles.array() - m)
+           + IndependentVectorNormalT<Scalar>(Scalar(0), static_cast<Scalar>(sigma), nParticles).sample(seed).array();
+  }
 
+  template <typename Scalar>
+  Eigen::Matrix<Scalar, Eigen::Dynamic, 1> observationLogDensities(const Eigen::Ref<const Eigen::Matrix<Scalar, Eigen::Dynamic, 1>>& particles,
+                                                                   const double& y) {
+    using Vector = Eigen::Matrix<Scalar, Eigen::Dynamic, 1>;
+    unsigned int nParticles = particles.size();
 
-namespace py = pybind11;
-
-PYBIND11_MODULE(stochastic_volatility_model,m) {
-	py::class_<StochasticVolatilityModel>(m, "StochasticVolatilityModel")
-		.def(py::init<double, double, double>(),
-				py::arg("mu") = 0.0,
-				py::arg("phi") = 0.0,
-				py::arg("sigma") = 0.0)
-		.def("particleFilter", &StochasticVolatilityModel::particleFilter)
-    .def("logLikelihood", &StochasticVolatilityModel::logLikelihood);
+    Vector means = Vector::Zero(nParticles);
+    Vector stds = (particles / Scalar(2)).array().exp();
 
-	py::class_<Particles>(m, "Particles")
-		.def("getParticles", &Particles::getParticlesAsEigenMatrix);
+    return IndependentVectorNormalT<Scalar>(means, stds).logLikelihoods(static_cast<Scalar>(y));
+  }
 }
 
 
 StochasticVolatilityModel::StochasticVolatilityModel(double mu, double phi, double sigma) : mu_(mu), phi_(phi), sigma_(sigma) {}
 
-Particles StochasticVolatilityModel::particleFilter(const Eigen::VectorXd& y, const unsigned int& nParticles, const unsigned int& seed) {
+
+GaussianSV StochasticVolatilityModel::policy() const {
+  return GaussianSV(mu_, std::tanh(phi_), std::exp(sigma_));
+}
+
+
+IndependentVectorNormal StochasticVolatilityModel::initialDistribution(const unsigned int& nParticles) const {
+  return IndependentVectorNormal(mu_, std::exp(sigma_), nParticles);
+}
+
+Eigen::VectorXd StochasticVolatilityModel::propagate(const Eigen::Ref<const Eigen::VectorXd>& particles, const unsigned int& seed) const {
+  return propagateParticles<double>(particles, mu_, std::tanh(phi_), std::exp(sigma_), seed);
+}
+
+Eigen::VectorXd StochasticVolatilityModel::observationLogLikelihoods(const Eigen::Ref<const Eigen::VectorXd>& particles, const double& y) const {
+  return observationLogDensities<double>(particles, y);
+}
+
+
+template <typename Scalar>
+bool StochasticVolatilityModel::filterStep(VectorT<Scalar>& particles, VectorT<Scalar>& logWeights, VectorT<Scalar>& weights,
+                                           VectorT<Scalar>& scratch, FilterStepStatistics& statistics, const double& y,
+                                           const unsigned int& seed, const unsigned int& t, const RandomEngine& randomEngine,
+                                           ReseedableMersenneTwister& engine, StateOrderBuffers& orderBuffers,
+                                           BlockBuffers& blockBuffers, ThreadPool* pool) const {
+  return BootstrapFilter<GaussianSV>(policy()).step(particles, logWeights, weights, scratch, statistics, 0.0, y, seed, t,
+                                                    randomEngine, engine, orderBuffers, blockBuffers, pool);
+}
+
+template bool StochasticVolatilityModel::filterStep<double>(VectorT<double>&, VectorT<double>&, VectorT<double>&, VectorT<double>&,
+                                                            FilterStepStatistics&, const double&, const unsigned int&,
+                                                            const unsigned int&, const RandomEngine&,
+                                                            ReseedableMersenneTwister&, StateOrderBuffers&, BlockBuffers&,
+                                                            ThreadPool*) const;
+template bool StochasticVolatilityModel::filterStep<float>(VectorT<float>&, VectorT<float>&, VectorT<float>&, VectorT<float>&,
+                                                           FilterStepStatistics&, const double&, const unsigned int&,
+                                                           const unsigned int&, const RandomEngine&,
+                                                           ReseedableMersenneTwister&, StateOrderBuffers&, BlockBuffers&,
+                                                           ThreadPool*) const;
+
+
+template <typename Scalar>
+bool StochasticVolatilityModel::auxiliaryStep(FilterBuffers<Scalar>& buffers, FilterStepStatistics& statistics, const double& y,
+                                              const ResamplingScheme& scheme, const double& essThreshold,
+                                              const unsigned int& seed, ReseedableMersenneTwister& engine,
+                                              std::mt19937& generator, BlockBuffers& blockBuffers, ThreadPool* pool) const {
+  const Scalar mu = static_cast<Scalar>(mu_);
+  const Scalar phi = static_cast<Scalar>(std::tanh(phi_));
+  const Scalar variance = static_cast<Scalar>(std::exp(2.0 * sigma_));
+  const Scalar logNormaliser = static_cast<Scalar>(-0.5 * std::log(2.0 * M_PI));
+  const Scalar predictiveScale = static_cast<Scalar>(0.5 * std::exp(0.5 * std::exp(2.0 * sigma_)));
+  const Scalar ySquared = static_cast<Scalar>(y * y);
+  const Scalar half = Scalar(0.5);
+  const Scalar one = Scalar(1);
+  const long nParticles = buffers.particles.size();
+  const int newtonSteps = 3;
+  SV_INSTRUMENT(StageTimer timer;)
+
+  VectorT<Scalar>& particles = buffers.particles;
+  VectorT<Scalar>& logWeights = buffers.logWeights;
+  VectorT<Scalar>& weights = buffers.weights;
+  VectorT<Scalar>& scratch = buffers.scratch;
+  VectorT<Scalar>& means = buffers.means;
+  VectorT<Scalar>& modes = buffers.modes;
+  VectorT<Scalar>& scaled = buffers.scaled;
+  VectorT<Scalar>& precisions = buffers.precisions;
+  VectorT<Scalar>& shifts = buffers.shifts;
+
+  //standard normal draws into scratch, from one stream per pool block as in the bootstrap step
+  auto drawNoise = [&]() {
+    if (pool == nullptr) {
+      engine.seed(seed);
+      engine.standardNormal(scratch, nParticles);
+      return;
+    }
+    const unsigned int blocks = pool->getThreadCount();
+    pool->run([&](unsigned int block) {
+      const long begin = ThreadPool::blockBegin(nParticles, blocks, block);
+      const long length = ThreadPool::blockBegin(nParticles, blocks, block + 1) - begin;
+      if (length > 0) {
+        ReseedableMersenneTwister& blockEngine = blockBuffers.engines[block];
+        blockEngine.seed(static_cast<unsigned int>(ThreadPool::blockSeed(seed, block)));
+        blockEngine.standardNormal(scratch.segment(begin, length));
+      }
+    });
+  };
+
+  means.array() = mu + phi * (particles.array() - mu);
+
+  //E[log N(y; 0, exp(x_t))] under the Gaussian predictive, in closed form
+  scratch = logNormaliser - half * means.array() - predictiveScale * ySquared * (-means.array()).exp();
+  statistics.weightedLogLikelihood = weightedSum<Scalar>(weights, scratch);
+
+  //expansion point: Newton steps from m towards the mode of N(x; m, sigma^2) N(y; 0, exp(x)),
+  //which converge monotonically as the gradient is convex and decreasing in x
+  modes = means;
+  for (int k = 0; k < newtonSteps; ++k) {
+    scaled.array() = ySquared * (-modes.array()).exp();
+    modes.array() += (-(modes.array() - means.array()) / variance - half + half * scaled.array())
+                     / (one / variance + half * scaled.array());
+  }
+
+  //log N(y; 0, exp(x)) ~ l(x*) + b d - c d^2 / 2 in d = x - x*, with b = (e - 1) / 2, c = e / 2, e = y^2 exp(-x*)
+  scaled.array() = ySquared * (-modes.array()).exp();
+  precisions.array() = one / variance + half * scaled.array(); //of the proposal, prior precision plus c
+  shifts.array() = (means.array() - modes.array()) / variance + half * (scaled.array() - one); //proposal mean is x* + shift / P
+
+  //first stage: integral of the prior against the Gaussian approximation
+  scratch = logWeights.array() + logNormaliser - half * modes.array() - half * scaled.array()
+            - half * (precisions.array() * variance).log() + half * shifts.array().square() / precisions.array()
+            - half * (means.array() - modes.array()).square() / variance;
+  const double maxFirstStage = scratch.maxCoeff();
+  if (!std::isfinite(maxFirstStage)) {//nothing to look ahead on, move the particles with the prior
+    drawNoise();
+    particles = means.array() + static_cast<Scalar>(std::exp(sigma_)) * scratch.array();
+    statistics.logEvidence = maxFirstStage;
+    return false;
+  }
+  weights = (scratch.array() - static_cast<Scalar>(maxFirstStage)).exp();
+  const double firstStageSum = weights.sum();
+  weights /= static_cast<Scalar>(firstStageSum);
+  SV_INSTRUMENT(statistics.weightSeconds = timer.lap();)
+
+  //resampled particles carry the mean first-stage weight, all others their own; the proposal of a new
+  //particle no longer depends on its ancestor's state, only on the gathered expansion
+  bool resampled = false;
+  if (1.0 / weights.squaredNorm() < essThreshold * nParticles) {
+    const Eigen::VectorXd& firstStageWeights = buffers.doubleWeights();
+    if (pool == nullptr) {
+      generator.seed(seed);
+      resampling::ancestorIndices(firstStageWeights, scheme, generator, buffers.ancestors, buffers.uniforms, buffers.residuals);
+    } else {
+      resampling::ancestorIndices(firstStageWeights, scheme, seed, *pool, buffers.ancestors, buffers.uniforms,
+                                  buffers.pooledResampling);
+    }
+
+    for (VectorT<Scalar>* values : {&modes, &scaled, &precisions, &shifts}) {
+      for (long i = 0; i < nParticles; ++i) {
+        buffers.gathered[i] = (*values)[buffers.ancestors[i]];
+      }
+      values->swap(buffers.gathered);
+    }
+    logWeights.setConstant(static_cast<Scalar>(maxFirstStage + std::log(firstStageSum / nParticles)));
+    resampled = true;
+    SV_INSTRUMENT(statistics.resampled = true;)
+  } else {
+    logWeights = scratch;
+  }
+  SV_INSTRUMENT(statistics.resampleSeconds = timer.lap();)
+
+  //prior noise drawn as in the bootstrap step, moved to the proposal N(x* + shift / P, 1 / P)
+  drawNoise();
+  particles = modes.array() + shifts.array() / precisions.array() + scratch.array() / precisions.array().sqrt();
+  SV_INSTRUMENT(statistics.propagateSeconds = timer.lap();)
+
+  //second stage: exact over approximated observation density
+  scratch = particles - modes; //the steps d = x - x*
+  scratch = half * scaled.array() * (one - scratch.array() + half * scratch.array().square())
+            - half * ySquared * (-particles.array()).exp();
+  scratch += logWeights;
+  SV_INSTRUMENT(statistics.weightSeconds += timer.lap();)
+
+  const double maxLogWeight = scratch.maxCoeff();
+  if (!std::isfinite(maxLogWeight)) {//every particle is impossible, fall back to equal weights
+    weights.setConstant(static_cast<Scalar>(1.0 / nParticles));
+    logWeights.setConstant(static_cast<Scalar>(-std::log(nParticles)));
+    statistics.logEvidence = maxLogWeight;
+    return resampled;
+  }
+
+  weights = (scratch.array() - static_cast<Scalar>(maxLogWeight)).exp();
+  const double weightSum = weights.sum();
+  weights /= static_cast<Scalar>(weightSum);
+  statistics.logEvidence = maxLogWeight + std::log(weightSum);
+  logWeights = scratch.array() - static_cast<Scalar>(statistics.logEvidence);
+
+  statistics.effectiveSampleSize = 1.0 / weights.squaredNorm();
+  SV_INSTRUMENT(statistics.normaliseSeconds = timer.lap();)
+  return resampled;
+}
+
+unsigned int StochasticVolatilityModel::stepSeed(const unsigned int& seed, const unsigned int& t) {
+  return bootstrap::stepSeed(seed, t);
+}
+
+template <typename Scalar>
+double StochasticVolatilityModel::weightedSum(const Eigen::Ref<const VectorT<Scalar>>& weights,
+                                              const Eigen::Ref<const VectorT<Scalar>>& values) {
+  //zero weights must not turn impossible particles into NaN
+  return (weights.array() > Scalar(0)).select(weights.array() * values.array(), Scalar(0)).sum();
+}
+
+
+Particles StochasticVolatilityModel::particleFilter(const SeriesRef& y, const unsigned int& nParticles, const unsigned int& seed,
+                                                    const FilterOptions& options) const {
+  if (options.precision == FilterPrecision::Single) {
+    ParticlesT<float> particles = particleFilterSingle(y, nParticles, seed, options);
+    return Particles(Eigen::MatrixXd(particles.getParticlesAsEigenMatrix().cast<double>()),
+                     particles.getParticleLength(), options.particleLayout);
+  }
+
+  return filterTrajectories<double>(y, nParticles, seed, options);
+}
+
+ParticlesT<float> StochasticVolatilityModel::particleFilterSingle(const SeriesRef& y, const unsigned int& nParticles,
+                                                                  const unsigned int& seed, const FilterOptions& options) const {
+  return filterTrajectories<float>(y, nParticles, seed, options);
+}
+
+template <typename Scalar>
+ParticlesT<Scalar> StochasticVolatilityModel::filterTrajectories(const SeriesRef& y, const unsigned int& nParticles,
+                                                                 const unsigned int& seed, const FilterOptions& options) const {
+  if (options.proposal == FilterProposal::Bootstrap) {
+    return BootstrapFilter<GaussianSV>(policy()).trajectories<Scalar>(y, nParticles, seed, options);
+  }
+
   unsigned int T = y.size();
+  SV_INSTRUMENT(FilterRecorder recorder(options.statistics.get(), T);)
 
-  double mu = mu_;
-  double phi = std::tanh(phi_);
-  double sigma = std::exp(sigma_);
+  IndependentVectorNormalT<Scalar> initial(static_cast<Scalar>(mu_), static_cast<Scalar>(std::exp(sigma_)), nParticles);
+  ParticlesT<Scalar> particles = ParticlesT<Scalar>(initial, T+1, seed, options.particleLayout, options.storageFile);
+  particles.setPathStorage(PathStorage::Genealogy); //trajectories are only traced back once at the end
 
-  Particles particles = Particles(IndependentVectorNormal(mu, sigma, nParticles), T+1, seed);
+  std::unique_ptr<ThreadPool> pool;
+  BlockBuffers blockBuffers;
+  if (options.threadCount > 1) {
+    pool.reset(new ThreadPool(options.threadCount));
+    blockBuffers.resize(options.threadCount);
+  }
 
-  int loopSeed = seed; //unique seed for each loop iteration
+  //the step works on the latest cloud, the history only follows its resampling
+  FilterBuffers<Scalar> buffers;
+  buffers.resize(nParticles);
+  buffers.particles = particles.getLatestParticles();
+  buffers.logWeights.setConstant(static_cast<Scalar>(-std::log(nParticles)));
+  buffers.weights.setConstant(static_cast<Scalar>(1.0 / nParticles));
+  ReseedableMersenneTwister engine;
+  std::mt19937 generator;
+  FilterStepStatistics statistics;
+  ThreadPool* resamplingPool = options.randomEngine == RandomEngine::MersenneTwister ? pool.get() : nullptr;
+
+  for (unsigned int t=1; t<=T; t++) {
+    unsigned int loopSeed = stepSeed(seed, t); //unique seed for each loop iteration
+    if (auxiliaryStep(buffers, statistics, y[t-1], options.resamplingScheme, options.essThreshold, loopSeed,
+                      engine, generator, blockBuffers, pool.get())) {
+      particles.applyAncestors(buffers.ancestors);
+    }
+    particles.appendParticles(buffers.particles);
+    SV_INSTRUMENT(recorder.recordStep(statistics, std::isfinite(statistics.logEvidence));)
+  }
 
-  for (int t=1; t<=T; t++) {
-    Eigen::VectorXd latestParticles = particles.getLatestParticles(); //particles at t-1
+  if (T > 0) {//returned trajectories carry no weights
+    SV_INSTRUMENT(recorder.startResampling();)
+    bootstrap::resample(particles, buffers.logWeights, buffers.weights, options.resamplingScheme, false, stepSeed(seed, T+1),
+                        resamplingPool);
+    SV_INSTRUMENT(recorder.finishResampling();)
+  }
 
-    latestParticles = mu + phi * (latestParticles.array() - mu) + IndependentVectorNormal(0.0, sigma, nParticles).sample(loopSeed).array();
+  if (options.storageFile.empty()) {
+    return particles.getParticlesWithoutInit();
+  }
+  particles.removeInitialParticles(); //traced and trimmed within the file
+  return particles;
+}
 
-    Eigen::VectorXd means = Eigen::VectorXd::Zero(nParticles);
-    Eigen::VectorXd stds = (latestParticles / 2.0).array().exp();
 
-    Eigen::VectorXd likelihoods = IndependentVectorNormal(means, stds).pdfs(y[t-1]);
-    double lSum = likelihoods.sum();
+double StochasticVolatilityModel::logLikelihood(const SeriesRef& y, const unsigned int& nParticles, const unsigned int& seed,
+                                                const FilterOptions& options) const {
+  FilterWorkspace workspace(nParticles, options.precision);
+  return logLikelihood(y, nParticles, seed, options, workspace);
+}
 
-    particles.appendParticles(latestParticles); //particles at t
-    
-    if (lSum > 0.0) {//avoid degenerate case
-      Eigen::VectorXd weights = likelihoods/lSum;
-      std::vector<double> weightsVec(weights.data(), weights.data() + nParticles);
-      
-      particles.resampleParticles(weightsVec, loopSeed);
+double StochasticVolatilityModel::logLikelihood(const SeriesRef& y, const unsigned int& nParticles, const unsigned int& seed,
+                                                const FilterOptions& options, FilterWorkspace& workspace) const {
+  double logLikeSum, logEvidenceSum;
+  if (options.precision == FilterPrecision::Single) {
+    filterLogLikelihoods<float>(y, nParticles, seed, options, workspace, logLikeSum, logEvidenceSum);
+  } else {
+    filterLogLikelihoods<double>(y, nParticles, seed, options, workspace, logLikeSum, logEvidenceSum);
+  }
+
+  return logLikeSum / y.size();
+}
+
+double StochasticVolatilityModel::logMarginalLikelihood(const SeriesRef& y, const unsigned int& nParticles, const unsigned int& seed,
+                                                        const FilterOptions& options) const {
+  FilterWorkspace workspace(nParticles, options.precision);
+  return logMarginalLikelihood(y, nParticles, seed, options, workspace);
+}
+
+double StochasticVolatilityModel::logMarginalLikelihood(const SeriesRef& y, const unsigned int& nParticles, const unsigned int& seed,
+                                                        const FilterOptions& options, FilterWorkspace& workspace) const {
+  double logLikeSum, logEvidenceSum;
+  if (options.precision == FilterPrecision::Single) {
+    filterLogLikelihoods<float>(y, nParticles, seed, options, workspace, logLikeSum, logEvidenceSum);
+  } else {
+    filterLogLikelihoods<double>(y, nParticles, seed, options, workspace, logLikeSum, logEvidenceSum);
+  }
+
+  return logEvidenceSum;
+}
+
+template <typename Scalar>
+void StochasticVolatilityModel::filterLogLikelihoods(const SeriesRef& y, const unsigned int& nParticles, const unsigned int& seed,
+                                                     const FilterOptions& options, FilterWorkspace& workspace,
+                                                     double& logLikeSum, double& logEvidenceSum) const {
+  if (options.proposal == FilterProposal::Bootstrap) {
+    BootstrapFilter<GaussianSV>(policy()).logLikelihoods<Scalar>(y, nParticles, seed, options, workspace, logLikeSum, logEvidenceSum);
+    return;
+  }
+  if (nParticles == 0) {
+    throw std::invalid_argument("Number of particles must be greater than zero.");
+  }
+  unsigned int T = y.size();
+  SV_INSTRUMENT(FilterRecorder recorder(options.statistics.get(), T);)
+
+  FilterBuffers<Scalar>& buffers = workspace.buffers<Scalar>();
+  buffers.resize(nParticles);
+
+  //the draw of the initial distribution in particleFilter, straight into the buffer
+  workspace.engine_.seed(seed);
+  workspace.engine_.standardNormal(buffers.particles, nParticles);
+  buffers.particles *= static_cast<Scalar>(std::exp(sigma_));
+  buffers.particles.array() += static_cast<Scalar>(mu_);
+
+  //the pool and its block buffers persist in the workspace across calls with the same thread count
+  ThreadPool* pool = workspace.pool(options.threadCount);
+
+  //per-step terms are accumulated in double whatever the particle precision
+  logLikeSum = 0.0;
+  logEvidenceSum = 0.0;
+  buffers.logWeights.setConstant(static_cast<Scalar>(-std::log(nParticles)));
+  buffers.weights.setConstant(static_cast<Scalar>(1.0 / nParticles));
+  FilterStepStatistics statistics;
+
+  for (unsigned int t=1; t<=T; t++) {
+    unsigned int loopSeed = stepSeed(seed, t); //unique seed for each loop iteration
+    auxiliaryStep(buffers, statistics, y[t-1], options.resamplingScheme, options.essThreshold, loopSeed,
+                  workspace.engine_, workspace.generator_, workspace.blockBuffers_, pool);
+    SV_INSTRUMENT(recorder.recordStep(statistics, std::isfinite(statistics.logEvidence));)
+    logLikeSum += statistics.weightedLogLikelihood;
+    logEvidenceSum += statistics.logEvidence;
+  }
+}
+
+
+Particles StochasticVolatilityModel::particleSmoother(const SeriesRef& y, const unsigned int& nParticles,
+                                                      const unsigned int& nTrajectories, const unsigned int& seed,
+                                                      const FilterOptions& options) const {
+  if (nParticles == 0 || nTrajectories == 0) {
+    throw std::invalid_argument("Number of particles and trajectories must be greater than zero.");
+  }
+  if (y.size() == 0) {
+    throw std::invalid_argument("Observations must not be empty.");
+  }
+
+  unsigned int T = y.size();
+  const double phi = std::tanh(phi_);
+  const double sigma = std::exp(sigma_);
+  const unsigned int maxRejections = 32; //afterwards the backward weights are computed exactly
+
+  //forward pass: keep every filtering cloud before resampling, as history and cumulative weights
+  Particles history = Particles(initialDistribution(nParticles), T+1, seed, ParticleLayout::TimeMajor);
+  Eigen::MatrixXd cumulativeWeights(nParticles, T+1);
+
+  std::unique_ptr<ThreadPool> pool;
+  BlockBuffers blockBuffers;
+  if (options.threadCount > 1) {
+    pool.reset(new ThreadPool(options.threadCount));
+    blockBuffers.resize(options.threadCount);
+  }
+
+  Eigen::VectorXd particles = history.getLatestParticles();
+  Eigen::VectorXd logWeights = Eigen::VectorXd::Constant(nParticles, -std::log(nParticles));
+  Eigen::VectorXd weights = Eigen::VectorXd::Constant(nParticles, 1.0 / nParticles);
+  Eigen::VectorXd scratch;
+  ReseedableMersenneTwister engine;
+  StateOrderBuffers orderBuffers;
+  FilterStepStatistics statistics;
+  std::mt19937 generator;
+  ThreadPool* resamplingPool = options.randomEngine == RandomEngine::MersenneTwister ? pool.get() : nullptr;
+  const bool stateOrdered = options.randomEngine == RandomEngine::Sobol;
+
+  std::partial_sum(weights.data(), weights.data() + nParticles, cumulativeWeights.col(0).data());
+
+  for (unsigned int t=1; t<=T; t++) {
+    unsigned int loopSeed = stepSeed(seed, t); //unique seed for each loop iteration
+    bool updated = filterStep(particles, logWeights, weights, scratch, statistics, y[t-1], seed, t,
+                              options.randomEngine, engine, orderBuffers, blockBuffers, pool.get());
+
+    history.appendParticles(particles);
+    std::partial_sum(weights.data(), weights.data() + nParticles, cumulativeWeights.col(t).data());
+
+    if (updated && statistics.effectiveSampleSize < options.essThreshold * nParticles) {
+      Eigen::VectorXi ancestors;
+      if (stateOrdered) {
+        Eigen::VectorXd uniforms(nParticles), residuals(nParticles);
+        ancestors.resize(nParticles);
+        generator.seed(loopSeed);
+        bootstrap::stateOrderedAncestors<double>(particles, weights, options.resamplingScheme, generator, ancestors, uniforms, residuals,
+                                                 orderBuffers);
+      } else if (resamplingPool) {
+        ancestors = resampling::ancestorIndices(weights, options.resamplingScheme, loopSeed, *resamplingPool);
+      } else {
+        generator.seed(loopSeed);
+        ancestors = resampling::ancestorIndices(weights, options.resamplingScheme, generator);
+      }
+      for (unsigned int i = 0; i < nParticles; ++i) {
+        scratch[i] = particles[ancestors[i]];
+      }
+      particles.swap(scratch);
+      weights.setConstant(1.0 / nParticles);
+      logWeights.setConstant(-std::log(nParticles));
+    }
+  }
+
+  //read in place: TimeMajor storage is particles x (T+1), one contiguous column per time step
+  const Eigen::Map<const Eigen::MatrixXd> clouds = history.getStorage();
+
+  //backward pass: every trajectory has its own generator
+  Eigen::MatrixXd trajectories(T, nTrajectories);
+  const unsigned int backwardSeed = stepSeed(seed, T+1);
+  const unsigned int blocks = pool ? pool->getThreadCount() : 1;
+
+  auto backward = [&](unsigned int block) {
+    const long begin = ThreadPool::blockBegin(nTrajectories, blocks, block);
+    const long end = ThreadPool::blockBegin(nTrajectories, blocks, block + 1);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    Eigen::VectorXd exactWeights(nParticles);
+
+    auto draw = [&](const double* cumulative, std::mt19937& engine) {
+      const double target = uniform(engine) * cumulative[nParticles-1];
+      const long index = std::upper_bound(cumulative, cumulative + nParticles, target) - cumulative;
+      return std::min(index, static_cast<long>(nParticles) - 1);
+    };
+
+    for (long j = begin; j < end; ++j) {
+      std::mt19937 engine(static_cast<unsigned int>(ThreadPool::blockSeed(backwardSeed, j)));
+
+      long index = draw(cumulativeWeights.col(T).data(), engine);
+      double next = clouds(index, T);
+      if (T > 0) {
+        trajectories(T-1, j) = next;
+      }
+
+      for (int t=T-1; t>=1; t--) {
+        const double* cumulative = cumulativeWeights.col(t).data();
+        bool accepted = false;
+
+        //f(next | x) / max f = exp(-r^2 / 2) accepts a draw from the filtering weights
+        for (unsigned int attempt = 0; attempt < maxRejections && !accepted; ++attempt) {
+          index = draw(cumulative, engine);
+          const double residual = (next - mu_ - phi * (clouds(index, t) - mu_)) / sigma;
+          accepted = std::log(uniform(engine)) < -0.5 * residual * residual;
+        }
+
+        if (!accepted) {
+          exactWeights = (-0.5 * ((next - mu_ - phi * (clouds.col(t).array() - mu_)) / sigma).square()).exp();
+          exactWeights[0] *= cumulative[0];
+          for (unsigned int i = 1; i < nParticles; ++i) {
+            exactWeights[i] *= cumulative[i] - cumulative[i-1];
+          }
+          std::partial_sum(exactWeights.data(), exactWeights.data() + nParticles, exactWeights.data());
+          if (exactWeights[nParticles-1] > 0.0) {
+            index = draw(exactWeights.data(), engine);
+          }
+        }
+
+        next = clouds(index, t);
+        trajectories(t-1, j) = next;
+      }
     }
+  };
+
+  if (pool) {
+    pool->run(backward);
+  } else {
+    backward(0);
   }
 
-  return particles.getParticlesWithoutInit();
+  return Particles(trajectories, T, options.particleLayout);
 }
 
 
-double StochasticVolatilityModel::logLikelihood(const Eigen::VectorXd& y, const unsigned int& nParticles, const unsigned int& seed) {
+Eigen::VectorXd StochasticVolatilityModel::batchLogLikelihood(const Eigen::MatrixXd& parameters, const SeriesRef& y,
+                                                              const unsigned int& nParticles, const unsigned int& seed,
+                                                              const FilterOptions& options) {
+  if (parameters.cols() != 3) {
+    throw std::invalid_argument("Parameters must have three columns (mu, phi, sigma).");
+  }
+  if (nParticles == 0) {
+    throw std::invalid_argument("Number of particles must be greater than zero.");
+  }
+  if (options.precision != FilterPrecision::Double || options.proposal != FilterProposal::Bootstrap
+      || options.randomEngine != RandomEngine::MersenneTwister) {
+    throw std::invalid_argument("batchLogLikelihood only runs the double precision Mersenne Twister bootstrap filter.");
+  }
+
+  const long K = parameters.rows();
   unsigned int T = y.size();
 
-  double mu = mu_;
-  double phi = std::tanh(phi_);
-  double sigma = std::exp(sigma_);
+  //particles x parameters, so every step is a single array expression over the whole grid
+  Eigen::RowVectorXd mu = parameters.col(0).transpose();
+  Eigen::RowVectorXd phi = parameters.col(1).array().tanh().matrix().transpose();
+  Eigen::RowVectorXd sigma = parameters.col(2).array().exp().matrix().transpose();
 
-  Particles particles = Particles(IndependentVectorNormal(mu, sigma, nParticles), T+1, seed);
+  Eigen::VectorXd logLikeSums = Eigen::VectorXd::Zero(K);
 
-  int loopSeed = seed; //unique seed for each loop iteration
-  double logLikeSum = 0.0;
+  const unsigned int blocks = std::max(1u, std::min<unsigned int>(options.threadCount, K));
+  std::unique_ptr<ThreadPool> pool;
+  if (blocks > 1) {
+    pool.reset(new ThreadPool(blocks));
+  }
 
-  for (int t=1; t<=T; t++) {
-    Eigen::VectorXd latestParticles = particles.getLatestParticles(); //particles at t-1
+  //parameter blocks are independent for the whole run, so every thread filters its own columns
+  auto filterColumns = [&](unsigned int block) {
+    const long begin = ThreadPool::blockBegin(K, blocks, block);
+    const long columns = ThreadPool::blockBegin(K, blocks, block + 1) - begin;
+    if (columns == 0) {
+      return;
+    }
 
-    latestParticles = mu + phi * (latestParticles.array() - mu) + IndependentVectorNormal(0.0, sigma, nParticles).sample(loopSeed).array();
+    //the draws of IndependentVectorNormal(0, 1).sample, shared by the columns and restarted every step
+    ReseedableMersenneTwister engine(seed);
+    Eigen::VectorXd noise;
+    engine.standardNormal(noise, nParticles);
+    std::mt19937 generator;
+    Eigen::VectorXi ancestors(nParticles);
+    Eigen::VectorXd uniforms(nParticles);
+    Eigen::VectorXd residuals(nParticles);
+
+    Eigen::ArrayXXd particles = (noise * sigma.segment(begin, columns)).array().rowwise()
+                              + mu.segment(begin, columns).array();
+    Eigen::ArrayXXd logLikelihoods(nParticles, columns);
+    Eigen::ArrayXXd logWeights = Eigen::ArrayXXd::Constant(nParticles, columns, -std::log(nParticles));
+    Eigen::ArrayXXd weights = Eigen::ArrayXXd::Constant(nParticles, columns, 1.0 / nParticles);
+    Eigen::ArrayXXd resampled(nParticles, columns);
+
+  
+    for (unsigned int t=1; t<=T; t++) {
+      unsigned int loopSeed = stepSeed(seed, t); //unique seed for each loop iteration
+      engine.seed(loopSeed);
+      engine.standardNormal(noise, nParticles);
+
+      particles = ((particles.rowwise() - mu.segment(begin, columns).array()).rowwise() * phi.segment(begin, columns).array()).rowwise()
+                + mu.segment(begin, columns).array()
+                + (noise * sigma.segment(begin, columns)).array();
+
+      //log N(y; 0, exp(x)) without the separate exp/log of the standard deviation
+      logLikelihoods = -0.5 * std::log(2 * M_PI) - 0.5 * particles - 0.5 * y[t-1] * y[t-1] * (-particles).exp();
+
+      for (long k = 0; k < columns; ++k) {
+        logLikeSums[begin + k] += weightedSum<double>(weights.col(k).matrix(), logLikelihoods.col(k).matrix());
+      }
+
+      logLikelihoods += logWeights;
+
+      for (long k = 0; k < columns; ++k) {
+        const double maxLogWeight = logLikelihoods.col(k).maxCoeff();
+        if (!std::isfinite(maxLogWeight)) {//every particle is impossible, keep the previous weights
+          continue;
+        }
+
+        weights.col(k) = (logLikelihoods.col(k) - maxLogWeight).exp();
+        const double weightSum = weights.col(k).sum();
+        weights.col(k) /= weightSum;
+        logWeights.col(k) = logLikelihoods.col(k) - (maxLogWeight + std::log(weightSum));
+
+        const double ess = 1.0 / weights.col(k).matrix().squaredNorm();
+        if (ess < options.essThreshold * nParticles) {
+          generator.seed(loopSeed);
+          resampling::ancestorIndices(weights.col(k).matrix(), options.resamplingScheme, generator, ancestors, uniforms, residuals);
+          for (unsigned int i = 0; i < nParticles; ++i) {
+            resampled(i, k) = particles(ancestors[i], k);
+          }
+          particles.col(k) = resampled.col(k);
+          weights.col(k).setConstant(1.0 / nParticles);
+          logWeights.col(k).setConstant(-std::log(nParticles));
+        }
+      }
+    }
+  };
+
+  if (pool) {
+    pool->run(filterColumns);
+  } else {
+    filterColumns(0);
+  }
 
-    Eigen::VectorXd means = Eigen::VectorXd::Zero(nParticles);
-    Eigen::VectorXd stds = (latestParticles / 2.0).array().exp();
+  logLikeSums /= T;
 
-    Eigen::VectorXd logLikelihoods = IndependentVectorNormal(means, stds).logLikelihoods(y[t-1]);
-    Eigen::VectorXd likelihoods = logLikelihoods.array().exp();
+  return logLikeSums;
+}
 
-    double lSum = likelihoods.sum();
-    logLikeSum += logLikelihoods.sum();
 
-    particles.appendParticles(latestParticles); //particles at t
+BatchFilterResult StochasticVolatilityModel::batchFilter(const Eigen::MatrixXd& parameters, const PanelRef& y,
+                                                         const unsigned int& nParticles, const unsigned int& seed,
+                                                         const FilterOptions& options) {
+  if (parameters.cols() != 3) {
+    throw std::invalid_argument("Parameters must have three columns (mu, phi, sigma).");
+  }
+  if (parameters.rows() != y.rows()) {
+    throw std::invalid_argument("Number of parameter rows must be equal to the number of series.");
+  }
+  if (nParticles == 0) {
+    throw std::invalid_argument("Number of particles must be greater than zero.");
+  }
+
+  const long A = y.rows();
+  unsigned int T = y.cols();
+
+  Eigen::RowVectorXd mu = parameters.col(0).transpose();
+  Eigen::RowVectorXd phi = parameters.col(1).array().tanh().matrix().transpose();
+  Eigen::RowVectorXd sigma = parameters.col(2).array().exp().matrix().transpose();
+
+  BatchFilterResult result;
+  result.logLikelihoods = Eigen::VectorXd::Zero(A);
+  result.logMarginalLikelihoods = Eigen::VectorXd::Zero(A);
+  result.observationCounts = Eigen::VectorXi::Zero(A);
+  result.filteredMeans.resize(A, T);
+  result.filteredStdDevs.resize(A, T);
+
+  const unsigned int blocks = std::max(1u, std::min<unsigned int>(options.threadCount, std::max<long>(A, 1)));
+  std::unique_ptr<ThreadPool> pool;
+  if (blocks > 1) {
+    pool.reset(new ThreadPool(blocks));
+  }
+
+  //asset blocks are independent for the whole run, so every thread filters its own columns
+  auto filterAssets = [&](unsigned int block) {
+    const long begin = ThreadPool::blockBegin(A, blocks, block);
+    const long columns = ThreadPool::blockBegin(A, blocks, block + 1) - begin;
+    if (columns == 0) {
+      return;
+    }
+
+    //the draws of IndependentVectorNormal(0, 1).sample, from one engine restarted for every asset and step
+    ReseedableMersenneTwister engine;
+    Eigen::VectorXd draws(nParticles);
+    std::mt19937 generator;
+    Eigen::VectorXi ancestors(nParticles);
+    Eigen::VectorXd uniforms(nParticles);
+    Eigen::VectorXd residuals(nParticles);
+
+    std::vector<unsigned int> assetSeeds(columns);
+    Eigen::ArrayXXd noise(nParticles, columns);
+    for (long k = 0; k < columns; ++k) {
+      assetSeeds[k] = static_cast<unsigned int>(ThreadPool::blockSeed(seed, begin + k));
+      engine.seed(assetSeeds[k]);
+      engine.standardNormal(draws, nParticles);
+      noise.col(k) = draws.array();
+    }
+
+    Eigen::ArrayXXd particles = (noise.rowwise() * sigma.segment(begin, columns).array()).rowwise()
+                              + mu.segment(begin, columns).array();
+    Eigen::ArrayXXd logLikelihoods(nParticles, columns);
+    Eigen::ArrayXXd logWeights = Eigen::ArrayXXd::Constant(nParticles, columns, -std::log(nParticles));
+    Eigen::ArrayXXd weights = Eigen::ArrayXXd::Constant(nParticles, columns, 1.0 / nParticles);
+    Eigen::ArrayXd resampled(nParticles);
+    Eigen::RowVectorXd ySquared(columns);
+
+    for (unsigned int t=1; t<=T; t++) {
+      for (long k = 0; k < columns; ++k) {
+        engine.seed(stepSeed(assetSeeds[k], t));
+        engine.standardNormal(draws, nParticles);
+        noise.col(k) = draws.array();
+        const double observation = y(begin + k, t-1);
+        ySquared[k] = std::isnan(observation) ? 0.0 : observation * observation;
+      }
+
+      particles = ((particles.rowwise() - mu.segment(begin, columns).array()).rowwise() * phi.segment(begin, columns).array()).rowwise()
+                + mu.segment(begin, columns).array()
+                + noise.rowwise() * sigma.segment(begin, columns).array();
+
+      //log N(y; 0, exp(x)) without the separate exp/log of the standard deviation
+      logLikelihoods = -0.5 * std::log(2 * M_PI) - 0.5 * particles - 0.5 * ((-particles).exp().rowwise() * ySquared.array());
+
+      for (long k = 0; k < columns; ++k) {
+        const long asset = begin + k;
+
+        if (!std::isnan(y(asset, t-1))) {
+          result.logLikelihoods[asset] += weightedSum<double>(weights.col(k).matrix(), logLikelihoods.col(k).matrix());
+          result.observationCounts[asset]++;
+
+          logLikelihoods.col(k) += logWeights.col(k);
+          const double maxLogWeight = logLikelihoods.col(k).maxCoeff();
+
+          if (std::isfinite(maxLogWeight)) {//otherwise every particle is impossible, keep the previous weights
+            weights.col(k) = (logLikelihoods.col(k) - maxLogWeight).exp();
+            const double weightSum = weights.col(k).sum();
+            weights.col(k) /= weightSum;
+            const double logEvidence = maxLogWeight + std::log(weightSum);
+            logWeights.col(k) = logLikelihoods.col(k) - logEvidence;
+            result.logMarginalLikelihoods[asset] += logEvidence;
+          } else {
+            result.logMarginalLikelihoods[asset] += maxLogWeight;
+          }
+        }
+
+        //summaries of the filtering distribution before resampling
+        const double mean = (weights.col(k) * particles.col(k)).sum();
+        const double secondMoment = (weights.col(k) * particles.col(k).square()).sum();
+        result.filteredMeans(asset, t-1) = mean;
+        result.filteredStdDevs(asset, t-1) = std::sqrt(std::max(secondMoment - mean * mean, 0.0));
+
+        if (std::isnan(y(asset, t-1))) {//nothing observed, the weights have not moved
+          continue;
+        }
+
+        const double ess = 1.0 / weights.col(k).matrix().squaredNorm();
+        if (ess < options.essThreshold * nParticles) {
+          generator.seed(stepSeed(assetSeeds[k], t));
+          resampling::ancestorIndices(weights.col(k).matrix(), options.resamplingScheme, generator, ancestors, uniforms, residuals);
+          for (unsigned int i = 0; i < nParticles; ++i) {
+            resampled[i] = particles(ancestors[i], k);
+          }
+          particles.col(k) = resampled;
+          weights.col(k).setConstant(1.0 / nParticles);
+          logWeights.col(k).setConstant(-std::log(nParticles));
+        }
+      }
+    }
+  };
 
-    Eigen::VectorXd weights = likelihoods/lSum;
-    std::vector<double> weightsVec(weights.data(), weights.data() + nParticles);
-    
-    particles.resampleParticles(weightsVec, loopSeed);
+  if (pool) {
+    pool->run(filterAssets);
+  } else {
+    filterAssets(0);
   }
 
-  logLikeSum /= T*nParticles;
+  //as in logLikelihood, assets without observations have no average
+  result.logLikelihoods.array() /= result.observationCounts.cast<double>().array();
 
-  return logLikeSum;
+  return result;
 }
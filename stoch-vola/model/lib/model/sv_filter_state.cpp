@@ -0,0 +1,186 @@
+#include <vector>
+#include <cmath>
+#include <string>
+#include <cstring>
+#include <stdexcept>
+
+#include <Eigen/Dense>
+
+#include "model/bootstrap_filter.h"
+#include "model/sv_filter_state.h"
+#include "model/stochastic_volatility_model.h"
+#include "statistics/mapped_file.h"
+#include "statistics/resampling.h"
+#include "statistics/util_funs.h"
+
+
+namespace {
+  const char checkpointMagic[8] = {'S', 'V', 'C', 'K', 'P', 'T', '\0', '\0'};
+  constexpr std::uint32_t checkpointVersion = 1;
+}
+
+
+SVFilterState::SVFilterState(const StochasticVolatilityModel& model, const unsigned int& nParticles,
+                             const unsigned int& seed, const FilterOptions& options)
+    : model_(model), particleCount_(nParticles), seed_(seed), options_(options),
+      stepCount_(0), logLikeSum_(0.0), effectiveSampleSize_(nParticles), equallyWeighted_(true) {
+  if (nParticles == 0) {
+    throw std::invalid_argument("Number of particles must be greater than zero.");
+  }
+
+  particles_ = model_.initialDistribution(nParticles).sample(seed);
+  logWeights_ = Eigen::VectorXd::Constant(nParticles, -std::log(nParticles));
+  weights_ = Eigen::VectorXd::Constant(nParticles, 1.0 / nParticles);
+  scratch_.resize(nParticles);
+  buffer_.resize(nParticles);
+  ancestors_.resize(nParticles);
+  uniforms_.resize(nParticles);
+  residuals_.resize(nParticles);
+  orderBuffers_.reserve(nParticles);
+}
+
+
+void SVFilterState::step(const double& y) {
+  stepCount_++;
+  unsigned int stepSeed = StochasticVolatilityModel::stepSeed(seed_, stepCount_);
+
+  FilterStepStatistics statistics;
+  statistics.effectiveSampleSize = effectiveSampleSize_;
+  bool updated = model_.filterStep(particles_, logWeights_, weights_, scratch_, statistics, y, seed_, stepCount_,
+                                   options_.randomEngine, engine_, orderBuffers_, blockBuffers_, nullptr);
+
+  logLikeSum_ += statistics.weightedLogLikelihood;
+  effectiveSampleSize_ = statistics.effectiveSampleSize;
+
+  if (!updated) {
+    return;
+  }
+  equallyWeighted_ = false;
+
+  if (effectiveSampleSize_ < options_.essThreshold * particleCount_) {
+    generator_.seed(stepSeed);
+    if (options_.randomEngine == RandomEngine::Sobol) {
+      bootstrap::stateOrderedAncestors<double>(particles_, weights_, options_.resamplingScheme, generator_,
+                                               ancestors_, uniforms_, residuals_, orderBuffers_);
+    } else {
+      resampling::ancestorIndices(weights_, options_.resamplingScheme, generator_, ancestors_, uniforms_, residuals_);
+    }
+
+    for (unsigned int i = 0; i < particleCount_; ++i) {
+      buffer_[i] = particles_[ancestors_[i]];
+    }
+    particles_.swap(buffer_);
+
+    weights_.setConstant(1.0 / particleCount_);
+    logWeights_.setConstant(-std::log(particleCount_));
+    equallyWeighted_ = true;
+  }
+}
+
+
+double SVFilterState::getLogLikelihood() const {
+  if (stepCount_ == 0) {
+    return 0.0;
+  }
+
+  return logLikeSum_ / stepCount_;
+}
+
+double SVFilterState::getFilteredMean() const {
+  return weights_.dot(particles_);
+}
+
+double SVFilterState::getFilteredQuantile(const double& q) const {
+  return getFilteredQuantiles({q})[0];
+}
+
+Eigen::VectorXd SVFilterState::getFilteredQuantiles(const std::vector<double>& probabilities) const {
+  if (equallyWeighted_) {
+    return utilfuns::quantiles(particles_, probabilities);
+  }
+  return utilfuns::weightedQuantiles(particles_, weights_, probabilities);
+}
+
+double SVFilterState::getEffectiveSampleSize() const {
+  return effectiveSampleSize_;
+}
+
+Eigen::VectorXd SVFilterState::getParticles() const {
+  return particles_;
+}
+
+Eigen::VectorXd SVFilterState::getWeights() const {
+  return weights_;
+}
+
+
+unsigned int SVFilterState::getParticleCount() const {
+  return particleCount_;
+}
+
+unsigned int SVFilterState::getStepCount() const {
+  return stepCount_;
+}
+
+
+void SVFilterState::save(const std::string& path) const {
+  FilterCheckpointHeader header;
+  std::memcpy(header.magic, checkpointMagic, sizeof(header.magic));
+  header.version = checkpointVersion;
+  header.particleCount = particleCount_;
+  header.mu = model_.mu_;
+  header.phi = model_.phi_;
+  header.sigma = model_.sigma_;
+  header.seed = seed_;
+  header.stepCount = stepCount_;
+  header.logLikeSum = logLikeSum_;
+  header.effectiveSampleSize = effectiveSampleSize_;
+  header.essThreshold = options_.essThreshold;
+  header.resamplingScheme = static_cast<std::uint32_t>(options_.resamplingScheme);
+  header.randomEngine = static_cast<std::uint32_t>(options_.randomEngine);
+  header.equallyWeighted = equallyWeighted_;
+  header.reserved = 0;
+
+  const std::size_t bytes = sizeof(double) * particleCount_;
+  MappedFile file(path, MappingMode::Create, sizeof(header) + 3 * bytes);
+  char* base = static_cast<char*>(file.data());
+  std::memcpy(base, &header, sizeof(header));
+  std::memcpy(base + sizeof(header), particles_.data(), bytes);
+  std::memcpy(base + sizeof(header) + bytes, logWeights_.data(), bytes);
+  std::memcpy(base + sizeof(header) + 2 * bytes, weights_.data(), bytes);
+}
+
+SVFilterState SVFilterState::load(const std::string& path) {
+  MappedFile file(path, MappingMode::ReadOnly);
+  FilterCheckpointHeader header;
+  if (file.size() < sizeof(header)) {
+    throw std::invalid_argument("Not a filter checkpoint: " + path);
+  }
+  std::memcpy(&header, file.data(), sizeof(header));
+  if (std::memcmp(header.magic, checkpointMagic, sizeof(header.magic)) != 0) {
+    throw std::invalid_argument("Not a filter checkpoint: " + path);
+  }
+  if (header.version != checkpointVersion) {
+    throw std::invalid_argument("Unsupported filter checkpoint version " + std::to_string(header.version) + ".");
+  }
+  const std::size_t bytes = sizeof(double) * header.particleCount;
+  if (file.size() != sizeof(header) + 3 * bytes || header.resamplingScheme > 3 || header.randomEngine > 2) {
+    throw std::invalid_argument("Corrupt filter checkpoint: " + path);
+  }
+
+  FilterOptions options;
+  options.essThreshold = header.essThreshold;
+  options.resamplingScheme = static_cast<ResamplingScheme>(header.resamplingScheme);
+  options.randomEngine = static_cast<RandomEngine>(header.randomEngine);
+  SVFilterState state(StochasticVolatilityModel(header.mu, header.phi, header.sigma), header.particleCount, header.seed, options);
+
+  const char* base = static_cast<const char*>(file.data());
+  std::memcpy(state.particles_.data(), base + sizeof(header), bytes);
+  std::memcpy(state.logWeights_.data(), base + sizeof(header) + bytes, bytes);
+  std::memcpy(state.weights_.data(), base + sizeof(header) + 2 * bytes, bytes);
+  state.stepCount_ = header.stepCount;
+  state.logLikeSum_ = header.logLikeSum;
+  state.effectiveSampleSize_ = header.effectiveSampleSize;
+  state.equallyWeighted_ = header.equallyWeighted != 0;
+  return state;
+}
@@ -0,0 +1,119 @@
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#include "statistics/allocation_counter.h"
+
+
+namespace {
+  std::atomic<int> enabled(0);
+  std::atomic<long> allocations(0);
+  std::atomic<long> allocatedBytes(0);
+}
+
+#if defined(__GLIBC__)
+extern "C" {
+  void* __libc_malloc(std::size_t size);
+  void* __libc_calloc(std::size_t count, std::size_t size);
+  void* __libc_realloc(void* pointer, std::size_t size);
+}
+
+namespace {
+  void countAllocation(const std::size_t& size) {
+    if (enabled.load(std::memory_order_relaxed) > 0) {
+      allocations.fetch_add(1, std::memory_order_relaxed);
+      allocatedBytes.fetch_add(static_cast<long>(size), std::memory_order_relaxed);
+    }
+  }
+}
+
+extern "C" {
+  void* malloc(std::size_t size) {
+    countAllocation(size);
+    return __libc_malloc(size);
+  }
+
+  void* calloc(std::size_t count, std::size_t size) {
+    countAllocation(count * size);
+    return __libc_calloc(count, size);
+  }
+
+  void* realloc(void* pointer, std::size_t size) {
+    countAllocation(size);
+    return __libc_realloc(pointer, size);
+  }
+}
+
+//A shared library (the Python module, loaded RTLD_LOCAL) does not interpose on the process: its calls
+//only reach the definitions here when linked with -Bsymbolic-functions, and libstdc++'s operator new
+//would still call the C library's malloc. So new and delete are replaced as well, allocating through
+//__libc_malloc so that every call is counted once, in executables too.
+namespace {
+  void* allocate(const std::size_t& size) {
+    countAllocation(size);
+    return __libc_malloc(size == 0 ? 1 : size);
+  }
+}
+
+void* operator new(std::size_t size) {
+  void* pointer = allocate(size);
+  if (pointer == nullptr) {
+    throw std::bad_alloc();
+  }
+  return pointer;
+}
+
+void* operator new[](std::size_t size) {
+  return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+  return allocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+  return allocate(size);
+}
+
+void operator delete(void* pointer) noexcept {
+  std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+  std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept {
+  std::free(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t) noexcept {
+  std::free(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept {
+  std::free(pointer);
+}
+
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept {
+  std::free(pointer);
+}
+#endif
+
+
+void allocationcounter::enable() {
+  enabled.fetch_add(1, std::memory_order_relaxed);
+}
+
+void allocationcounter::disable() {
+  enabled.fetch_sub(1, std::memory_order_relaxed);
+}
+
+long allocationcounter::count() {
+  return allocations.load(std::memory_order_relaxed);
+}
+
+long allocationcounter::bytes() {
+  return allocatedBytes.load(std::memory_order_relaxed);
+}
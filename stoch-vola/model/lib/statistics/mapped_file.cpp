@@ -0,0 +1,160 @@
+#include <string>
+#include <cstring>
+#include <cerrno>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <Eigen/Dense>
+
+#include "statistics/mapped_file.h"
+
+
+namespace {
+  std::runtime_error systemError(const std::string& what, const std::string& path) {
+    return std::runtime_error(what + " " + path + ": " + std::strerror(errno));
+  }
+
+  const char trajectoryMagic[8] = {'S', 'V', 'T', 'R', 'A', 'J', '\0', '\0'};
+
+  Eigen::Map<const Eigen::VectorXd> seriesMap(const MappedFile& file, const std::size_t& offset) {
+    if (offset > file.size() || offset % sizeof(double) != 0 || (file.size() - offset) % sizeof(double) != 0) {
+      throw std::invalid_argument("Series file " + file.getPath() + " does not hold whole doubles after the offset.");
+    }
+    const double* data = file.size() > offset ? reinterpret_cast<const double*>(static_cast<const char*>(file.data()) + offset) : nullptr;
+    return Eigen::Map<const Eigen::VectorXd>(data, (file.size() - offset) / sizeof(double));
+  }
+}
+
+
+MappedFile::MappedFile(const std::string& path, const MappingMode& mode, const std::size_t& size)
+    : path_(path), descriptor_(-1), data_(nullptr), size_(size), mode_(mode) {
+  const int flags = mode == MappingMode::Create ? O_RDWR | O_CREAT | O_TRUNC : (mode == MappingMode::ReadWrite ? O_RDWR : O_RDONLY);
+  descriptor_ = ::open(path.c_str(), flags, 0644);
+  if (descriptor_ < 0) {
+    throw systemError("Cannot open", path);
+  }
+
+  if (mode == MappingMode::Create) {
+    //sparse on most file systems, untouched pages take no disk space
+    if (::ftruncate(descriptor_, static_cast<off_t>(size)) != 0) {
+      ::close(descriptor_);
+      throw systemError("Cannot resize", path);
+    }
+  } else {
+    struct stat status;
+    if (::fstat(descriptor_, &status) != 0) {
+      ::close(descriptor_);
+      throw systemError("Cannot stat", path);
+    }
+    size_ = static_cast<std::size_t>(status.st_size);
+  }
+
+  if (size_ == 0) {//mmap rejects empty mappings
+    return;
+  }
+
+  const int protection = mode == MappingMode::ReadOnly ? PROT_READ : PROT_READ | PROT_WRITE;
+  data_ = ::mmap(nullptr, size_, protection, MAP_SHARED, descriptor_, 0);
+  if (data_ == MAP_FAILED) {
+    data_ = nullptr;
+    ::close(descriptor_);
+    throw systemError("Cannot map", path);
+  }
+}
+
+MappedFile::~MappedFile() {
+  if (data_) {
+    ::munmap(data_, size_);
+  }
+  ::close(descriptor_);
+}
+
+void* MappedFile::data() {
+  return data_;
+}
+
+const void* MappedFile::data() const {
+  return data_;
+}
+
+std::size_t MappedFile::size() const {
+  return size_;
+}
+
+const std::string& MappedFile::getPath() const {
+  return path_;
+}
+
+MappingMode MappedFile::getMode() const {
+  return mode_;
+}
+
+
+TrajectoryFileHeader trajectoryfile::makeHeader(const std::uint32_t& scalarSize, const std::uint32_t& layout,
+                                                const std::uint64_t& particleCount, const std::uint64_t& particleLength) {
+  TrajectoryFileHeader header;
+  std::memcpy(header.magic, trajectoryMagic, sizeof(header.magic));
+  header.version = version;
+  header.scalarSize = scalarSize;
+  header.layout = layout;
+  header.pathStorage = 0;
+  header.particleCount = particleCount;
+  header.particleLength = particleLength;
+  header.currentRow = 0;
+  header.dataOffset = sizeof(TrajectoryFileHeader);
+  //parents start on an 8-byte boundary whatever the scalar
+  header.parentsOffset = header.dataOffset + (scalarSize * particleCount * particleLength + 7) / 8 * 8;
+  return header;
+}
+
+std::size_t trajectoryfile::fileSize(const TrajectoryFileHeader& header) {
+  return header.parentsOffset + sizeof(std::int32_t) * header.particleCount * header.particleLength;
+}
+
+void trajectoryfile::validateHeader(const TrajectoryFileHeader& header, const std::size_t& fileSize) {
+  if (std::memcmp(header.magic, trajectoryMagic, sizeof(header.magic)) != 0) {
+    throw std::invalid_argument("Not a trajectory file.");
+  }
+  if (header.version != version) {
+    throw std::invalid_argument("Unsupported trajectory file version " + std::to_string(header.version) + ".");
+  }
+  if ((header.scalarSize != 4 && header.scalarSize != 8) || header.layout > 1 || header.pathStorage > 1) {
+    throw std::invalid_argument("Corrupt trajectory file header.");
+  }
+  if (header.particleLength == 0 || header.currentRow >= header.particleLength
+      || header.dataOffset + header.scalarSize * header.particleCount * header.particleLength > fileSize
+      || (header.pathStorage == 1 && trajectoryfile::fileSize(header) > fileSize)) {
+    throw std::invalid_argument("Trajectory file is shorter than its header says.");
+  }
+}
+
+TrajectoryFileHeader trajectoryfile::readHeader(const std::string& path) {
+  return readHeader(MappedFile(path, MappingMode::ReadOnly));
+}
+
+TrajectoryFileHeader trajectoryfile::readHeader(const MappedFile& file) {
+  if (file.size() < sizeof(TrajectoryFileHeader)) {
+    throw std::invalid_argument("Not a trajectory file: " + file.getPath());
+  }
+
+  TrajectoryFileHeader header;
+  std::memcpy(&header, file.data(), sizeof(header));
+  validateHeader(header, file.size());
+  return header;
+}
+
+
+MappedSeries::MappedSeries(const std::string& path, const std::size_t& offset)
+    : file_(path, MappingMode::ReadOnly), series_(seriesMap(file_, offset)) {}
+
+const Eigen::Map<const Eigen::VectorXd>& MappedSeries::getSeries() const {
+  return series_;
+}
+
+Eigen::Index MappedSeries::size() const {
+  return series_.size();
+}
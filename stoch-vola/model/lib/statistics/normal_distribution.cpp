@@ -7,6 +7,7 @@
 #include <EigenRand/EigenRand>
 
 #include "statistics/normal_distribution.h"
+#include "statistics/random_engine.h"
 
 
 NormalDistribution::NormalDistribution(double mean, double std_dev) : mean_(mean), std_dev_(std_dev) {
@@ -40,22 +41,19 @@ double NormalDistribution::logLikelihood(double x) const {
 }
 
 std::vector<double> NormalDistribution::sample(size_t n, unsigned int seed) const {
-    setSeed(seed);
+    std::mt19937 generator(seed);
     std::normal_distribution<double> distribution(mean_, std_dev_);
     std::vector<double> samples(n);
     for (size_t i = 0; i < n; ++i) {
-        samples[i] = distribution(generator_);
+        samples[i] = distribution(generator);
     }
     return samples;
 }
 
-void NormalDistribution::setSeed(unsigned int seed) const {
-    generator_.seed(seed);
-}
-
 
 
-IndependentVectorNormal::IndependentVectorNormal(Eigen::VectorXd means, Eigen::VectorXd stdDevs) : means_(means), stdDevs_(stdDevs) {
+template <typename Scalar>
+IndependentVectorNormalT<Scalar>::IndependentVectorNormalT(Vector means, Vector stdDevs) : means_(means), stdDevs_(stdDevs) {
   if (means_.size() != stdDevs_.size()) {
     throw std::invalid_argument("Means and standard deviations must have the same length.");
   }
@@ -64,17 +62,20 @@ IndependentVectorNormal::IndependentVectorNormal(Eigen::VectorXd means, Eigen::V
   }
 }
 
-IndependentVectorNormal::IndependentVectorNormal(double mean, double stdDev, unsigned int n) : means_(Eigen::VectorXd::Constant(n, mean)), stdDevs_(Eigen::VectorXd::Constant(n, stdDev)) {
+template <typename Scalar>
+IndependentVectorNormalT<Scalar>::IndependentVectorNormalT(Scalar mean, Scalar stdDev, unsigned int n) : means_(Vector::Constant(n, mean)), stdDevs_(Vector::Constant(n, stdDev)) {
   if (stdDevs_.minCoeff() <= 0) {
     throw std::invalid_argument("Standard deviation must be greater than zero.");
   }
 }
 
-void IndependentVectorNormal::setMeans(Eigen::VectorXd means) {
+template <typename Scalar>
+void IndependentVectorNormalT<Scalar>::setMeans(Vector means) {
   means_ = means;
 }
 
-void IndependentVectorNormal::setStdDevs(Eigen::VectorXd stdDevs) {
+template <typename Scalar>
+void IndependentVectorNormalT<Scalar>::setStdDevs(Vector stdDevs) {
   if (stdDevs.minCoeff() <= 0) {
     throw std::invalid_argument("Standard deviations must be greater than zero.");
   }
@@ -82,74 +83,81 @@ void IndependentVectorNormal::setStdDevs(Eigen::VectorXd stdDevs) {
   stdDevs_ = stdDevs;
 }
 
-Eigen::VectorXd IndependentVectorNormal::getMeans() const {
+template <typename Scalar>
+typename IndependentVectorNormalT<Scalar>::Vector IndependentVectorNormalT<Scalar>::getMeans() const {
   return means_;
 }
 
-Eigen::VectorXd IndependentVectorNormal::getStdDevs() const {
+template <typename Scalar>
+typename IndependentVectorNormalT<Scalar>::Vector IndependentVectorNormalT<Scalar>::getStdDevs() const {
   return stdDevs_;
 }
 
-Eigen::VectorXd IndependentVectorNormal::pdfs(const Eigen::VectorXd& x) const {
+template <typename Scalar>
+typename IndependentVectorNormalT<Scalar>::Vector IndependentVectorNormalT<Scalar>::pdfs(const Vector& x) const {
   if (x.size() != means_.size()) {
     throw std::invalid_argument("Input vector must have the same length as means.");
   }
 
-  Eigen::VectorXd leftQuotient = stdDevs_ * std::sqrt(2.0*M_PI);
-  Eigen::VectorXd leftFactor = 1.0 / leftQuotient.array();
+  Vector leftQuotient = stdDevs_ * static_cast<Scalar>(std::sqrt(2.0*M_PI));
+  Vector leftFactor = Scalar(1) / leftQuotient.array();
 
-  Eigen::VectorXd xMuDiff = x.array() - means_.array();
-  Eigen::VectorXd rightFactor = (-0.5 * ((xMuDiff.array() / stdDevs_.array()).array().pow(2))).array().exp();
+  Vector xMuDiff = x.array() - means_.array();
+  Vector rightFactor = (Scalar(-0.5) * ((xMuDiff.array() / stdDevs_.array()).array().pow(2))).array().exp();
 
   return leftFactor.array() * rightFactor.array();
 }
 
-Eigen::VectorXd IndependentVectorNormal::pdfs(const double& x) const {
-  Eigen::VectorXd leftQuotient = stdDevs_ * std::sqrt(2.0*M_PI);
-  Eigen::VectorXd leftFactor = 1.0 / leftQuotient.array();
+template <typename Scalar>
+typename IndependentVectorNormalT<Scalar>::Vector IndependentVectorNormalT<Scalar>::pdfs(const Scalar& x) const {
+  Vector leftQuotient = stdDevs_ * static_cast<Scalar>(std::sqrt(2.0*M_PI));
+  Vector leftFactor = Scalar(1) / leftQuotient.array();
 
-  Eigen::VectorXd xMuDiff = x - means_.array();
-  Eigen::VectorXd rightFactor = (-0.5 * ((xMuDiff.array() / stdDevs_.array()).array().pow(2))).array().exp();
+  Vector xMuDiff = x - means_.array();
+  Vector rightFactor = (Scalar(-0.5) * ((xMuDiff.array() / stdDevs_.array()).array().pow(2))).array().exp();
 
   return leftFactor.array() * rightFactor.array();
 }
 
-Eigen::VectorXd IndependentVectorNormal::logLikelihoods(const Eigen::VectorXd& x) const {
+template <typename Scalar>
+typename IndependentVectorNormalT<Scalar>::Vector IndependentVectorNormalT<Scalar>::logLikelihoods(const Vector& x) const {
   if (x.size() != means_.size()) {
     throw std::invalid_argument("Input vector must have the same length as means.");
   }
-  Eigen::VectorXd leftFactor = -0.5 * std::log(2 * M_PI) - stdDevs_.array().log();
-  Eigen::VectorXd xMuDiff = x.array() - means_.array();
-  Eigen::VectorXd rightFactor = -0.5 * ((xMuDiff.array() / stdDevs_.array()).array().pow(2));
+  Vector leftFactor = static_cast<Scalar>(-0.5 * std::log(2 * M_PI)) - stdDevs_.array().log();
+  Vector xMuDiff = x.array() - means_.array();
+  Vector rightFactor = Scalar(-0.5) * ((xMuDiff.array() / stdDevs_.array()).array().pow(2));
 
   return leftFactor.array() + rightFactor.array();
 }
 
-Eigen::VectorXd IndependentVectorNormal::logLikelihoods(const double& x) const {
-  Eigen::VectorXd leftFactor = -0.5 * std::log(2 * M_PI) - stdDevs_.array().log();
-  Eigen::VectorXd xMuDiff = x - means_.array();
-  Eigen::VectorXd rightFactor = -0.5 * ((xMuDiff.array() / stdDevs_.array()).array().pow(2));
+template <typename Scalar>
+typename IndependentVectorNormalT<Scalar>::Vector IndependentVectorNormalT<Scalar>::logLikelihoods(const Scalar& x) const {
+  Vector leftFactor = static_cast<Scalar>(-0.5 * std::log(2 * M_PI)) - stdDevs_.array().log();
+  Vector xMuDiff = x - means_.array();
+  Vector rightFactor = Scalar(-0.5) * ((xMuDiff.array() / stdDevs_.array()).array().pow(2));
 
   return leftFactor.array() + rightFactor.array();
 }
 
-Eigen::MatrixXd IndependentVectorNormal::colWiseLogLikelihoods(const Eigen::MatrixXd& x) const {
-  Eigen::VectorXd leftFactor = -0.5 * std::log(2 * M_PI) - stdDevs_.array().log();
-  Eigen::MatrixXd xMuDiff = x.colwise() - means_;
-  Eigen::MatrixXd xZStandard = xMuDiff.array().colwise() / stdDevs_.array();
+template <typename Scalar>
+typename IndependentVectorNormalT<Scalar>::Matrix IndependentVectorNormalT<Scalar>::colWiseLogLikelihoods(const Matrix& x) const {
+  Vector leftFactor = static_cast<Scalar>(-0.5 * std::log(2 * M_PI)) - stdDevs_.array().log();
+  Matrix xMuDiff = x.colwise() - means_;
+  Matrix xZStandard = xMuDiff.array().colwise() / stdDevs_.array();
 
-  Eigen::MatrixXd rightFactor = -0.5 * xZStandard.array().pow(2);
+  Matrix rightFactor = Scalar(-0.5) * xZStandard.array().pow(2);
    
   return rightFactor.colwise() + leftFactor;
 }
 
 
-Eigen::VectorXd IndependentVectorNormal::sample(unsigned int seed) const {
-  Eigen::Rand::P8_mt19937_64 rng{seed};
+template <typename Scalar>
+typename IndependentVectorNormalT<Scalar>::Vector IndependentVectorNormalT<Scalar>::sample(unsigned int seed) const {
+  ReseedableMersenneTwister rng{seed}; //the stream of Eigen::Rand::P8_mt19937_64
 
-  int sampleSize = means_.size();
-  Eigen::MatrixXd samplesMatrix = Eigen::Rand::normal<Eigen::MatrixXd>(sampleSize, 1, rng);
-  Eigen::VectorXd samples = samplesMatrix.col(0);
+  Vector samples;
+  rng.standardNormal(samples, means_.size());
 
   samples.array() *= stdDevs_.array();
   samples.array() += means_.array();
@@ -157,3 +165,6 @@ Eigen::VectorXd IndependentVectorNormal::sample(unsigned int seed) const {
   return samples;
 }
 
+
+template class IndependentVectorNormalT<double>;
+template class IndependentVectorNormalT<float>;
@@ -1,4 +1,8 @@
 #include <vector>
+#include <string>
+#include <memory>
+#include <new>
+#include <cstring>
 #include <stdexcept>
 #include <random>
 #include <functional>
@@ -6,17 +10,24 @@
 
 #include <statistics/particles.h>
 #include <statistics/normal_distribution.h>
+#include <statistics/resampling.h>
+#include <statistics/mapped_file.h>
+#include <statistics/util_funs.h>
 
 
-Particles::Particles(const Eigen::VectorXd& initialParticles, const unsigned int& particleLength) {
+template <typename Scalar>
+ParticlesT<Scalar>::ParticlesT(const Vector& initialParticles, const unsigned int& particleLength,
+                     const ParticleLayout& layout, const std::string& storageFile) {
   particleCount_ = initialParticles.size();
   particleLength_ = particleLength;
   currentRow_ = 0;
-  particles_ = Eigen::MatrixXd::Zero(particleLength, particleCount_);
-  particles_.row(0) = initialParticles;
+  layout_ = layout;
+  allocateParticles(initialParticles, storageFile);
 }
 
-Particles::Particles(const Eigen::MatrixXd& initialParticles, const unsigned int& particleLength) {
+template <typename Scalar>
+ParticlesT<Scalar>::ParticlesT(const Matrix& initialParticles, const unsigned int& particleLength,
+                     const ParticleLayout& layout) {
   if (initialParticles.rows() > particleLength) {
     throw std::invalid_argument("Initial particles cannot be longer than particle length.");
   }
@@ -24,63 +35,264 @@ Particles::Particles(const Eigen::MatrixXd& initialParticles, const unsigned int
   particleCount_ = initialParticles.cols();
   particleLength_ = particleLength;
   currentRow_ = 0;
-  particles_ = Eigen::MatrixXd::Zero(particleLength, particleCount_);
-  particles_.topRows(initialParticles.rows()) = initialParticles;
+  layout_ = layout;
+  Matrix particles = Matrix::Zero(particleLength, particleCount_);
+  particles.topRows(initialParticles.rows()) = initialParticles;
+  storeParticles(particles);
 }
 
 
-Particles::Particles(const std::vector<double>& initialParticles, const unsigned int& particleLength) {
+template <typename Scalar>
+ParticlesT<Scalar>::ParticlesT(const std::vector<Scalar>& initialParticles, const unsigned int& particleLength,
+                     const ParticleLayout& layout, const std::string& storageFile) {
   particleCount_ = initialParticles.size();
   particleLength_ = particleLength;
   currentRow_ = 0;
-  particles_ = Eigen::MatrixXd::Zero(particleLength, particleCount_);
-  particles_.row(0) = Eigen::Map<const Eigen::RowVectorXd>(initialParticles.data(), initialParticles.size());
+  layout_ = layout;
+  allocateParticles(Eigen::Map<const Vector>(initialParticles.data(), initialParticles.size()), storageFile);
 }
 
 
-Particles::Particles(const std::vector<std::vector<double>>& initialParticles, const unsigned int& particleLength) {
+template <typename Scalar>
+ParticlesT<Scalar>::ParticlesT(const std::vector<std::vector<Scalar>>& initialParticles, const unsigned int& particleLength,
+                     const ParticleLayout& layout) {
   if (initialParticles.size() > particleLength) {
     throw std::invalid_argument("Initial particles cannot be longer than particle length.");
   }
   particleCount_ = initialParticles.size();
   particleLength_ = particleLength;
   currentRow_ = initialParticles[0].size() - 1;
+  layout_ = layout;
 
-  particles_ = Eigen::MatrixXd::Zero(particleLength_, particleCount_);
-  for (int col = 0; col < particleCount_; ++col) {
-      int len = particleLength_;  
-      for (int row = 0; row < len && row < particleLength_; ++row) {
-          particles_(row, col) = initialParticles[col][row];
+  Matrix particles = Matrix::Zero(particleLength_, particleCount_);
+  for (unsigned int col = 0; col < particleCount_; ++col) {
+      const std::size_t len = initialParticles[col].size();
+      for (unsigned int row = 0; row < len && row < particleLength_; ++row) {
+          particles(row, col) = initialParticles[col][row];
       }
   }
+  storeParticles(particles);
 }
 
-Particles::Particles(const NormalDistribution& dist, const unsigned int& nParticles,
+template <typename Scalar>
+ParticlesT<Scalar>::ParticlesT(const NormalDistribution& dist, const unsigned int& nParticles,
           const unsigned int& particleLength,
-          const unsigned int& seed) {
+          const unsigned int& seed,
+          const ParticleLayout& layout,
+          const std::string& storageFile) {
   particleCount_ = nParticles;
   particleLength_ = particleLength;
   currentRow_ = 0;
-  particles_ = Eigen::MatrixXd::Zero(particleLength, particleCount_);
+  layout_ = layout;
   std::vector<double> samples = dist.sample(nParticles, seed);
-  particles_.row(0) = Eigen::Map<const Eigen::RowVectorXd>(samples.data(), samples.size());
+  allocateParticles(Eigen::Map<const Eigen::VectorXd>(samples.data(), samples.size()).cast<Scalar>(), storageFile);
 }
 
 
-Particles::Particles(const IndependentVectorNormal& dist,
+template <typename Scalar>
+ParticlesT<Scalar>::ParticlesT(const IndependentVectorNormalT<Scalar>& dist,
           const unsigned int& particleLength,
-          const unsigned int& seed) {
+          const unsigned int& seed,
+          const ParticleLayout& layout,
+          const std::string& storageFile) {
   particleCount_ = dist.getMeans().size();
   particleLength_ = particleLength;
   currentRow_ = 0;
-  particles_ = Eigen::MatrixXd::Zero(particleLength, particleCount_);
-  Eigen::VectorXd samples = dist.sample(seed);
-  particles_.row(0) = Eigen::Map<const Eigen::RowVectorXd>(samples.data(), samples.size());
+  layout_ = layout;
+  allocateParticles(dist.sample(seed), storageFile);
 }
 
-bool Particles::operator==(const Particles& other) const {
-  Eigen::MatrixXd left = particles_; 
-  Eigen::MatrixXd right = other.particles_;
+
+template <typename Scalar>
+ParticlesT<Scalar>::ParticlesT(const ParticlesT& other)
+    : particleCount_(other.particleCount_), particleLength_(other.particleLength_), currentRow_(other.currentRow_),
+      layout_(other.layout_), pathStorage_(other.pathStorage_) {
+  copyStorage(other);
+}
+
+template <typename Scalar>
+ParticlesT<Scalar>::ParticlesT(ParticlesT&& other)
+    : memory_(std::move(other.memory_)), parentMemory_(std::move(other.parentMemory_)), file_(std::move(other.file_)),
+      particleCount_(other.particleCount_), particleLength_(other.particleLength_), currentRow_(other.currentRow_),
+      layout_(other.layout_), pathStorage_(other.pathStorage_) {
+  bindStorage();
+  other.bindStorage();
+}
+
+template <typename Scalar>
+ParticlesT<Scalar>& ParticlesT<Scalar>::operator=(const ParticlesT& other) {
+  if (this != &other) {
+    particleCount_ = other.particleCount_;
+    particleLength_ = other.particleLength_;
+    currentRow_ = other.currentRow_;
+    layout_ = other.layout_;
+    pathStorage_ = other.pathStorage_;
+    copyStorage(other);
+  }
+  return *this;
+}
+
+template <typename Scalar>
+ParticlesT<Scalar>& ParticlesT<Scalar>::operator=(ParticlesT&& other) {
+  if (this != &other) {
+    memory_ = std::move(other.memory_);
+    parentMemory_ = std::move(other.parentMemory_);
+    file_ = std::move(other.file_);
+    particleCount_ = other.particleCount_;
+    particleLength_ = other.particleLength_;
+    currentRow_ = other.currentRow_;
+    layout_ = other.layout_;
+    pathStorage_ = other.pathStorage_;
+    bindStorage();
+    other.bindStorage();
+  }
+  return *this;
+}
+
+template <typename Scalar>
+ParticlesT<Scalar> ParticlesT<Scalar>::openStorageFile(const std::string& path) {
+  std::unique_ptr<MappedFile> file(new MappedFile(path, MappingMode::ReadWrite));
+  ParticlesT result;
+  result.readHeader(trajectoryfile::readHeader(*file));
+  result.file_.swap(file);
+  result.bindStorage();
+  return result;
+}
+
+template <typename Scalar>
+ParticlesT<Scalar> ParticlesT<Scalar>::load(const std::string& path) {
+  MappedFile file(path, MappingMode::ReadOnly);
+  const TrajectoryFileHeader header = trajectoryfile::readHeader(file);
+  const char* base = static_cast<const char*>(file.data());
+
+  ParticlesT result;
+  result.readHeader(header);
+  const long rows = result.layout_ == ParticleLayout::TimeMajor ? result.particleCount_ : result.particleLength_;
+  const long cols = result.layout_ == ParticleLayout::TimeMajor ? result.particleLength_ : result.particleCount_;
+  result.memory_ = Eigen::Map<const Matrix>(reinterpret_cast<const Scalar*>(base + header.dataOffset), rows, cols);
+  if (result.pathStorage_ == PathStorage::Genealogy) {
+    result.parentMemory_ = Eigen::Map<const Eigen::MatrixXi>(reinterpret_cast<const int*>(base + header.parentsOffset), rows, cols);
+  }
+  result.bindStorage();
+  return result;
+}
+
+template <typename Scalar>
+void ParticlesT<Scalar>::save(const std::string& path) const {
+  if (file_ && file_->getPath() == path) {//already there
+    return;
+  }
+  writeFile(path, true);
+}
+
+template <typename Scalar>
+void ParticlesT<Scalar>::readHeader(const TrajectoryFileHeader& header) {
+  if (header.scalarSize != sizeof(Scalar)) {
+    throw std::invalid_argument("Trajectory file holds particles of another precision.");
+  }
+  particleCount_ = header.particleCount;
+  particleLength_ = header.particleLength;
+  currentRow_ = header.currentRow;
+  layout_ = header.layout == 1 ? ParticleLayout::TimeMajor : ParticleLayout::TraceMajor;
+  pathStorage_ = header.pathStorage == 1 ? PathStorage::Genealogy : PathStorage::Copy;
+}
+
+template <typename Scalar>
+std::unique_ptr<MappedFile> ParticlesT<Scalar>::writeFile(const std::string& path, const bool& compact) const {
+  TrajectoryFileHeader header = trajectoryfile::makeHeader(sizeof(Scalar), layout_ == ParticleLayout::TimeMajor,
+                                                           particleCount_, particleLength_);
+  header.currentRow = currentRow_;
+  header.pathStorage = pathStorage_ == PathStorage::Genealogy;
+  const bool withParents = !compact || pathStorage_ == PathStorage::Genealogy;
+
+  std::unique_ptr<MappedFile> file(new MappedFile(path, MappingMode::Create,
+                                                  withParents ? trajectoryfile::fileSize(header) : header.parentsOffset));
+  char* base = static_cast<char*>(file->data());
+  std::memcpy(base, &header, sizeof(header));
+  Eigen::Map<Matrix>(reinterpret_cast<Scalar*>(base + header.dataOffset), particles_.rows(), particles_.cols()) = particles_;
+  if (pathStorage_ == PathStorage::Genealogy) {
+    Eigen::Map<Eigen::MatrixXi>(reinterpret_cast<int*>(base + header.parentsOffset), parents_.rows(), parents_.cols()) = parents_;
+  }
+  return file;
+}
+
+
+template <typename Scalar>
+void ParticlesT<Scalar>::allocateParticles(const Eigen::Ref<const Vector>& initialParticles, const std::string& storageFile) {
+  const bool timeMajor = layout_ == ParticleLayout::TimeMajor;
+  if (storageFile.empty()) {
+    memory_ = timeMajor ? Matrix::Zero(particleCount_, particleLength_) : Matrix::Zero(particleLength_, particleCount_);
+  } else {//a new file reads as zeros
+    TrajectoryFileHeader header = trajectoryfile::makeHeader(sizeof(Scalar), timeMajor, particleCount_, particleLength_);
+    file_.reset(new MappedFile(storageFile, MappingMode::Create, trajectoryfile::fileSize(header)));
+    std::memcpy(file_->data(), &header, sizeof(header));
+  }
+  bindStorage();
+
+  if (timeMajor) {
+    particles_.col(0) = initialParticles;
+  } else {
+    particles_.row(0) = initialParticles.transpose();
+  }
+}
+
+template <typename Scalar>
+void ParticlesT<Scalar>::storeParticles(const Matrix& particles) {
+  if (layout_ == ParticleLayout::TimeMajor) {
+    memory_ = particles.transpose();
+  } else {
+    memory_ = particles;
+  }
+  bindStorage();
+}
+
+template <typename Scalar>
+void ParticlesT<Scalar>::bindStorage() {
+  //Eigen's way of pointing an existing Map at other memory
+  if (!file_) {
+    new (&particles_) Eigen::Map<Matrix>(memory_.data(), memory_.rows(), memory_.cols());
+    new (&parents_) Eigen::Map<Eigen::MatrixXi>(parentMemory_.data(), parentMemory_.rows(), parentMemory_.cols());
+    return;
+  }
+
+  const bool timeMajor = layout_ == ParticleLayout::TimeMajor;
+  const long rows = timeMajor ? particleCount_ : particleLength_;
+  const long cols = timeMajor ? particleLength_ : particleCount_;
+  char* base = static_cast<char*>(file_->data());
+  new (&particles_) Eigen::Map<Matrix>(reinterpret_cast<Scalar*>(base + header()->dataOffset), rows, cols);
+  if (pathStorage_ == PathStorage::Genealogy) {
+    new (&parents_) Eigen::Map<Eigen::MatrixXi>(reinterpret_cast<int*>(base + header()->parentsOffset), rows, cols);
+  } else {
+    new (&parents_) Eigen::Map<Eigen::MatrixXi>(nullptr, 0, 0);
+  }
+}
+
+template <typename Scalar>
+void ParticlesT<Scalar>::copyStorage(const ParticlesT& other) {
+  memory_ = other.particles_;
+  parentMemory_ = other.parents_;
+  file_.reset();
+  bindStorage();
+}
+
+template <typename Scalar>
+TrajectoryFileHeader* ParticlesT<Scalar>::header() {
+  return static_cast<TrajectoryFileHeader*>(file_->data());
+}
+
+template <typename Scalar>
+void ParticlesT<Scalar>::writeHeader() {
+  if (file_) {
+    header()->particleLength = particleLength_;
+    header()->currentRow = currentRow_;
+    header()->pathStorage = pathStorage_ == PathStorage::Genealogy;
+  }
+}
+
+template <typename Scalar>
+bool ParticlesT<Scalar>::operator==(const ParticlesT& other) const {
+  Matrix left = tracedParticles(); 
+  Matrix right = other.tracedParticles();
 
   unsigned int particleCount = particleCount_;
   unsigned int particleLength = particleLength_;
@@ -93,31 +305,117 @@ bool Particles::operator==(const Particles& other) const {
 }
 
 
-void Particles::applyTransformation(const std::function<double(double)>& func) {
+template <typename Scalar>
+void ParticlesT<Scalar>::applyTransformation(const std::function<Scalar(Scalar)>& func) {
   particles_ = particles_.unaryExpr(func);
 }
 
 
-Eigen::VectorXd Particles::reduceParticles(const std::function<double(const Eigen::VectorXd&)>& func) const {
-  Eigen::VectorXd result(particleLength_);
-  for (int row = 0; row < particleLength_; ++row) {
-      result[row] = func(particles_.row(row));
+template <typename Scalar>
+typename ParticlesT<Scalar>::Vector ParticlesT<Scalar>::reduceParticles(const std::function<Scalar(const Vector&)>& func) const {
+  Matrix particles = tracedParticles();
+  Vector result(particleLength_);
+  for (unsigned int row = 0; row < particleLength_; ++row) {
+      result[row] = func(particles.row(row));
   }
 
   return result;
 }
 
-Eigen::VectorXd Particles::reduceTraces(const std::function<double(const Eigen::VectorXd&)>& func) const {
-  Eigen::VectorXd result(particleCount_);
-  for (int col = 0; col < particleCount_; ++col) {
-      result[col] = func(particles_.col(col));
+template <typename Scalar>
+typename ParticlesT<Scalar>::Vector ParticlesT<Scalar>::reduceTraces(const std::function<Scalar(const Vector&)>& func) const {
+  Matrix particles = tracedParticles();
+  Vector result(particleCount_);
+  for (unsigned int col = 0; col < particleCount_; ++col) {
+      result[col] = func(particles.col(col));
   }
 
   return result;
 }
 
 
-void Particles::appendParticles(const Eigen::VectorXd& newParticles) {
+template <typename Scalar>
+Eigen::Map<const typename ParticlesT<Scalar>::Matrix> ParticlesT<Scalar>::tracedView(Matrix& buffer, bool& timeMajor) const {
+  if (pathStorage_ == PathStorage::Copy) {
+    timeMajor = layout_ == ParticleLayout::TimeMajor;
+    return getStorage();
+  }
+  buffer = tracedParticles();
+  timeMajor = false;
+  return Eigen::Map<const Matrix>(buffer.data(), buffer.rows(), buffer.cols());
+}
+
+template <typename Scalar>
+typename ParticlesT<Scalar>::Vector ParticlesT<Scalar>::particleMeans(const unsigned int& threadCount) const {
+  Matrix buffer;
+  bool timeMajor;
+  Eigen::Map<const Matrix> particles = tracedView(buffer, timeMajor);
+  Vector result(particleLength_);
+  forEachBlock(particleLength_, particles.size(), threadCount, [&](const long& begin, const long& end) {
+    if (timeMajor) {
+      result.segment(begin, end - begin) = particles.middleCols(begin, end - begin).colwise().mean().transpose();
+    } else {
+      result.segment(begin, end - begin) = particles.middleRows(begin, end - begin).rowwise().mean();
+    }
+  });
+  return result;
+}
+
+template <typename Scalar>
+typename ParticlesT<Scalar>::Vector ParticlesT<Scalar>::particleVariances(const unsigned int& threadCount) const {
+  Matrix buffer;
+  bool timeMajor;
+  Eigen::Map<const Matrix> particles = tracedView(buffer, timeMajor);
+  Vector result(particleLength_);
+  const Scalar count = static_cast<Scalar>(particleCount_);
+  //two passes, the deviations from the mean rather than the mean of the squares
+  forEachBlock(particleLength_, particles.size(), threadCount, [&](const long& begin, const long& end) {
+    if (timeMajor) {
+      const auto block = particles.middleCols(begin, end - begin);
+      const RowVector means = block.colwise().mean();
+      result.segment(begin, end - begin) = (block.rowwise() - means).colwise().squaredNorm().transpose() / count;
+    } else {
+      const auto block = particles.middleRows(begin, end - begin);
+      const Vector means = block.rowwise().mean();
+      result.segment(begin, end - begin) = (block.colwise() - means).rowwise().squaredNorm() / count;
+    }
+  });
+  return result;
+}
+
+template <typename Scalar>
+typename ParticlesT<Scalar>::Matrix ParticlesT<Scalar>::particleQuantiles(const std::vector<double>& probabilities,
+                                                                         const unsigned int& threadCount) const {
+  if (particleCount_ == 0) {
+    throw std::invalid_argument("Particles are empty.");
+  }
+  const std::vector<int> order = utilfuns::quantileOrder(probabilities);
+
+  Matrix buffer;
+  bool timeMajor;
+  Eigen::Map<const Matrix> particles = tracedView(buffer, timeMajor);
+  Matrix result(particleLength_, probabilities.size());
+  forEachBlock(particleLength_, particles.size(), threadCount, [&](const long& begin, const long& end) {
+    Vector cloud(particleCount_);
+    std::vector<double> values(probabilities.size());
+    for (long t = begin; t < end; ++t) {
+      if (timeMajor) {
+        cloud = particles.col(t);
+      } else {
+        cloud = particles.row(t).transpose();
+      }
+      utilfuns::selectQuantiles(cloud.data(), particleCount_, probabilities, order, values.data());
+      for (size_t k = 0; k < values.size(); ++k) {
+        result(t, k) = static_cast<Scalar>(values[k]);
+      }
+    }
+  });
+  return result;
+}
+
+
+template <typename Scalar>
+void ParticlesT<Scalar>::appendParticles(const Vector& newParticles) {
   if (currentRow_ >= particleLength_ - 1) {
     throw std::invalid_argument("Cannot append more particles.");
   }
@@ -125,59 +423,292 @@ void Particles::appendParticles(const Eigen::VectorXd& newParticles) {
     throw std::invalid_argument("Number of new particles must be equal to the number of particles in the object.");
   }
 
-  particles_.row(currentRow_+1) = newParticles;
+  if (layout_ == ParticleLayout::TimeMajor) {
+    particles_.col(currentRow_+1) = newParticles;
+    if (pathStorage_ == PathStorage::Genealogy) {
+      parents_.col(currentRow_+1) = Eigen::VectorXi::LinSpaced(particleCount_, 0, particleCount_-1);
+    }
+  } else {
+    particles_.row(currentRow_+1) = newParticles;
+    if (pathStorage_ == PathStorage::Genealogy) {
+      parents_.row(currentRow_+1) = Eigen::RowVectorXi::LinSpaced(particleCount_, 0, particleCount_-1);
+    }
+  }
   currentRow_++;
+  writeHeader();
 }
 
-Eigen::VectorXd Particles::getLatestParticles() const {
-  Eigen::VectorXd result = particles_.row(currentRow_);
+template <typename Scalar>
+typename ParticlesT<Scalar>::Vector ParticlesT<Scalar>::getLatestParticles() const {
+  if (layout_ == ParticleLayout::TimeMajor) {
+    return particles_.col(currentRow_);
+  }
+
+  Vector result = particles_.row(currentRow_);
   return result;
 }
 
-Eigen::MatrixXd Particles::getParticlesAsEigenMatrix() const {
-  return particles_;
+template <typename Scalar>
+typename ParticlesT<Scalar>::Matrix ParticlesT<Scalar>::getParticlesAsEigenMatrix() const {
+  return tracedParticles();
+}
+
+template <typename Scalar>
+Eigen::Map<const typename ParticlesT<Scalar>::Matrix> ParticlesT<Scalar>::getStorage() const {
+  return Eigen::Map<const Matrix>(particles_.data(), particles_.rows(), particles_.cols());
+}
+
+template <typename Scalar>
+void ParticlesT<Scalar>::resampleParticles(const std::vector<double>& weights, const unsigned int& seed) {
+  Eigen::Map<const Eigen::VectorXd> weightsMap(weights.data(), weights.size());
+  resampleParticles(weightsMap, ResamplingScheme::Multinomial, seed);
 }
 
-void Particles::resampleParticles(const std::vector<double>& weights, const unsigned int& seed) {
+template <typename Scalar>
+void ParticlesT<Scalar>::resampleParticles(const Eigen::Ref<const Eigen::VectorXd>& weights,
+                                  const ResamplingScheme& scheme,
+                                  const unsigned int& seed) {
   if (weights.size() != particleCount_) {
     throw std::invalid_argument("Number of weights must be equal to the number of particles in the object.");
   }
-  setSeed(seed);
-  std::discrete_distribution<int> distribution(weights.begin(), weights.end());
+  std::mt19937 generator(seed);
+  Eigen::VectorXi ancestors = resampling::ancestorIndices(weights, scheme, generator);
+
+  applyAncestors(ancestors);
+}
+
+template <typename Scalar>
+void ParticlesT<Scalar>::applyAncestors(const Eigen::VectorXi& ancestors) {
+  if (ancestors.size() != particleCount_) {
+    throw std::invalid_argument("Number of ancestors must be equal to the number of particles in the object.");
+  }
+
+  if (pathStorage_ == PathStorage::Copy && file_) {//gathered one time step at a time, the file is never duplicated
+    Vector buffer(particleCount_);
+    for (unsigned int row = 0; row < particleLength_; ++row) {
+      for (unsigned int col = 0; col < particleCount_; ++col) {
+        buffer[col] = layout_ == ParticleLayout::TimeMajor ? particles_(ancestors[col], row) : particles_(row, ancestors[col]);
+      }
+      if (layout_ == ParticleLayout::TimeMajor) {
+        particles_.col(row) = buffer;
+      } else {
+        particles_.row(row) = buffer.transpose();
+      }
+    }
+    return;
+  }
+
+  if (pathStorage_ == PathStorage::Copy) {
+    Matrix newParticles(particles_.rows(), particles_.cols());
+
+    if (layout_ == ParticleLayout::TimeMajor) {//gather within every contiguous time step
+      for (unsigned int row = 0; row < particleLength_; ++row) {
+        for (unsigned int col = 0; col < particleCount_; ++col) {
+          newParticles(col, row) = particles_(ancestors[col], row);
+        }
+      }
+    } else {
+      for (unsigned int col = 0; col < particleCount_; ++col) {
+        newParticles.col(col) = particles_.col(ancestors[col]);
+      }
+    }
+
+    memory_.swap(newParticles);
+    bindStorage();
+    return;
+  }
+
+  //only the latest row moves, older rows are reached through the parent indices
+  if (layout_ == ParticleLayout::TimeMajor) {
+    Vector latest = particles_.col(currentRow_);
+    Eigen::VectorXi parents = parents_.col(currentRow_);
+
+    for (unsigned int col = 0; col < particleCount_; ++col) {
+      particles_(col, currentRow_) = latest[ancestors[col]];
+      parents_(col, currentRow_) = parents[ancestors[col]];
+    }
+    return;
+  }
 
-  Eigen::MatrixXd newParticles = Eigen::MatrixXd::Zero(particleLength_, particleCount_);
+  RowVector latest = particles_.row(currentRow_);
+  Eigen::RowVectorXi parents = parents_.row(currentRow_);
 
-  for (int col = 0; col < particleCount_; ++col) {
-    int index = distribution(generator_);
-    newParticles.col(col) = particles_.col(index);
+  for (unsigned int col = 0; col < particleCount_; ++col) {
+    particles_(currentRow_, col) = latest[ancestors[col]];
+    parents_(currentRow_, col) = parents[ancestors[col]];
   }
+}
+
+template <typename Scalar>
+typename ParticlesT<Scalar>::Matrix ParticlesT<Scalar>::tracedParticles() const {
+  const bool timeMajor = layout_ == ParticleLayout::TimeMajor;
+  Matrix result = timeMajor ? Matrix(particles_.transpose()) : Matrix(particles_);
+  if (pathStorage_ == PathStorage::Copy) {
+    return result;
+  }
+
+  //rows after currentRow_ have not been appended yet and are returned as stored
+  Eigen::VectorXi indices = Eigen::VectorXi::LinSpaced(particleCount_, 0, particleCount_-1);
+
+  for (int row = currentRow_; row >= 0; --row) {
+    for (unsigned int col = 0; col < particleCount_; ++col) {
+      result(row, col) = timeMajor ? particles_(indices[col], row) : particles_(row, indices[col]);
+    }
+    if (row > 0) {
+      for (unsigned int col = 0; col < particleCount_; ++col) {
+        indices[col] = timeMajor ? parents_(indices[col], row) : parents_(row, indices[col]);
+      }
+    }
+  }
+
+  return result;
+}
 
-  particles_ = newParticles;
+template <typename Scalar>
+void ParticlesT<Scalar>::traceInPlace() {
+  //every time step only reads and writes its own particles, so a buffer of one step suffices
+  const bool timeMajor = layout_ == ParticleLayout::TimeMajor;
+  Eigen::VectorXi indices = Eigen::VectorXi::LinSpaced(particleCount_, 0, particleCount_-1);
+  Vector buffer(particleCount_);
+
+  for (int row = currentRow_; row >= 0; --row) {
+    for (unsigned int col = 0; col < particleCount_; ++col) {
+      buffer[col] = timeMajor ? particles_(indices[col], row) : particles_(row, indices[col]);
+    }
+    if (timeMajor) {
+      particles_.col(row) = buffer;
+    } else {
+      particles_.row(row) = buffer.transpose();
+    }
+    if (row > 0) {
+      for (unsigned int col = 0; col < particleCount_; ++col) {
+        indices[col] = timeMajor ? parents_(indices[col], row) : parents_(row, indices[col]);
+      }
+    }
+  }
 }
 
 
-Particles Particles::getParticlesWithoutInit() const {
+template <typename Scalar>
+ParticlesT<Scalar> ParticlesT<Scalar>::getParticlesWithoutInit() const {
   if (particleLength_ == 1) {
     throw std::invalid_argument("Cannot remove initial particles.");
   }
    
   //return from second row to end 
-  Eigen::MatrixXd newParticles = particles_.bottomRows(particleLength_-1);
-  Particles result(newParticles, particleLength_-1);
+  Matrix newParticles = tracedParticles().bottomRows(particleLength_-1);
+  ParticlesT result(newParticles, particleLength_-1, layout_);
 
   return result;
 }
 
+template <typename Scalar>
+void ParticlesT<Scalar>::removeInitialParticles() {
+  if (particleLength_ == 1) {
+    throw std::invalid_argument("Cannot remove initial particles.");
+  }
+
+  setPathStorage(PathStorage::Copy);
+  const long length = particleLength_ - 1;
+  if (!file_) {
+    Matrix kept = layout_ == ParticleLayout::TimeMajor ? Matrix(memory_.rightCols(length)) : Matrix(memory_.bottomRows(length));
+    memory_.swap(kept);
+  } else if (layout_ == ParticleLayout::TimeMajor) {//drop the first column
+    std::memmove(particles_.data(), particles_.data() + particleCount_, sizeof(Scalar) * particleCount_ * length);
+  } else {//close the gap of every trajectory, front to back so no trajectory is overwritten before it moves
+    for (long col = 0; col < particleCount_; ++col) {
+      std::memmove(particles_.data() + col * length, particles_.data() + col * particleLength_ + 1, sizeof(Scalar) * length);
+    }
+  }
+
+  particleLength_--;
+  currentRow_ = currentRow_ > 0 ? currentRow_ - 1 : 0;
+  bindStorage();
+  writeHeader();
+}
+
+
+template <typename Scalar>
+void ParticlesT<Scalar>::setPathStorage(const PathStorage& storage) {
+  if (storage == pathStorage_) {
+    return;
+  }
+
+  if (storage == PathStorage::Genealogy) {
+    if (file_ && trajectoryfile::fileSize(*header()) > file_->size()) {
+      throw std::invalid_argument("Trajectory file has no room for the genealogy.");
+    }
+    pathStorage_ = storage;
+    if (!file_) {
+      parentMemory_.resize(particles_.rows(), particles_.cols());
+    }
+    bindStorage();
+
+    Eigen::VectorXi identity = Eigen::VectorXi::LinSpaced(particleCount_, 0, particleCount_-1);
+    if (layout_ == ParticleLayout::TimeMajor) {
+      parents_ = identity.replicate(1, particleLength_);
+    } else {
+      parents_ = identity.transpose().replicate(particleLength_, 1);
+    }
+  } else {
+    traceInPlace();
+    pathStorage_ = storage;
+    parentMemory_.resize(0, 0);
+    bindStorage();
+  }
+
+  writeHeader();
+}
+
+template <typename Scalar>
+PathStorage ParticlesT<Scalar>::getPathStorage() const {
+  return pathStorage_;
+}
+
+template <typename Scalar>
+ParticleLayout ParticlesT<Scalar>::getLayout() const {
+  return layout_;
+}
+
+
+template <typename Scalar>
+void ParticlesT<Scalar>::setStorageFile(const std::string& path) {
+  if (path.empty()) {
+    if (file_) {
+      memory_ = particles_;
+      parentMemory_ = parents_;
+      file_.reset();
+      bindStorage();
+    }
+    return;
+  }
+  if (file_ && file_->getPath() == path) {
+    return;
+  }
+
+  std::unique_ptr<MappedFile> file = writeFile(path, false);
+  file_.swap(file);
+  memory_.resize(0, 0);
+  parentMemory_.resize(0, 0);
+  bindStorage();
+}
+
+template <typename Scalar>
+std::string ParticlesT<Scalar>::getStorageFile() const {
+  return file_ ? file_->getPath() : std::string();
+}
+
 
-unsigned int Particles::getParticleCount() const {
+template <typename Scalar>
+unsigned int ParticlesT<Scalar>::getParticleCount() const {
   return particleCount_;
 }
 
-unsigned int Particles::getParticleLength() const {
+template <typename Scalar>
+unsigned int ParticlesT<Scalar>::getParticleLength() const {
   return particleLength_;
 }
 
-void Particles::setSeed(const unsigned int& seed) const {
-    generator_.seed(seed);
-}
 
+template class ParticlesT<double>;
+template class ParticlesT<float>;
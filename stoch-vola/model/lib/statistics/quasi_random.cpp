@@ -0,0 +1,150 @@
+#include <array>
+#include <vector>
+#include <cmath>
+#include <limits>
+#include <bitset>
+#include <numeric>
+#include <utility>
+#include <algorithm>
+
+#include <Eigen/Dense>
+
+#include "statistics/quasi_random.h"
+#include "statistics/random_engine.h"
+
+
+namespace {
+  //image of v under the lower triangular binary matrix whose rows are given most significant bit first
+  std::uint32_t scramble(const std::array<std::uint32_t, 32>& rows, const std::uint32_t& v) {
+    std::uint32_t result = 0;
+    for (int i = 0; i < 32; ++i) {
+      result |= static_cast<std::uint32_t>(std::bitset<32>(rows[i] & v).count() & 1u) << (31 - i);
+    }
+    return result;
+  }
+}
+
+
+ScrambledSobol::ScrambledSobol(const std::uint64_t& seed, const std::uint32_t& step) {
+  PhiloxEngine engine(seed, step);
+
+  //direction numbers v_k = m_k 2^-k: m_k = 1 for the first dimension (van der Corput), and for the second
+  //the recurrence of the primitive polynomial x + 1, m_k = 2 m_k-1 xor m_k-1 from m_1 = 1
+  std::uint64_t m = 1;
+  for (int k = 0; k < 32; ++k) {
+    directions_[0][k] = 1u << (31 - k);
+    directions_[1][k] = static_cast<std::uint32_t>(m << (31 - k));
+    m ^= m << 1;
+  }
+
+  for (int dimension = 0; dimension < 2; ++dimension) {
+    std::array<std::uint32_t, 32> rows;
+    for (int i = 0; i < 32; ++i) {//unit diagonal, uniform bits below it
+      const std::uint32_t below = i == 0 ? 0u : ~0u << (32 - i);
+      rows[i] = (static_cast<std::uint32_t>(engine()) & below) | (1u << (31 - i));
+    }
+    for (int k = 0; k < 32; ++k) {
+      directions_[dimension][k] = scramble(rows, directions_[dimension][k]);
+    }
+    shifts_[dimension] = static_cast<std::uint32_t>(engine());
+  }
+}
+
+std::pair<std::uint32_t, std::uint32_t> ScrambledSobol::point(const std::uint32_t& index) const {
+  std::uint32_t first = shifts_[0];
+  std::uint32_t second = shifts_[1];
+  for (std::uint32_t bits = index, k = 0; bits != 0; bits >>= 1, ++k) {
+    if (bits & 1u) {
+      first ^= directions_[0][k];
+      second ^= directions_[1][k];
+    }
+  }
+  return std::make_pair(first, second);
+}
+
+
+void StateOrderBuffers::reserve(const unsigned int& nParticles) {
+  order.reserve(nParticles);
+  points.reserve(nParticles);
+  sortedWeights.resize(nParticles);
+}
+
+
+double quasirandom::normalQuantile(const double& p) {
+  static const double a[] = {-3.969683028665376e+01, 2.209460984245205e+02, -2.759285104469687e+02,
+                             1.383577518672690e+02, -3.066479806614716e+01, 2.506628277459239e+00};
+  static const double b[] = {-5.447609879822406e+01, 1.615858368580409e+02, -1.556989798598866e+02,
+                             6.680131188771972e+01, -1.328068155288572e+01};
+  static const double c[] = {-7.784894002430293e-03, -3.223964580411365e-01, -2.400758277161838e+00,
+                             -2.549732539343734e+00, 4.374664141464968e+00, 2.938163982698783e+00};
+  static const double d[] = {7.784695709041462e-03, 3.224671290700398e-01, 2.445134137142996e+00,
+                             3.754408661907416e+00};
+  const double lower = 0.02425;
+
+  if (p <= 0.0) {
+    return -std::numeric_limits<double>::infinity();
+  }
+  if (p >= 1.0) {
+    return std::numeric_limits<double>::infinity();
+  }
+
+  double x;
+  if (p < lower || p > 1.0 - lower) {
+    const double q = std::sqrt(-2.0 * std::log(p < lower ? p : 1.0 - p));
+    x = (((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5])
+        / ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1.0);
+    x = p < lower ? x : -x;
+  } else {
+    const double q = p - 0.5;
+    const double r = q * q;
+    x = (((((a[0] * r + a[1]) * r + a[2]) * r + a[3]) * r + a[4]) * r + a[5]) * q
+        / (((((b[0] * r + b[1]) * r + b[2]) * r + b[3]) * r + b[4]) * r + 1.0);
+  }
+
+  //one Halley step on Phi(x) - p takes the approximation's 1e-9 to full precision
+  const double error = 0.5 * std::erfc(-x / std::sqrt(2.0)) - p;
+  const double u = error * std::sqrt(2.0 * M_PI) * std::exp(0.5 * x * x);
+  return x - u / (1.0 + 0.5 * x * u);
+}
+
+double quasirandom::toUnit(const std::uint32_t& fraction) {
+  return (static_cast<double>(fraction) + 0.5) / 4294967296.0;
+}
+
+template <typename Scalar>
+void quasirandom::stateOrder(const Eigen::Ref<const Eigen::Matrix<Scalar, Eigen::Dynamic, 1>>& states, std::vector<int>& order) {
+  order.resize(states.size());
+  std::iota(order.begin(), order.end(), 0);
+  //ties broken by index rather than with stable_sort, whose merge buffer is a heap allocation
+  std::sort(order.begin(), order.end(), [&](const int& a, const int& b) {
+    return states[a] < states[b] || (!(states[b] < states[a]) && a < b);
+  });
+}
+
+template <typename Scalar>
+void quasirandom::stateOrderedNormals(const Eigen::Ref<const Eigen::Matrix<Scalar, Eigen::Dynamic, 1>>& states,
+                                      Eigen::Ref<Eigen::Matrix<Scalar, Eigen::Dynamic, 1>> out,
+                                      const std::uint64_t& seed, const std::uint32_t& step, StateOrderBuffers& buffers) {
+  const std::uint32_t n = states.size();
+  ScrambledSobol sobol(seed, step);
+  std::vector<std::pair<std::uint32_t, std::uint32_t>>& points = buffers.points;
+  points.resize(n);
+  for (std::uint32_t i = 0; i < n; ++i) {
+    points[i] = sobol.point(i);
+  }
+  std::sort(points.begin(), points.end());
+
+  std::vector<int>& order = buffers.order;
+  stateOrder<Scalar>(states, order);
+  for (std::uint32_t k = 0; k < n; ++k) {
+    out[order[k]] = static_cast<Scalar>(normalQuantile(toUnit(points[k].second)));
+  }
+}
+
+
+template void quasirandom::stateOrder<double>(const Eigen::Ref<const Eigen::VectorXd>&, std::vector<int>&);
+template void quasirandom::stateOrder<float>(const Eigen::Ref<const Eigen::VectorXf>&, std::vector<int>&);
+template void quasirandom::stateOrderedNormals<double>(const Eigen::Ref<const Eigen::VectorXd>&, Eigen::Ref<Eigen::VectorXd>,
+                                                       const std::uint64_t&, const std::uint32_t&, StateOrderBuffers&);
+template void quasirandom::stateOrderedNormals<float>(const Eigen::Ref<const Eigen::VectorXf>&, Eigen::Ref<Eigen::VectorXf>,
+                                                      const std::uint64_t&, const std::uint32_t&, StateOrderBuffers&);
@@ -0,0 +1,225 @@
+#include <array>
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+#include <Eigen/Dense>
+#include <EigenRand/EigenRand>
+
+#include "statistics/random_engine.h"
+
+
+namespace {
+  //layout of Eigen::Rand::P8_mt19937_64: 8 64-bit words per refill, spread over as many lanes as needed
+  constexpr std::size_t wordsPerRefill = 8;
+  constexpr std::size_t laneStride = sizeof(Eigen::Rand::Vmt19937_64::result_type) / sizeof(std::uint64_t);
+  constexpr std::size_t laneCount = wordsPerRefill / laneStride;
+}
+
+
+ReseedableMersenneTwister::ReseedableMersenneTwister(const std::uint64_t& seed)
+    : buffer_(wordsPerRefill), floatBuffer_(2 * wordsPerRefill) {
+  lanes_.reserve(laneCount);
+  for (std::size_t i = 0; i < laneCount; ++i) {
+    lanes_.emplace_back(seed + i * laneStride);
+  }
+  bufferIndex_ = buffer_.size();
+  floatBufferIndex_ = floatBuffer_.size();
+}
+
+void ReseedableMersenneTwister::seed(const std::uint64_t& seed) {
+  for (std::size_t i = 0; i < laneCount; ++i) {
+#ifdef EIGEN_DONT_VECTORIZE
+    lanes_[i].seed(seed + i);
+#else
+    //as the scalar constructor of the packet engine: consecutive seeds in the 64-bit elements of the packet
+    using Packet = LaneEngine::result_type;
+    std::array<std::uint64_t, Eigen::internal::unpacket_traits<Packet>::size / 2> seeds;
+    for (std::size_t k = 0; k < seeds.size(); ++k) {
+      seeds[k] = seed + i * laneStride + k;
+    }
+    lanes_[i].seed(Eigen::internal::ploadu<Packet>(reinterpret_cast<const int*>(seeds.data())));
+#endif
+  }
+  bufferIndex_ = buffer_.size();
+  floatBufferIndex_ = floatBuffer_.size();
+}
+
+
+ReseedableMersenneTwister::result_type ReseedableMersenneTwister::operator()() {
+  if (bufferIndex_ >= buffer_.size()) {
+    refillBuffer();
+  }
+  return buffer_[bufferIndex_++];
+}
+
+float ReseedableMersenneTwister::uniform_real() {
+  if (floatBufferIndex_ >= floatBuffer_.size()) {
+    refillFloatBuffer();
+  }
+  return floatBuffer_[floatBufferIndex_++];
+}
+
+void ReseedableMersenneTwister::standardNormal(Eigen::VectorXd& out, const Eigen::Index& size) {
+  out = Eigen::Rand::normal<Eigen::VectorXd>(size, 1, *this);
+}
+
+void ReseedableMersenneTwister::standardNormal(Eigen::VectorXf& out, const Eigen::Index& size) {
+  out = Eigen::Rand::normal<Eigen::VectorXf>(size, 1, *this);
+}
+
+void ReseedableMersenneTwister::standardNormal(Eigen::Ref<Eigen::VectorXd> out) {
+  out = Eigen::Rand::normal<Eigen::VectorXd>(out.size(), 1, *this);
+}
+
+void ReseedableMersenneTwister::standardNormal(Eigen::Ref<Eigen::VectorXf> out) {
+  out = Eigen::Rand::normal<Eigen::VectorXf>(out.size(), 1, *this);
+}
+
+
+void ReseedableMersenneTwister::refillBuffer() {
+  bufferIndex_ = 0;
+  for (std::size_t i = 0; i < laneCount; ++i) {
+    reinterpret_cast<LaneEngine::result_type&>(buffer_[i * laneStride]) = lanes_[i]();
+  }
+}
+
+void ReseedableMersenneTwister::refillFloatBuffer() {
+  floatBufferIndex_ = 0;
+  for (std::size_t i = 0; i < laneCount; ++i) {
+    auto uniforms = Eigen::internal::bit_to_ur_float(lanes_[i]());
+    reinterpret_cast<decltype(uniforms)&>(floatBuffer_[i * laneStride * 2]) = uniforms;
+  }
+}
+
+
+namespace {
+  constexpr std::uint32_t philoxMultiplier0 = 0xD2511F53u;
+  constexpr std::uint32_t philoxMultiplier1 = 0xCD9E8D57u;
+  constexpr std::uint32_t philoxWeyl0 = 0x9E3779B9u;
+  constexpr std::uint32_t philoxWeyl1 = 0xBB67AE85u;
+  constexpr int philoxRounds = 10;
+  constexpr int philoxLanes = 8; //counters processed side by side, the rounds vectorise across them
+
+  inline void philoxRound(std::uint32_t& word0, std::uint32_t& word1, std::uint32_t& word2, std::uint32_t& word3,
+                          const std::uint32_t& key0, const std::uint32_t& key1) {
+    const std::uint64_t product0 = static_cast<std::uint64_t>(philoxMultiplier0) * word0;
+    const std::uint64_t product1 = static_cast<std::uint64_t>(philoxMultiplier1) * word2;
+    word0 = static_cast<std::uint32_t>(product1 >> 32) ^ word1 ^ key0;
+    word1 = static_cast<std::uint32_t>(product1);
+    word2 = static_cast<std::uint32_t>(product0 >> 32) ^ word3 ^ key1;
+    word3 = static_cast<std::uint32_t>(product0);
+  }
+
+  //counters first, first + 1, ..., first + philoxLanes - 1 of one stream, words[w][lane]
+  void philoxLanesBlock(const std::array<std::uint32_t, 2>& key, const std::uint64_t& first, const std::uint32_t& step,
+                        const std::uint32_t& stream, std::uint32_t (&words)[4][philoxLanes]) {
+    for (int lane = 0; lane < philoxLanes; ++lane) {
+      const std::uint64_t counter = first + lane;
+      words[0][lane] = static_cast<std::uint32_t>(counter);
+      words[1][lane] = static_cast<std::uint32_t>(counter >> 32);
+      words[2][lane] = step;
+      words[3][lane] = stream;
+    }
+
+    std::uint32_t key0 = key[0];
+    std::uint32_t key1 = key[1];
+    for (int round = 0; round < philoxRounds; ++round) {
+      for (int lane = 0; lane < philoxLanes; ++lane) {
+        philoxRound(words[0][lane], words[1][lane], words[2][lane], words[3][lane], key0, key1);
+      }
+      key0 += philoxWeyl0;
+      key1 += philoxWeyl1;
+    }
+  }
+
+  //Box-Muller on the two 64-bit words of every counter, u1 in (0, 1] so the logarithm stays finite
+  template <typename Scalar>
+  void philoxNormals(const std::array<std::uint32_t, 2>& key, const std::uint32_t& step, const std::uint32_t& stream,
+                     const std::uint64_t& position, Scalar* out, const Eigen::Index& size) {
+    constexpr double unit = 1.0 / 9007199254740992.0; //2^-53
+    constexpr double twoPi = 6.283185307179586;
+
+    std::uint32_t words[4][philoxLanes];
+    Eigen::Index i = 0;
+    while (i < size) {
+      const std::uint64_t first = (position + i) >> 1;
+      philoxLanesBlock(key, first, step, stream, words);
+
+      for (int lane = 0; lane < philoxLanes && i < size; ++lane) {
+        const std::uint64_t word0 = words[0][lane] | static_cast<std::uint64_t>(words[1][lane]) << 32;
+        const std::uint64_t word1 = words[2][lane] | static_cast<std::uint64_t>(words[3][lane]) << 32;
+        const double radius = std::sqrt(-2.0 * std::log(((word0 >> 11) + 1) * unit));
+        const double angle = twoPi * ((word1 >> 11) * unit);
+
+        if (((position + i) & 1) == 0) {
+          out[i++] = static_cast<Scalar>(radius * std::cos(angle));
+          if (i == size) {
+            break;
+          }
+        }
+        out[i++] = static_cast<Scalar>(radius * std::sin(angle));
+      }
+    }
+  }
+}
+
+
+PhiloxEngine::PhiloxEngine(const std::uint64_t& seed, const std::uint32_t& step, const std::uint32_t& stream) {
+  this->seed(seed, step, stream);
+}
+
+void PhiloxEngine::seed(const std::uint64_t& seed, const std::uint32_t& step, const std::uint32_t& stream) {
+  key_ = {static_cast<std::uint32_t>(seed), static_cast<std::uint32_t>(seed >> 32)};
+  step_ = step;
+  stream_ = stream;
+  position_ = 0;
+  cachedCounter_ = std::numeric_limits<std::uint64_t>::max();
+}
+
+void PhiloxEngine::discard(const std::uint64_t& n) {
+  position_ += n;
+}
+
+std::uint64_t PhiloxEngine::getPosition() const {
+  return position_;
+}
+
+
+PhiloxEngine::result_type PhiloxEngine::operator()() {
+  const std::uint64_t counter = position_ >> 1;
+  if (counter != cachedCounter_) {
+    std::array<std::uint32_t, 4> words = block(key_, {static_cast<std::uint32_t>(counter), static_cast<std::uint32_t>(counter >> 32),
+                                                      step_, stream_});
+    cachedWords_[0] = words[0] | static_cast<std::uint64_t>(words[1]) << 32;
+    cachedWords_[1] = words[2] | static_cast<std::uint64_t>(words[3]) << 32;
+    cachedCounter_ = counter;
+  }
+  return cachedWords_[position_++ & 1];
+}
+
+
+void PhiloxEngine::standardNormal(Eigen::Ref<Eigen::VectorXd> out) {
+  philoxNormals(key_, step_, stream_, position_, out.data(), out.size());
+  position_ += out.size();
+}
+
+void PhiloxEngine::standardNormal(Eigen::Ref<Eigen::VectorXf> out) {
+  philoxNormals(key_, step_, stream_, position_, out.data(), out.size());
+  position_ += out.size();
+}
+
+
+std::array<std::uint32_t, 4> PhiloxEngine::block(const std::array<std::uint32_t, 2>& key,
+                                                 const std::array<std::uint32_t, 4>& counter) {
+  std::array<std::uint32_t, 4> words = counter;
+  std::uint32_t key0 = key[0];
+  std::uint32_t key1 = key[1];
+  for (int round = 0; round < philoxRounds; ++round) {
+    philoxRound(words[0], words[1], words[2], words[3], key0, key1);
+    key0 += philoxWeyl0;
+    key1 += philoxWeyl1;
+  }
+  return words;
+}
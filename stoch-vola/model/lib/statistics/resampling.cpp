@@ -0,0 +1,298 @@
+#include <random>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+
+#include <Eigen/Dense>
+
+#include "statistics/resampling.h"
+#include "statistics/thread_pool.h"
+
+
+namespace {
+  //n ascending uniforms in O(n) from normalised partial sums of n+1 exponential spacings
+  void sortedUniforms(Eigen::Ref<Eigen::VectorXd> uniforms, std::mt19937& generator) {
+    std::exponential_distribution<double> exponential(1.0);
+
+    double cumulative = 0.0;
+    for (Eigen::Index k = 0; k < uniforms.size(); ++k) {
+      cumulative += exponential(generator);
+      uniforms[k] = cumulative;
+    }
+    cumulative += exponential(generator);
+
+    uniforms /= cumulative;
+  }
+}
+
+
+namespace resampling {
+
+  void invertSortedUniforms(const Eigen::Ref<const Eigen::VectorXd>& weights,
+                            const Eigen::Ref<const Eigen::VectorXd>& sortedUniforms,
+                            Eigen::Ref<Eigen::VectorXi> ancestors) {
+    if (sortedUniforms.size() != ancestors.size()) {
+      throw std::invalid_argument("Number of uniforms must be equal to the number of ancestors.");
+    }
+
+    const Eigen::Index n = weights.size();
+    const double total = weights.sum();
+
+    //never hand out trailing zero-weight particles, even when rounding pushes a uniform past the total
+    Eigen::Index last = n - 1;
+    while (last > 0 && weights[last] <= 0.0) {
+      last--;
+    }
+
+    Eigen::Index index = 0;
+    double cumulative = weights[0];
+
+    for (Eigen::Index k = 0; k < sortedUniforms.size(); ++k) {
+      const double target = sortedUniforms[k] * total;
+      while (target >= cumulative && index < last) {
+        index++;
+        cumulative += weights[index];
+      }
+      ancestors[k] = static_cast<int>(index);
+    }
+  }
+
+
+  Eigen::VectorXi ancestorIndices(const Eigen::Ref<const Eigen::VectorXd>& weights,
+                                  const ResamplingScheme& scheme,
+                                  std::mt19937& generator) {
+    const Eigen::Index n = weights.size();
+    Eigen::VectorXi ancestors(n);
+    Eigen::VectorXd uniforms(n);
+    Eigen::VectorXd residuals(scheme == ResamplingScheme::Residual ? n : 0);
+
+    ancestorIndices(weights, scheme, generator, ancestors, uniforms, residuals);
+
+    return ancestors;
+  }
+
+
+  void ancestorIndices(const Eigen::Ref<const Eigen::VectorXd>& weights,
+                       const ResamplingScheme& scheme,
+                       std::mt19937& generator,
+                       Eigen::Ref<Eigen::VectorXi> ancestors,
+                       Eigen::Ref<Eigen::VectorXd> uniforms,
+                       Eigen::Ref<Eigen::VectorXd> residuals) {
+    const Eigen::Index n = weights.size();
+    if (n == 0) {
+      throw std::invalid_argument("Weights must not be empty.");
+    }
+    if (ancestors.size() != n || uniforms.size() != n || (scheme == ResamplingScheme::Residual && residuals.size() != n)) {
+      throw std::invalid_argument("Ancestor and scratch buffers must have one entry per weight.");
+    }
+
+    const double total = weights.sum();
+    if (!(total > 0.0) || !std::isfinite(total) || weights.minCoeff() < 0.0) {
+      throw std::invalid_argument("Weights must be non-negative with a positive, finite sum.");
+    }
+
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+    switch (scheme) {
+      case ResamplingScheme::Systematic: {
+        const double offset = uniform(generator);
+        uniforms = (Eigen::VectorXd::LinSpaced(n, 0.0, n - 1.0).array() + offset) / n;
+        invertSortedUniforms(weights, uniforms, ancestors);
+        break;
+      }
+      case ResamplingScheme::Stratified: {
+        for (Eigen::Index k = 0; k < n; ++k) {
+          uniforms[k] = (k + uniform(generator)) / n;
+        }
+        invertSortedUniforms(weights, uniforms, ancestors);
+        break;
+      }
+      case ResamplingScheme::Multinomial: {
+        sortedUniforms(uniforms, generator);
+        invertSortedUniforms(weights, uniforms, ancestors);
+        break;
+      }
+      case ResamplingScheme::Residual: {
+        //floor(N*w_i) deterministic copies, remaining draws multinomial on the residual weights
+        residuals = weights * (n / total);
+        Eigen::Index offset = 0;
+
+        for (Eigen::Index i = 0; i < n; ++i) {
+          const double copies = std::floor(residuals[i]);
+          for (int c = 0; c < copies && offset < n; ++c) {
+            ancestors[offset++] = static_cast<int>(i);
+          }
+          residuals[i] -= copies;
+        }
+
+        const Eigen::Index remaining = n - offset;
+        if (remaining > 0) {
+          sortedUniforms(uniforms.head(remaining), generator);
+          invertSortedUniforms(residuals, uniforms.head(remaining), ancestors.tail(remaining));
+        }
+        break;
+      }
+    }
+  }
+
+
+  Eigen::VectorXi ancestorIndices(const Eigen::Ref<const Eigen::VectorXd>& weights,
+                                  const ResamplingScheme& scheme,
+                                  const unsigned int& seed,
+                                  ThreadPool& pool) {
+    const Eigen::Index n = weights.size();
+    Eigen::VectorXi ancestors(n);
+    Eigen::VectorXd uniforms(n);
+    PooledResamplingBuffers buffers;
+
+    ancestorIndices(weights, scheme, seed, pool, ancestors, uniforms, buffers);
+
+    return ancestors;
+  }
+
+
+  void ancestorIndices(const Eigen::Ref<const Eigen::VectorXd>& weights,
+                       const ResamplingScheme& scheme,
+                       const unsigned int& seed,
+                       ThreadPool& pool,
+                       Eigen::Ref<Eigen::VectorXi> ancestors,
+                       Eigen::Ref<Eigen::VectorXd> uniforms,
+                       PooledResamplingBuffers& buffers) {
+    const unsigned int blocks = pool.getThreadCount();
+    const Eigen::Index n = weights.size();
+    if (ancestors.size() != n || uniforms.size() != n) {
+      throw std::invalid_argument("Ancestor and scratch buffers must have one entry per weight.");
+    }
+
+    if (blocks == 1 || scheme == ResamplingScheme::Residual || n < static_cast<Eigen::Index>(blocks)) {
+      std::mt19937 generator(seed);
+      buffers.cumulative.resize(scheme == ResamplingScheme::Residual ? n : 0); //the residuals
+      ancestorIndices(weights, scheme, generator, ancestors, uniforms, buffers.cumulative);
+      return;
+    }
+
+    //blocked prefix sum: local inclusive sums first, then shift every block by its offset
+    Eigen::VectorXd& cumulative = buffers.cumulative;
+    std::vector<double>& offsets = buffers.offsets;
+    std::vector<char>& negative = buffers.negative;
+    cumulative.resize(n);
+    offsets.assign(blocks + 1, 0.0);
+    negative.assign(blocks, 0);
+
+    pool.run([&](unsigned int block) {
+      const Eigen::Index begin = ThreadPool::blockBegin(n, blocks, block);
+      const Eigen::Index end = ThreadPool::blockBegin(n, blocks, block + 1);
+
+      double sum = 0.0;
+      for (Eigen::Index i = begin; i < end; ++i) {
+        negative[block] |= weights[i] < 0.0;
+        sum += weights[i];
+        cumulative[i] = sum;
+      }
+      offsets[block + 1] = sum;
+    });
+
+    for (unsigned int block = 0; block < blocks; ++block) {
+      if (negative[block]) {
+        throw std::invalid_argument("Weights must be non-negative with a positive, finite sum.");
+      }
+      offsets[block + 1] += offsets[block];
+    }
+
+    const double total = offsets[blocks];
+    if (!(total > 0.0) || !std::isfinite(total)) {
+      throw std::invalid_argument("Weights must be non-negative with a positive, finite sum.");
+    }
+
+    //sorted uniforms, each thread fills its own block of outputs
+    std::vector<double>& spacingOffsets = buffers.spacingOffsets;
+    spacingOffsets.assign(blocks + 1, 0.0);
+    double systematicOffset = 0.0;
+
+    if (scheme == ResamplingScheme::Systematic) {
+      std::mt19937 generator(seed);
+      std::uniform_real_distribution<double> uniform(0.0, 1.0);
+      systematicOffset = uniform(generator);
+    }
+
+    pool.run([&](unsigned int block) {
+      const Eigen::Index begin = ThreadPool::blockBegin(n, blocks, block);
+      const Eigen::Index end = ThreadPool::blockBegin(n, blocks, block + 1);
+
+      if (block > 0) {
+        for (Eigen::Index i = begin; i < end; ++i) {
+          cumulative[i] += offsets[block];
+        }
+      }
+
+      std::mt19937 generator(static_cast<unsigned int>(ThreadPool::blockSeed(seed, block)));
+      std::uniform_real_distribution<double> uniform(0.0, 1.0);
+      std::exponential_distribution<double> exponential(1.0);
+
+      switch (scheme) {
+        case ResamplingScheme::Systematic:
+          for (Eigen::Index k = begin; k < end; ++k) {
+            uniforms[k] = (k + systematicOffset) / n;
+          }
+          break;
+        case ResamplingScheme::Stratified:
+          for (Eigen::Index k = begin; k < end; ++k) {
+            uniforms[k] = (k + uniform(generator)) / n;
+          }
+          break;
+        default: {
+          double sum = 0.0;
+          for (Eigen::Index k = begin; k < end; ++k) {
+            sum += exponential(generator);
+            uniforms[k] = sum;
+          }
+          spacingOffsets[block + 1] = sum;
+          break;
+        }
+      }
+    });
+
+    if (scheme == ResamplingScheme::Multinomial) {
+      for (unsigned int block = 0; block < blocks; ++block) {
+        spacingOffsets[block + 1] += spacingOffsets[block];
+      }
+      std::mt19937 generator(static_cast<unsigned int>(ThreadPool::blockSeed(seed, blocks)));
+      std::exponential_distribution<double> exponential(1.0);
+      const double spacingTotal = spacingOffsets[blocks] + exponential(generator);
+
+      pool.run([&](unsigned int block) {
+        const Eigen::Index begin = ThreadPool::blockBegin(n, blocks, block);
+        const Eigen::Index end = ThreadPool::blockBegin(n, blocks, block + 1);
+        for (Eigen::Index k = begin; k < end; ++k) {
+          uniforms[k] = (uniforms[k] + spacingOffsets[block]) / spacingTotal;
+        }
+      });
+    }
+
+    Eigen::Index last = n - 1;
+    while (last > 0 && weights[last] <= 0.0) {
+      last--;
+    }
+
+    //every block finds its first ancestor by bisection and sweeps from there
+    pool.run([&](unsigned int block) {
+      const Eigen::Index begin = ThreadPool::blockBegin(n, blocks, block);
+      const Eigen::Index end = ThreadPool::blockBegin(n, blocks, block + 1);
+      if (begin == end) {
+        return;
+      }
+
+      Eigen::Index index = std::upper_bound(cumulative.data(), cumulative.data() + n, uniforms[begin] * total) - cumulative.data();
+      index = std::min(index, last);
+
+      for (Eigen::Index k = begin; k < end; ++k) {
+        const double target = uniforms[k] * total;
+        while (target >= cumulative[index] && index < last) {
+          index++;
+        }
+        ancestors[k] = static_cast<int>(index);
+      }
+    });
+  }
+}
@@ -0,0 +1,109 @@
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+#include <stdexcept>
+
+#include "statistics/thread_pool.h"
+
+
+ThreadPool::ThreadPool(const unsigned int& threadCount)
+    : threadCount_(threadCount), task_(nullptr), generation_(0), pending_(0), stopping_(false) {
+  if (threadCount == 0) {
+    throw std::invalid_argument("Thread count must be greater than zero.");
+  }
+
+  for (unsigned int i = 1; i < threadCount_; ++i) {
+    workers_.emplace_back(&ThreadPool::workerLoop, this, i);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  startCondition_.notify_all();
+
+  for (std::thread& worker : workers_) {
+    worker.join();
+  }
+}
+
+
+void ThreadPool::workerLoop(const unsigned int& index) {
+  unsigned long seenGeneration = 0;
+
+  while (true) {
+    const std::function<void(unsigned int)>* task;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      startCondition_.wait(lock, [&] { return stopping_ || generation_ != seenGeneration; });
+      if (stopping_) {
+        return;
+      }
+      seenGeneration = generation_;
+      task = task_;
+    }
+
+    std::exception_ptr error;
+    try {
+      (*task)(index);
+    } catch (...) {
+      error = std::current_exception();
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (error && !error_) {
+        error_ = error;
+      }
+      pending_--;
+    }
+    doneCondition_.notify_one();
+  }
+}
+
+
+void ThreadPool::runTask(const std::function<void(unsigned int)>& task) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    task_ = &task;
+    pending_ = threadCount_ - 1;
+    error_ = nullptr;
+    generation_++;
+  }
+  startCondition_.notify_all();
+
+  std::exception_ptr error;
+  try {
+    task(0);
+  } catch (...) {
+    error = std::current_exception();
+  }
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  doneCondition_.wait(lock, [&] { return pending_ == 0; });
+
+  if (error) {
+    std::rethrow_exception(error);
+  }
+  if (error_) {
+    std::rethrow_exception(error_);
+  }
+}
+
+
+unsigned int ThreadPool::getThreadCount() const {
+  return threadCount_;
+}
+
+long ThreadPool::blockBegin(const long& n, const unsigned int& blocks, const unsigned int& block) {
+  return static_cast<long>((static_cast<unsigned long long>(n) * block) / blocks);
+}
+
+unsigned long long ThreadPool::blockSeed(const unsigned long long& seed, const unsigned int& block) {
+  return seed + 0x9E3779B97F4A7C15ULL * block;
+}
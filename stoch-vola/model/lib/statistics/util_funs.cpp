@@ -1,8 +1,120 @@
 #include <cmath>
+#include <vector>
+#include <numeric>
 #include <algorithm>
 #include <stdexcept>
 
+#include <Eigen/Dense>
+
 #include "statistics/util_funs.h"
+#include "statistics/thread_pool.h"
+
+namespace {
+  const long minParallelElements = 1L << 16;
+
+  struct WeightedValue {
+    double value;
+    double weight;
+  };
+
+  //cumulative weight a quantile has to reach, and the index of its probability
+  struct WeightedTarget {
+    double weight;
+    int index;
+  };
+
+  double checkedWeightSum(const Eigen::Ref<const Eigen::VectorXd>& data, const Eigen::Ref<const Eigen::VectorXd>& weights) {
+    if (data.size() == 0) {
+      throw std::invalid_argument("Data vector is empty.");
+    }
+    if (weights.size() != data.size()) {
+      throw std::invalid_argument("Number of weights must be equal to the number of values.");
+    }
+    if (!(weights.minCoeff() >= 0.0)) {
+      throw std::invalid_argument("Weights must be non-negative.");
+    }
+    const double weightSum = weights.sum();
+    if (!(weightSum > 0.0) || !std::isfinite(weightSum)) {
+      throw std::invalid_argument("Weights must have a positive finite sum.");
+    }
+    return weightSum;
+  }
+
+  std::vector<WeightedTarget> weightedTargets(const std::vector<double>& probabilities, const double& weightSum) {
+    std::vector<WeightedTarget> targets;
+    for (int k : utilfuns::quantileOrder(probabilities)) {
+      targets.push_back({probabilities[k] * weightSum, k});
+    }
+    return targets;
+  }
+
+  //Writes the value at which the cumulative weight, in ascending order of value and starting from before,
+  //first reaches each of the ascending targets into out[index * outStride]. Three-way partitions around a
+  //median-of-three pivot send every target to the side holding it, so each level only recurses where
+  //targets are left; short ranges are sorted and scanned. Targets beyond the total weight, which rounding
+  //can leave, take the largest value.
+  void weightedSelect(WeightedValue* first, WeightedValue* last, double before,
+                      const WeightedTarget* target, const WeightedTarget* targetEnd, double* out, const long& outStride) {
+    while (target != targetEnd) {
+      if (last - first <= 32) {
+        std::sort(first, last, [](const WeightedValue& a, const WeightedValue& b) { return a.value < b.value; });
+        for (WeightedValue* it = first; it != last; ++it) {
+          before += it->weight;
+          for (; target != targetEnd && target->weight <= before; ++target) {
+            out[target->index * outStride] = it->value;
+          }
+        }
+        for (; target != targetEnd; ++target) {
+          out[target->index * outStride] = (last - 1)->value;
+        }
+        return;
+      }
+
+      const double a = first->value, b = first[(last - first) / 2].value, c = (last - 1)->value;
+      const double pivot = std::max(std::min(a, b), std::min(std::max(a, b), c));
+      WeightedValue* lessEnd = std::partition(first, last, [&](const WeightedValue& v) { return v.value < pivot; });
+      WeightedValue* equalEnd = std::partition(lessEnd, last, [&](const WeightedValue& v) { return !(pivot < v.value); });
+
+      double lessWeight = 0.0;
+      for (WeightedValue* it = first; it != lessEnd; ++it) {
+        lessWeight += it->weight;
+      }
+      double equalWeight = 0.0;
+      for (WeightedValue* it = lessEnd; it != equalEnd; ++it) {
+        equalWeight += it->weight;
+      }
+
+      const WeightedTarget* lessTargets = target;
+      if (lessEnd != first) {
+        lessTargets = std::partition_point(target, targetEnd, [&](const WeightedTarget& t) { return t.weight <= before + lessWeight; });
+        weightedSelect(first, lessEnd, before, target, lessTargets, out, outStride);
+      }
+      before += lessWeight + equalWeight;
+      target = equalEnd == last ? targetEnd
+                                : std::partition_point(lessTargets, targetEnd, [&](const WeightedTarget& t) { return t.weight <= before; });
+      for (const WeightedTarget* it = lessTargets; it != target; ++it) {
+        out[it->index * outStride] = pivot;
+      }
+      first = equalEnd; //the rest lies above the pivot, iterated rather than recursed
+    }
+  }
+
+  //block(begin, end) over the rows in contiguous blocks, one per thread of a ThreadPool once every thread
+  //gets at least minParallelElements values
+  template <typename F>
+  void forEachRowBlock(const utilfuns::SampleMatrixRef& samples, const unsigned int& threadCount, const F& block) {
+    const long rows = samples.rows();
+    const long threads = std::min({static_cast<long>(threadCount), samples.size() / minParallelElements, rows});
+    if (threads <= 1) {
+      block(0L, rows);
+      return;
+    }
+    ThreadPool pool(threads);
+    pool.run([&](unsigned int i) {
+      block(ThreadPool::blockBegin(rows, threads, i), ThreadPool::blockBegin(rows, threads, i+1));
+    });
+  }
+}
 
 namespace utilfuns {
 
@@ -41,22 +153,143 @@ namespace utilfuns {
       if (data.empty()) {
           throw std::invalid_argument("Data vector is empty.");
       }
-      if (q < 0.0 || q > 1.0) {
-          throw std::invalid_argument("Quantile must be between 0 and 1.");
+
+      std::vector<double> values = data;
+      double result;
+      selectQuantiles(values.data(), values.size(), {q}, quantileOrder({q}), &result);
+      return result;
+  }
+
+  Moments moments(const Eigen::Ref<const Eigen::VectorXd>& data) {
+    if (data.size() == 0) {
+      throw std::invalid_argument("Data vector is empty.");
+    }
+
+    //Eigen's packet reductions, two passes for the deviations from the mean
+    Moments result;
+    result.weightSum = data.size();
+    result.mean = data.mean();
+    result.variance = (data.array() - result.mean).square().sum() / result.weightSum;
+    return result;
+  }
+
+  Moments moments(const Eigen::Ref<const Eigen::VectorXd>& data, const Eigen::Ref<const Eigen::VectorXd>& weights) {
+    Moments result;
+    result.weightSum = checkedWeightSum(data, weights);
+    result.mean = weights.dot(data) / result.weightSum;
+    result.variance = weights.dot((data.array() - result.mean).square().matrix()) / result.weightSum;
+    return result;
+  }
+
+  std::vector<int> quantileOrder(const std::vector<double>& probabilities) {
+    for (double q : probabilities) {
+      if (!(q >= 0.0 && q <= 1.0)) {
+        throw std::invalid_argument("Quantile must be between 0 and 1.");
+      }
+    }
+    std::vector<int> order(probabilities.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](const int& a, const int& b) { return probabilities[a] < probabilities[b]; });
+    return order;
+  }
+
+  Eigen::VectorXd quantiles(const Eigen::Ref<const Eigen::VectorXd>& data, const std::vector<double>& probabilities) {
+    if (data.size() == 0) {
+      throw std::invalid_argument("Data vector is empty.");
+    }
+
+    const std::vector<int> order = quantileOrder(probabilities);
+    Eigen::VectorXd values = data;
+    Eigen::VectorXd result(probabilities.size());
+    selectQuantiles(values.data(), values.size(), probabilities, order, result.data());
+    return result;
+  }
+
+  Eigen::VectorXd weightedQuantiles(const Eigen::Ref<const Eigen::VectorXd>& data, const Eigen::Ref<const Eigen::VectorXd>& weights,
+                                    const std::vector<double>& probabilities) {
+    const double weightSum = checkedWeightSum(data, weights);
+    const std::vector<WeightedTarget> targets = weightedTargets(probabilities, weightSum);
+
+    std::vector<WeightedValue> values(data.size());
+    for (long i = 0; i < data.size(); ++i) {
+      values[i] = {data[i], weights[i]};
+    }
+    Eigen::VectorXd result(probabilities.size());
+    weightedSelect(values.data(), values.data() + values.size(), 0.0, targets.data(), targets.data() + targets.size(),
+                   result.data(), 1);
+    return result;
+  }
+
+  Eigen::MatrixXd rowQuantiles(const SampleMatrixRef& samples, const std::vector<double>& probabilities,
+                               const unsigned int& threadCount) {
+    if (samples.cols() == 0) {
+      throw std::invalid_argument("Data vector is empty.");
+    }
+
+    const std::vector<int> order = quantileOrder(probabilities);
+    Eigen::MatrixXd result(samples.rows(), probabilities.size());
+    forEachRowBlock(samples, threadCount, [&](const long& begin, const long& end) {
+      Eigen::VectorXd values(samples.cols());
+      for (long row = begin; row < end; ++row) {
+        values = samples.row(row).transpose();
+        selectQuantiles(values.data(), values.size(), probabilities, order, &result(row, 0), result.outerStride());
       }
-      
-      std::vector<double> sortedData = data;
-      std::sort(sortedData.begin(), sortedData.end());
-      
-      double pos = q * (sortedData.size() - 1);
-      size_t lowerIndex = static_cast<size_t>(pos);
-      size_t upperIndex = lowerIndex + 1;
-      double weight = pos - lowerIndex;
-      
-      if (upperIndex >= sortedData.size()) {
-          return sortedData[lowerIndex];
+    });
+    return result;
+  }
+
+  Eigen::MatrixXd rowWeightedQuantiles(const SampleMatrixRef& samples, const SampleMatrixRef& weights,
+                                       const std::vector<double>& probabilities, const unsigned int& threadCount) {
+    if (weights.rows() != samples.rows() || weights.cols() != samples.cols()) {
+      throw std::invalid_argument("Weights must have the shape of the samples.");
+    }
+    quantileOrder(probabilities); //checks the probabilities before any thread starts
+
+    Eigen::MatrixXd result(samples.rows(), probabilities.size());
+    forEachRowBlock(samples, threadCount, [&](const long& begin, const long& end) {
+      std::vector<WeightedValue> values(samples.cols());
+      for (long row = begin; row < end; ++row) {
+        const double weightSum = checkedWeightSum(samples.row(row).transpose(), weights.row(row).transpose());
+        const std::vector<WeightedTarget> targets = weightedTargets(probabilities, weightSum);
+        for (long i = 0; i < samples.cols(); ++i) {
+          values[i] = {samples(row, i), weights(row, i)};
+        }
+        weightedSelect(values.data(), values.data() + values.size(), 0.0, targets.data(), targets.data() + targets.size(),
+                       &result(row, 0), result.outerStride());
       }
-      
-      return sortedData[lowerIndex] * (1.0 - weight) + sortedData[upperIndex] * weight;
+    });
+    return result;
+  }
+
+  Eigen::MatrixXd rowMoments(const SampleMatrixRef& samples, const unsigned int& threadCount) {
+    if (samples.cols() == 0) {
+      throw std::invalid_argument("Data vector is empty.");
+    }
+
+    Eigen::MatrixXd result(samples.rows(), 2);
+    forEachRowBlock(samples, threadCount, [&](const long& begin, const long& end) {
+      const auto block = samples.middleRows(begin, end - begin);
+      const Eigen::VectorXd means = block.rowwise().mean();
+      result.col(0).segment(begin, end - begin) = means;
+      result.col(1).segment(begin, end - begin) = (block.colwise() - means).rowwise().squaredNorm() / static_cast<double>(samples.cols());
+    });
+    return result;
+  }
+
+  Eigen::MatrixXd rowWeightedMoments(const SampleMatrixRef& samples, const SampleMatrixRef& weights,
+                                     const unsigned int& threadCount) {
+    if (weights.rows() != samples.rows() || weights.cols() != samples.cols()) {
+      throw std::invalid_argument("Weights must have the shape of the samples.");
+    }
+
+    Eigen::MatrixXd result(samples.rows(), 2);
+    forEachRowBlock(samples, threadCount, [&](const long& begin, const long& end) {
+      for (long row = begin; row < end; ++row) {
+        const Moments weighted = moments(samples.row(row).transpose(), weights.row(row).transpose());
+        result(row, 0) = weighted.mean;
+        result(row, 1) = weighted.variance;
+      }
+    });
+    return result;
   }
 } 
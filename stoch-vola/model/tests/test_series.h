@@ -0,0 +1,21 @@
+#ifndef TEST_SERIES_H
+#define TEST_SERIES_H
+
+#include <cmath>
+
+#include <Eigen/Dense>
+
+
+namespace testseries {
+    //200 returns whose scale switches between 0.5 and 2.0 every 20 steps, long enough for the
+    //filters to resample on some steps and not on others
+    inline Eigen::VectorXd switchingVolatility() {
+      Eigen::VectorXd y(200);
+      for (int t=0; t<200; t++) {
+        y[t] = std::sin(0.3 * t) * (t % 40 < 20 ? 0.5 : 2.0);
+      }
+      return y;
+    }
+}
+
+#endif
@@ -0,0 +1,151 @@
+#include <cmath>
+#include <vector>
+#include <stdexcept>
+
+#include <Eigen/Dense>
+
+#include "gtest/gtest.h"
+
+#include "model/bootstrap_filter.h"
+#include "model/filter_workspace.h"
+#include "model/stochastic_volatility_model.h"
+#include "model/sv_models.h"
+#include "statistics/particles.h"
+
+namespace {
+  Eigen::VectorXd series() {
+    Eigen::VectorXd y(8);
+    y << 0.4, -1.2, 0.3, 2.1, -0.7, 0.05, -1.6, 0.9;
+    return y;
+  }
+
+  std::vector<FilterOptions> engineOptions() {
+    std::vector<FilterOptions> options(5);
+    options[1].randomEngine = RandomEngine::Philox;
+    options[2].randomEngine = RandomEngine::Sobol;
+    options[3].precision = FilterPrecision::Single;
+    options[4].threadCount = 3;
+    options[4].randomEngine = RandomEngine::Philox;
+    return options;
+  }
+}
+
+TEST(StochasticVolatility_BootstrapFilter, GaussianMatchesModel) {
+  Eigen::VectorXd y = series();
+  StochasticVolatilityModel svm(0.1, 0.5, -0.5);
+  BootstrapFilter<GaussianSV> filter(GaussianSV::fromUnconstrained(Eigen::Vector3d(0.1, 0.5, -0.5)));
+
+  for (const FilterOptions& options : engineOptions()) {
+    EXPECT_EQ(filter.logLikelihood(y, 200, 42, options), svm.logLikelihood(y, 200, 42, options));
+    EXPECT_EQ(filter.logMarginalLikelihood(y, 200, 42, options), svm.logMarginalLikelihood(y, 200, 42, options));
+
+    FilterWorkspace workspace(200, options.precision);
+    EXPECT_EQ(filter.logLikelihood(y, 200, 42, options, workspace), svm.logLikelihood(y, 200, 42, options));
+  }
+
+  Particles expected = svm.particleFilter(y, 50, 7);
+  Particles particles = filter.particleFilter(y, 50, 7);
+  EXPECT_TRUE(particles.getParticlesAsEigenMatrix() == expected.getParticlesAsEigenMatrix());
+}
+
+TEST(StochasticVolatility_BootstrapFilter, LeverageWithoutCorrelationIsGaussian) {
+  Eigen::VectorXd y = series();
+  const double mu = 0.1, phi = std::tanh(0.5), sigma = std::exp(-0.5);
+  BootstrapFilter<GaussianSV> gaussian(GaussianSV(mu, phi, sigma));
+  LeverageStochasticVolatilityModel leverage(LeverageSV(mu, phi, sigma, 0.0));
+
+  for (const FilterOptions& options : engineOptions()) {
+    EXPECT_EQ(leverage.logLikelihood(y, 200, 42, options), gaussian.logLikelihood(y, 200, 42, options));
+    EXPECT_EQ(leverage.logMarginalLikelihood(y, 200, 42, options), gaussian.logMarginalLikelihood(y, 200, 42, options));
+  }
+
+  LeverageStochasticVolatilityModel correlated(LeverageSV(mu, phi, sigma, -0.6));
+  EXPECT_NE(correlated.logMarginalLikelihood(y, 200, 42), gaussian.logMarginalLikelihood(y, 200, 42));
+}
+
+TEST(StochasticVolatility_BootstrapFilter, LeverageStep) {
+  const LeverageSV model(0.1, 0.8, 0.3, -0.6);
+  const LeverageSV::Step<double> step = model.step<double>(1.5, -0.4);
+  const double x = -0.3, z = 0.7;
+  const double expected = 0.1 + 0.8 * (x - 0.1) + 0.3 * (-0.6 * 1.5 * std::exp(-0.5 * x) + std::sqrt(1.0 - 0.36) * z);
+  EXPECT_NEAR(step.propagate(x, z), expected, 1e-14);
+
+  //the observation density stays Gaussian
+  const double density = -0.5 * (std::log(2 * M_PI) + x + 0.16 * std::exp(-x));
+  EXPECT_NEAR(step.logDensity(x), density, 1e-14);
+}
+
+TEST(StochasticVolatility_BootstrapFilter, StudentTDensity) {
+  const double y = -1.3;
+  for (double nu : {2.5, 5.0, 30.0}) {
+    const StudentTSV model(0.0, 0.9, 0.2, nu);
+    const StudentTSV::Step<double> step = model.step<double>(0.0, y);
+    for (double x : {-2.0, 0.0, 1.1}) {
+      //t density of y / exp(x/2) with the Jacobian exp(-x/2)
+      const double scaled = y * std::exp(-0.5 * x);
+      const double expected = std::lgamma(0.5 * (nu + 1.0)) - std::lgamma(0.5 * nu) - 0.5 * std::log(nu * M_PI)
+                              - 0.5 * (nu + 1.0) * std::log(1.0 + scaled * scaled / nu) - 0.5 * x;
+      EXPECT_NEAR(step.logDensity(x), expected, 1e-12);
+    }
+  }
+
+  //Gaussian in the limit
+  const StudentTSV::Step<double> limit = StudentTSV(0.0, 0.9, 0.2, 1e9).step<double>(0.0, y);
+  const GaussianSV::Step<double> gaussian = GaussianSV(0.0, 0.9, 0.2).step<double>(0.0, y);
+  EXPECT_NEAR(limit.logDensity(0.4), gaussian.logDensity(0.4), 1e-6);
+}
+
+TEST(StochasticVolatility_BootstrapFilter, StudentTLikelihood) {
+  Eigen::VectorXd y = series();
+  const double mu = 0.1, phi = std::tanh(0.5), sigma = std::exp(-0.5);
+  BootstrapFilter<GaussianSV> gaussian(GaussianSV(mu, phi, sigma));
+  StudentTStochasticVolatilityModel limit(StudentTSV(mu, phi, sigma, 1e9));
+  EXPECT_NEAR(limit.logMarginalLikelihood(y, 500, 42), gaussian.logMarginalLikelihood(y, 500, 42), 1e-4);
+
+  //heavy tails make the outlier of y_4 cheaper
+  Eigen::VectorXd outlier = y;
+  outlier[3] = 8.0;
+  StudentTStochasticVolatilityModel heavy(StudentTSV(mu, phi, sigma, 3.0));
+  EXPECT_GT(heavy.logMarginalLikelihood(outlier, 500, 42), gaussian.logMarginalLikelihood(outlier, 500, 42));
+
+  for (const FilterOptions& options : engineOptions()) {
+    EXPECT_TRUE(std::isfinite(heavy.logLikelihood(y, 200, 42, options)));
+  }
+}
+
+TEST(StochasticVolatility_BootstrapFilter, ParticleFilter) {
+  Eigen::VectorXd y = series();
+  StudentTStochasticVolatilityModel model(StudentTSV(0.0, 0.5, 0.5, 5.0));
+  Particles p = model.particleFilter(y, 10, 123);
+  EXPECT_EQ(p.getParticleCount(), 10);
+  EXPECT_EQ(p.getParticleLength(), 8);
+
+  EXPECT_THROW(model.logLikelihood(y, 0, 123), std::invalid_argument);
+}
+
+TEST(StochasticVolatility_BootstrapFilter, BootstrapProposalOnly) {
+  Eigen::VectorXd y = series();
+  LeverageStochasticVolatilityModel model(LeverageSV(0.0, 0.5, 0.5, -0.3));
+  FilterOptions options;
+  options.proposal = FilterProposal::Auxiliary;
+  EXPECT_THROW(model.logLikelihood(y, 10, 123, options), std::invalid_argument);
+  EXPECT_THROW(model.particleFilter(y, 10, 123, options), std::invalid_argument);
+}
+
+TEST(StochasticVolatility_BootstrapFilter, Parameters) {
+  const StudentTSV studentT = StudentTSV::fromUnconstrained(Eigen::Vector4d(0.1, 0.5, -0.5, 1.0));
+  EXPECT_EQ(studentT.mu, 0.1);
+  EXPECT_DOUBLE_EQ(studentT.phi, std::tanh(0.5));
+  EXPECT_DOUBLE_EQ(studentT.sigma, std::exp(-0.5));
+  EXPECT_DOUBLE_EQ(studentT.nu, 2.0 + std::exp(1.0));
+
+  const LeverageSV leverage = LeverageSV::fromUnconstrained(Eigen::Vector4d(0.1, 0.5, -0.5, -0.3));
+  EXPECT_DOUBLE_EQ(leverage.rho, std::tanh(-0.3));
+
+  EXPECT_THROW(GaussianSV::fromUnconstrained(Eigen::Vector4d::Zero()), std::invalid_argument);
+  EXPECT_THROW(LeverageSV::fromUnconstrained(Eigen::Vector3d::Zero()), std::invalid_argument);
+  EXPECT_THROW(GaussianSV(0.0, 1.5, 1.0), std::invalid_argument);
+  EXPECT_THROW(StudentTSV(0.0, 0.5, -1.0, 5.0), std::invalid_argument);
+  EXPECT_THROW(StudentTSV(0.0, 0.5, 1.0, 0.0), std::invalid_argument);
+  EXPECT_THROW(LeverageSV(0.0, 0.5, 1.0, 1.2), std::invalid_argument);
+}
@@ -0,0 +1,118 @@
+#include <cmath>
+#include <limits>
+
+#include <Eigen/Dense>
+
+#include "gtest/gtest.h"
+#include "model/bootstrap_kernels.h"
+#include "model/sv_models.h"
+
+namespace {
+  template <typename Scalar>
+  using Vector = Eigen::Matrix<Scalar, Eigen::Dynamic, 1>;
+
+  //the expression form the kernels replace
+  template <typename Scalar>
+  Vector<Scalar> referenceDensities(const Vector<Scalar>& particles, const double& y) {
+    Vector<Scalar> stds = (particles / Scalar(2)).array().exp();
+    return (static_cast<Scalar>(-0.5 * std::log(2 * M_PI)) - stds.array().log())
+           + Scalar(-0.5) * (static_cast<Scalar>(y) / stds.array()).pow(2);
+  }
+
+  template <typename Scalar>
+  void expectMatchesExpressions(const long& n, const double& tolerance) {
+    const double mu = 0.1, phi = 0.9, sigma = 0.4, y = -0.7;
+    Vector<Scalar> particles = Vector<Scalar>::Random(n);
+    Vector<Scalar> noise = Vector<Scalar>::Random(n);
+    Vector<Scalar> logWeights = Vector<Scalar>::Random(n);
+    Vector<Scalar> weights = logWeights.array().exp();
+    weights /= weights.sum();
+
+    Vector<Scalar> expectedParticles = static_cast<Scalar>(mu) + static_cast<Scalar>(phi) * (particles.array() - static_cast<Scalar>(mu))
+                                       + noise.array() * static_cast<Scalar>(sigma);
+    Vector<Scalar> densities = referenceDensities<Scalar>(expectedParticles, y);
+    Vector<Scalar> expectedLogWeights = logWeights + densities;
+    const double maxLogWeight = expectedLogWeights.maxCoeff();
+    Vector<Scalar> expectedWeights = (expectedLogWeights.array() - static_cast<Scalar>(maxLogWeight)).exp();
+    const double weightSum = expectedWeights.sum();
+
+    Vector<Scalar> out(n);
+    kernels::WeighResult weighed = kernels::propagateAndWeigh<Scalar>(particles, noise, logWeights, weights, out,
+                                                                      GaussianSV(mu, phi, sigma).step<Scalar>(0.0, y));
+    EXPECT_NEAR(weighed.weightedLogLikelihood, weights.dot(densities), tolerance);
+    EXPECT_NEAR(weighed.maxLogWeight, maxLogWeight, tolerance);
+    for (long i = 0; i < n; ++i) {
+      EXPECT_NEAR(particles[i], expectedParticles[i], tolerance);
+      EXPECT_NEAR(out[i], expectedLogWeights[i], tolerance);
+    }
+
+    Vector<Scalar> newWeights(n);
+    kernels::ExponentiateResult sums = kernels::exponentiate<Scalar>(out, newWeights, weighed.maxLogWeight);
+    EXPECT_NEAR(sums.weightSum, weightSum, tolerance * n);
+    EXPECT_NEAR(sums.squaredWeightSum, expectedWeights.squaredNorm(), tolerance * n);
+
+    const double logEvidence = maxLogWeight + std::log(weightSum);
+    kernels::normalise<Scalar>(out, newWeights, logWeights, sums.weightSum, logEvidence);
+    for (long i = 0; i < n; ++i) {
+      EXPECT_NEAR(newWeights[i], expectedWeights[i] / weightSum, tolerance);
+      EXPECT_NEAR(logWeights[i], expectedLogWeights[i] - logEvidence, tolerance);
+    }
+  }
+}
+
+TEST(StochasticVolatility_BootstrapKernels, MatchesExpressionsDouble) {
+  //sizes off the packet width exercise the scalar tails
+  for (long n : {1L, 7L, 64L, 1023L}) {
+    expectMatchesExpressions<double>(n, 1e-12);
+  }
+}
+
+TEST(StochasticVolatility_BootstrapKernels, MatchesExpressionsFloat) {
+  for (long n : {1L, 7L, 64L, 1023L}) {
+    expectMatchesExpressions<float>(n, 1e-4);
+  }
+}
+
+TEST(StochasticVolatility_BootstrapKernels, NoiseAndOutputMayAlias) {
+  Eigen::VectorXd particles = Eigen::VectorXd::Random(37);
+  Eigen::VectorXd copy = particles;
+  Eigen::VectorXd noise = Eigen::VectorXd::Random(37);
+  Eigen::VectorXd logWeights = Eigen::VectorXd::Zero(37);
+  Eigen::VectorXd weights = Eigen::VectorXd::Constant(37, 1.0 / 37);
+  Eigen::VectorXd out(37);
+  const GaussianSV::Step<double> step = GaussianSV(0.0, 0.5, 1.0).step<double>(0.0, 0.3);
+
+  kernels::WeighResult separate = kernels::propagateAndWeigh<double>(copy, noise, logWeights, weights, out, step);
+  kernels::WeighResult aliased = kernels::propagateAndWeigh<double>(particles, noise, logWeights, weights, noise, step);
+
+  EXPECT_EQ(aliased.weightedLogLikelihood, separate.weightedLogLikelihood);
+  EXPECT_EQ(aliased.maxLogWeight, separate.maxLogWeight);
+  EXPECT_TRUE(noise == out);
+  EXPECT_TRUE(particles == copy);
+}
+
+TEST(StochasticVolatility_BootstrapKernels, ImpossibleParticles) {
+  //particles with zero weight and -inf log-weight add nothing and do not turn the sums into NaN
+  Eigen::VectorXd particles = Eigen::VectorXd::Zero(11);
+  Eigen::VectorXd noise = Eigen::VectorXd::Zero(11);
+  Eigen::VectorXd logWeights = Eigen::VectorXd::Constant(11, -std::numeric_limits<double>::infinity());
+  Eigen::VectorXd weights = Eigen::VectorXd::Zero(11);
+  logWeights[3] = 0.0;
+  weights[3] = 1.0;
+  Eigen::VectorXd out(11);
+  const GaussianSV::Step<double> step = GaussianSV(0.0, 0.5, 1.0).step<double>(0.0, 1.0);
+
+  kernels::WeighResult weighed = kernels::propagateAndWeigh<double>(particles, noise, logWeights, weights, out, step);
+  const double density = -0.5 * (std::log(2 * M_PI) + 1.0);
+  EXPECT_NEAR(weighed.weightedLogLikelihood, density, 1e-12);
+  EXPECT_NEAR(weighed.maxLogWeight, density, 1e-12);
+
+  kernels::ExponentiateResult sums = kernels::exponentiate<double>(out, weights, weighed.maxLogWeight);
+  EXPECT_DOUBLE_EQ(sums.weightSum, 1.0);
+  EXPECT_DOUBLE_EQ(sums.squaredWeightSum, 1.0);
+
+  //every particle impossible
+  logWeights.setConstant(-std::numeric_limits<double>::infinity());
+  weighed = kernels::propagateAndWeigh<double>(particles, noise, logWeights, weights, out, step);
+  EXPECT_FALSE(std::isfinite(weighed.maxLogWeight));
+}
@@ -0,0 +1,108 @@
+#include <cmath>
+#include <vector>
+#include <thread>
+#include <future>
+#include <stdexcept>
+
+#include "gtest/gtest.h"
+
+#include "model/stochastic_volatility_model.h"
+#include "model/filter_executor.h"
+#include "statistics/normal_distribution.h"
+#include "statistics/particles.h"
+
+#include "test_series.h"
+
+
+TEST(StochasticVolatility_FilterExecutor, MatchesDirectCalls) {
+  Eigen::VectorXd y = testseries::switchingVolatility();
+  FilterExecutor executor(3);
+  EXPECT_EQ(executor.getThreadCount(), 3);
+
+  FilterOptions single;
+  single.precision = FilterPrecision::Single;
+
+  std::vector<std::shared_future<double>> likelihoods, marginals, singles;
+  for (unsigned int seed=1; seed<=12; seed++) {
+    Eigen::Vector3d parameters(0.1, 0.5, -0.5 + 0.05 * seed);
+    likelihoods.push_back(executor.submitLogLikelihood(y, parameters, 300, seed));
+    marginals.push_back(executor.submitLogMarginalLikelihood(y, parameters, 300, seed));
+    singles.push_back(executor.submitLogLikelihood(y, parameters, 300, seed, single));
+  }
+
+  for (unsigned int seed=1; seed<=12; seed++) {
+    StochasticVolatilityModel svm(0.1, 0.5, -0.5 + 0.05 * seed);
+    EXPECT_EQ(likelihoods[seed-1].get(), svm.logLikelihood(y, 300, seed));
+    EXPECT_EQ(marginals[seed-1].get(), svm.logMarginalLikelihood(y, 300, seed));
+    EXPECT_EQ(singles[seed-1].get(), svm.logLikelihood(y, 300, seed, single));
+  }
+  EXPECT_EQ(executor.getQueuedCount(), 0);
+}
+
+TEST(StochasticVolatility_FilterExecutor, PropagatesExceptions) {
+  Eigen::VectorXd y = testseries::switchingVolatility();
+  FilterExecutor executor(2);
+  std::shared_future<double> failed = executor.submitLogLikelihood(y, Eigen::Vector3d(0.1, 0.5, -0.5), 0, 1);
+  EXPECT_THROW(failed.get(), std::invalid_argument);
+
+  //workers stay usable afterwards
+  std::shared_future<double> result = executor.submitLogLikelihood(y, Eigen::Vector3d(0.1, 0.5, -0.5), 100, 1);
+  EXPECT_TRUE(std::isfinite(result.get()));
+  EXPECT_THROW(FilterExecutor(0), std::invalid_argument);
+}
+
+TEST(StochasticVolatility_FilterExecutor, DestructorFinishesQueuedTasks) {
+  Eigen::VectorXd y = testseries::switchingVolatility();
+  std::vector<std::shared_future<double>> results;
+  {
+    FilterExecutor executor(1);
+    for (unsigned int seed=1; seed<=5; seed++) {
+      results.push_back(executor.submitLogLikelihood(y, Eigen::Vector3d(0.1, 0.5, -0.5), 200, seed));
+    }
+  }
+
+  StochasticVolatilityModel svm(0.1, 0.5, -0.5);
+  for (unsigned int seed=1; seed<=5; seed++) {
+    EXPECT_EQ(results[seed-1].get(), svm.logLikelihood(y, 200, seed));
+  }
+}
+
+TEST(StochasticVolatility_FilterExecutor, SharedObjectsAcrossThreads) {
+  //one model and one NormalDistribution sampled from several threads at once
+  Eigen::VectorXd y = testseries::switchingVolatility();
+  StochasticVolatilityModel svm(0.1, 0.5, -0.5);
+  NormalDistribution normal(1.0, 2.0);
+  Eigen::VectorXd weights = Eigen::VectorXd::LinSpaced(300, 1.0, 2.0);
+  weights /= weights.sum();
+
+  auto resampled = [&] {
+    Particles particles(normal, 300, 1, 5);
+    particles.resampleParticles(weights, ResamplingScheme::Systematic, 11);
+    return particles.getParticlesAsEigenMatrix();
+  };
+  const double expectedLikelihood = svm.logLikelihood(y, 300, 9);
+  const Eigen::MatrixXd expectedParticles = svm.particleFilter(y, 300, 9).getParticlesAsEigenMatrix();
+  const std::vector<double> expectedSample = normal.sample(100, 4);
+  const Eigen::MatrixXd expectedResampled = resampled();
+
+  std::vector<int> matches(4, 0);
+  std::vector<std::thread> threads;
+  for (int i=0; i<4; i++) {
+    threads.emplace_back([&, i] {
+      for (int rep=0; rep<5; rep++) {
+        bool match = svm.logLikelihood(y, 300, 9) == expectedLikelihood
+                     && svm.particleFilter(y, 300, 9).getParticlesAsEigenMatrix() == expectedParticles
+                     && normal.sample(100, 4) == expectedSample
+                     && resampled() == expectedResampled;
+        matches[i] += match;
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  for (int i=0; i<4; i++) {
+    EXPECT_EQ(matches[i], 5);
+  }
+}
@@ -0,0 +1,106 @@
+#include <cmath>
+#include <memory>
+
+#include "gtest/gtest.h"
+
+#include "model/stochastic_volatility_model.h"
+#include "model/filter_statistics.h"
+#include "model/filter_workspace.h"
+
+#include "test_series.h"
+
+
+TEST(StochasticVolatility_FilterStatistics, RecordsBootstrapRun) {
+  ASSERT_TRUE(FilterStatistics::isEnabled());
+  Eigen::VectorXd y = testseries::switchingVolatility();
+  StochasticVolatilityModel svm(0.1, 0.5, -0.5);
+  FilterOptions options;
+  options.statistics = std::make_shared<FilterStatistics>();
+
+  double logLikelihood = svm.logLikelihood(y, 500, 3, options);
+  EXPECT_EQ(logLikelihood, svm.logLikelihood(y, 500, 3)); //recording does not change the result
+
+  const FilterStatistics& statistics = *options.statistics;
+  EXPECT_EQ(statistics.stepCount, 200);
+  ASSERT_EQ(statistics.effectiveSampleSizes.size(), 200);
+  for (double ess : statistics.effectiveSampleSizes) {
+    EXPECT_GT(ess, 0.0);
+    EXPECT_LE(ess, 500.0 + 1e-9);
+  }
+  EXPECT_GT(statistics.resampleCount, 0);
+  EXPECT_LT(statistics.resampleCount, 200);
+  EXPECT_EQ(statistics.degenerateStepCount, 0);
+
+  EXPECT_GT(statistics.noiseSeconds, 0.0);
+  EXPECT_GT(statistics.propagateSeconds, 0.0);
+  EXPECT_GT(statistics.weightSeconds, 0.0);
+  EXPECT_GT(statistics.normaliseSeconds, 0.0);
+  EXPECT_GT(statistics.resampleSeconds, 0.0);
+  EXPECT_LE(statistics.noiseSeconds + statistics.propagateSeconds + statistics.weightSeconds
+            + statistics.normaliseSeconds + statistics.resampleSeconds, statistics.totalSeconds);
+}
+
+TEST(StochasticVolatility_FilterStatistics, CountsAllocations) {
+  Eigen::VectorXd y = testseries::switchingVolatility();
+  StochasticVolatilityModel svm(0.1, 0.5, -0.5);
+  FilterOptions options;
+  options.statistics = std::make_shared<FilterStatistics>();
+  FilterWorkspace workspace(500);
+
+  //the first run sizes the statistics, after that a warm workspace filters without allocating
+  svm.logLikelihood(y, 500, 3, options, workspace);
+  svm.logLikelihood(y, 500, 4, options, workspace);
+#if defined(__GLIBC__)
+  EXPECT_EQ(options.statistics->allocationCount, 0);
+
+  svm.particleFilter(y, 500, 4, options);
+  EXPECT_GT(options.statistics->allocationCount, 200); //at least one copy of the latest particles per step
+#endif
+  EXPECT_EQ(options.statistics->stepCount, 200);
+}
+
+TEST(StochasticVolatility_FilterStatistics, DegenerateSteps) {
+  Eigen::VectorXd y = testseries::switchingVolatility();
+  y[100] = 1e200; //impossible under every particle
+  StochasticVolatilityModel svm(0.1, 0.5, -0.5);
+  FilterOptions options;
+  options.statistics = std::make_shared<FilterStatistics>();
+
+  svm.logMarginalLikelihood(y, 300, 5, options);
+  EXPECT_EQ(options.statistics->degenerateStepCount, 1);
+  EXPECT_TRUE(std::isnan(options.statistics->effectiveSampleSizes[100]));
+  EXPECT_FALSE(std::isnan(options.statistics->effectiveSampleSizes[101]));
+}
+
+TEST(StochasticVolatility_FilterStatistics, OtherProposalsAndEngines) {
+  Eigen::VectorXd y = testseries::switchingVolatility();
+  StochasticVolatilityModel svm(0.1, 0.5, -0.5);
+
+  FilterOptions auxiliary;
+  auxiliary.proposal = FilterProposal::Auxiliary;
+  auxiliary.essThreshold = 2.0; //resamples every step
+  auxiliary.statistics = std::make_shared<FilterStatistics>();
+  svm.particleFilter(y, 300, 5, auxiliary);
+  EXPECT_EQ(auxiliary.statistics->stepCount, 200);
+  EXPECT_EQ(auxiliary.statistics->resampleCount, 201); //first stage of every step and the final one
+  EXPECT_GT(auxiliary.statistics->weightSeconds, 0.0);
+  EXPECT_GT(auxiliary.statistics->propagateSeconds, 0.0);
+
+  FilterOptions philox;
+  philox.randomEngine = RandomEngine::Philox;
+  philox.threadCount = 3;
+  philox.precision = FilterPrecision::Single;
+  philox.statistics = std::make_shared<FilterStatistics>();
+  svm.logLikelihood(y, 5000, 5, philox);
+  EXPECT_EQ(philox.statistics->stepCount, 200);
+  EXPECT_GT(philox.statistics->noiseSeconds, 0.0);
+  EXPECT_GT(philox.statistics->weightSeconds, 0.0);
+
+  FilterOptions pooled;
+  pooled.threadCount = 3;
+  pooled.statistics = std::make_shared<FilterStatistics>();
+  svm.logLikelihood(y, 5000, 5, pooled);
+  EXPECT_EQ(pooled.statistics->stepCount, 200);
+  EXPECT_GT(pooled.statistics->propagateSeconds, 0.0);
+  EXPECT_GT(pooled.statistics->normaliseSeconds, 0.0);
+}
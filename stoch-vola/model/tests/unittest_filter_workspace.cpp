@@ -0,0 +1,120 @@
+#include <cmath>
+
+#include "gtest/gtest.h"
+
+#include "model/stochastic_volatility_model.h"
+#include "model/filter_workspace.h"
+#include "model/sv_filter_state.h"
+#include "statistics/allocation_counter.h"
+
+#include "test_series.h"
+
+namespace {
+  template <typename Function>
+  long countAllocations(Function&& function) {
+    allocationcounter::enable();
+    const long start = allocationcounter::count();
+    function();
+    const long allocations = allocationcounter::count() - start;
+    allocationcounter::disable();
+    return allocations;
+  }
+}
+
+
+TEST(StochasticVolatility_FilterWorkspace, MatchesFreshWorkspace) {
+  Eigen::VectorXd y = testseries::switchingVolatility();
+  StochasticVolatilityModel svm(0.1, 0.5, -0.5);
+  FilterWorkspace workspace(500);
+
+  for (unsigned int seed : {1u, 2u, 3u}) {
+    EXPECT_EQ(svm.logLikelihood(y, 500, seed, FilterOptions(), workspace), svm.logLikelihood(y, 500, seed));
+    EXPECT_EQ(svm.logMarginalLikelihood(y, 500, seed, FilterOptions(), workspace), svm.logMarginalLikelihood(y, 500, seed));
+  }
+
+  //a different particle count or precision resizes the workspace
+  EXPECT_EQ(svm.logLikelihood(y, 50, 7, FilterOptions(), workspace), svm.logLikelihood(y, 50, 7));
+  EXPECT_EQ(workspace.getParticleCount(), 50);
+
+  FilterOptions single;
+  single.precision = FilterPrecision::Single;
+  EXPECT_EQ(svm.logLikelihood(y, 100, 7, single, workspace), svm.logLikelihood(y, 100, 7, single));
+  EXPECT_EQ(workspace.getParticleCount(FilterPrecision::Single), 100);
+
+  FilterOptions auxiliary;
+  auxiliary.proposal = FilterProposal::Auxiliary;
+  EXPECT_EQ(svm.logLikelihood(y, 100, 7, auxiliary, workspace), svm.logLikelihood(y, 100, 7, auxiliary));
+}
+
+TEST(StochasticVolatility_FilterWorkspace, SteadyStateDoesNotAllocate) {
+#if !defined(__GLIBC__)
+  GTEST_SKIP() << "allocations are only counted on glibc";
+#else
+  Eigen::VectorXd y = testseries::switchingVolatility();
+  StochasticVolatilityModel svm(0.1, 0.5, -0.5);
+
+  for (ResamplingScheme scheme : {ResamplingScheme::Systematic, ResamplingScheme::Multinomial, ResamplingScheme::Residual}) {
+    for (FilterPrecision precision : {FilterPrecision::Double, FilterPrecision::Single}) {
+      for (RandomEngine engine : {RandomEngine::MersenneTwister, RandomEngine::Sobol}) {
+        FilterOptions options;
+        options.resamplingScheme = scheme;
+        options.precision = precision;
+        options.randomEngine = engine;
+        FilterWorkspace workspace(1000, precision);
+
+        double logLike = 0.0;
+        EXPECT_EQ(countAllocations([&] {logLike = svm.logLikelihood(y, 1000, 123, options, workspace);}), 0);
+        EXPECT_TRUE(std::isfinite(logLike));
+
+        //another parameter set, as in an optimiser
+        StochasticVolatilityModel other(0.0, 1.0, -1.0);
+        EXPECT_EQ(countAllocations([&] {logLike = other.logMarginalLikelihood(y, 1000, 5, options, workspace);}), 0);
+        EXPECT_TRUE(std::isfinite(logLike));
+      }
+    }
+  }
+
+  //over a pool the first call starts the threads, later calls reuse them with the block engines and sums
+  for (ResamplingScheme scheme : {ResamplingScheme::Systematic, ResamplingScheme::Multinomial, ResamplingScheme::Residual}) {
+    for (RandomEngine engine : {RandomEngine::MersenneTwister, RandomEngine::Philox}) {
+      FilterOptions options;
+      options.resamplingScheme = scheme;
+      options.randomEngine = engine;
+      options.threadCount = 3;
+      FilterWorkspace workspace(1000, options.precision);
+      svm.logLikelihood(y, 1000, 7, options, workspace);
+
+      double logLike = 0.0;
+      EXPECT_EQ(countAllocations([&] {logLike = svm.logLikelihood(y, 1000, 123, options, workspace);}), 0);
+      EXPECT_TRUE(std::isfinite(logLike));
+    }
+  }
+
+  //the auxiliary proposal keeps its expansion in the workspace as well
+  for (unsigned int threadCount : {1u, 3u}) {
+    FilterOptions options;
+    options.proposal = FilterProposal::Auxiliary;
+    options.threadCount = threadCount;
+    FilterWorkspace workspace(1000);
+    svm.logLikelihood(y, 1000, 7, options, workspace);
+
+    double logLike = 0.0;
+    EXPECT_EQ(countAllocations([&] {logLike = svm.logMarginalLikelihood(y, 1000, 123, options, workspace);}), 0);
+    EXPECT_TRUE(std::isfinite(logLike));
+  }
+
+  //without a workspace every call allocates its own buffers
+  EXPECT_GT(countAllocations([&] {svm.logLikelihood(y, 1000, 123);}), 0);
+
+  FilterOptions sobol;
+  sobol.randomEngine = RandomEngine::Sobol;
+  for (const FilterOptions& options : {FilterOptions(), sobol}) {
+    SVFilterState state(svm, 1000, 123, options);
+    EXPECT_EQ(countAllocations([&] {
+      for (int t=0; t<y.size(); t++) {
+        state.step(y[t]);
+      }
+    }), 0);
+  }
+#endif
+}
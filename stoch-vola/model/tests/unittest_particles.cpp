@@ -1,4 +1,6 @@
+#include <cmath>
 #include <vector>
+#include <string>
 #include <algorithm>
 #include <functional>
 
@@ -146,3 +148,292 @@ TEST(StochasticVolatility_Particles, resampleParticles) {
 
   EXPECT_TRUE(p == pt);
 }
+
+TEST(StochasticVolatility_Particles, resampleParticlesSystematic) {
+  std::vector<double> initial_particles = {1.0, 2.0, 3.0};
+  Particles p(initial_particles);
+
+  Eigen::VectorXd weights(3);
+  weights << 0.0, 0.0, 5.0;
+  p.resampleParticles(weights, ResamplingScheme::Systematic);
+
+  std::vector<double> test_particles = {3.0, 3.0, 3.0};
+  Particles pt(test_particles);
+
+  EXPECT_TRUE(p == pt);
+}
+
+TEST(StochasticVolatility_Particles, genealogyMatchesCopy) {
+  Eigen::VectorXd initialParticles = Eigen::VectorXd::LinSpaced(5, 1.0, 5.0);
+  Particles copied(initialParticles, 4);
+  Particles traced(initialParticles, 4);
+  traced.setPathStorage(PathStorage::Genealogy);
+
+  Eigen::VectorXd weights(5);
+  weights << 0.1, 0.4, 0.0, 0.3, 0.2;
+
+  for (int t=1; t<4; t++) {
+    Eigen::VectorXd newParticles = initialParticles * (10.0 * t);
+    copied.appendParticles(newParticles);
+    traced.appendParticles(newParticles);
+
+    copied.resampleParticles(weights, ResamplingScheme::Multinomial, t);
+    traced.resampleParticles(weights, ResamplingScheme::Multinomial, t);
+    weights = weights.reverse().eval();
+  }
+
+  EXPECT_EQ(traced.getPathStorage(), PathStorage::Genealogy);
+  EXPECT_TRUE(copied.getLatestParticles() == traced.getLatestParticles());
+  EXPECT_TRUE(copied.getParticlesAsEigenMatrix() == traced.getParticlesAsEigenMatrix());
+  EXPECT_TRUE(copied.getParticlesWithoutInit() == traced.getParticlesWithoutInit());
+
+  traced.setPathStorage(PathStorage::Copy);
+  EXPECT_TRUE(copied.getParticlesAsEigenMatrix() == traced.getParticlesAsEigenMatrix());
+}
+
+TEST(StochasticVolatility_Particles, timeMajorMatchesTraceMajor) {
+  Eigen::VectorXd initialParticles = Eigen::VectorXd::LinSpaced(5, 1.0, 5.0);
+  Eigen::VectorXd weights(5);
+  weights << 0.1, 0.4, 0.0, 0.3, 0.2;
+
+  for (PathStorage storage : {PathStorage::Copy, PathStorage::Genealogy}) {
+    Particles traceMajor(initialParticles, 4);
+    Particles timeMajor(initialParticles, 4, ParticleLayout::TimeMajor);
+    traceMajor.setPathStorage(storage);
+    timeMajor.setPathStorage(storage);
+
+    for (int t=1; t<4; t++) {
+      Eigen::VectorXd newParticles = initialParticles * (10.0 * t);
+      traceMajor.appendParticles(newParticles);
+      timeMajor.appendParticles(newParticles);
+
+      traceMajor.resampleParticles(weights, ResamplingScheme::Multinomial, t);
+      timeMajor.resampleParticles(weights, ResamplingScheme::Multinomial, t);
+      weights = weights.reverse().eval();
+    }
+
+    EXPECT_EQ(timeMajor.getLayout(), ParticleLayout::TimeMajor);
+    EXPECT_TRUE(traceMajor.getLatestParticles() == timeMajor.getLatestParticles());
+    EXPECT_TRUE(traceMajor.getParticlesAsEigenMatrix() == timeMajor.getParticlesAsEigenMatrix());
+    EXPECT_TRUE(traceMajor.getParticlesWithoutInit() == timeMajor.getParticlesWithoutInit());
+    EXPECT_EQ(timeMajor.getParticlesWithoutInit().getLayout(), ParticleLayout::TimeMajor);
+
+    auto mean = [](const Eigen::VectorXd& v) {return v.mean();};
+    EXPECT_TRUE(traceMajor.reduceParticles(mean) == timeMajor.reduceParticles(mean));
+    EXPECT_TRUE(traceMajor.reduceTraces(mean) == timeMajor.reduceTraces(mean));
+
+    timeMajor.setPathStorage(PathStorage::Copy);
+    EXPECT_TRUE(traceMajor.getParticlesAsEigenMatrix() == timeMajor.getParticlesAsEigenMatrix());
+  }
+}
+
+TEST(StochasticVolatility_Particles, StorageFollowsLayout) {
+  Eigen::VectorXd initialParticles(3);
+  initialParticles << 1.0, 2.0, 3.0;
+  Eigen::VectorXd weights(3);
+  weights << 0.2, 0.5, 0.3;
+
+  for (ParticleLayout layout : {ParticleLayout::TraceMajor, ParticleLayout::TimeMajor}) {
+    Particles particles(initialParticles, 3, layout);
+    particles.setPathStorage(PathStorage::Genealogy);
+    particles.appendParticles(initialParticles * 10.0);
+    particles.resampleParticles(weights, ResamplingScheme::Systematic, 5);
+    particles.appendParticles(initialParticles * 100.0);
+
+    //the Python views read the storage in place once the paths are traced
+    particles.setPathStorage(PathStorage::Copy);
+    Eigen::Map<const Eigen::MatrixXd> storage = particles.getStorage();
+    const Eigen::MatrixXd traced = particles.getParticlesAsEigenMatrix();
+    EXPECT_TRUE(layout == ParticleLayout::TimeMajor ? storage.transpose() == traced : storage == traced);
+  }
+}
+
+TEST(StochasticVolatility_Particles, FileStorageMatchesMemory) {
+  Eigen::VectorXd initialParticles(4);
+  initialParticles << 1.0, 2.0, 3.0, 4.0;
+  Eigen::VectorXd weights(4);
+  weights << 0.1, 0.4, 0.3, 0.2;
+  const std::string path = testing::TempDir() + "particles_storage.traj";
+
+  for (ParticleLayout layout : {ParticleLayout::TraceMajor, ParticleLayout::TimeMajor}) {
+    for (PathStorage storage : {PathStorage::Copy, PathStorage::Genealogy}) {
+      Particles inMemory(initialParticles, 4, layout);
+      Particles inFile(initialParticles, 4, layout, path);
+      EXPECT_EQ(inFile.getStorageFile(), path);
+
+      for (Particles* particles : {&inMemory, &inFile}) {
+        particles->setPathStorage(storage);
+        particles->appendParticles(initialParticles * 10.0);
+        particles->resampleParticles(weights, ResamplingScheme::Systematic, 5);
+        particles->appendParticles(initialParticles * 100.0);
+        particles->resampleParticles(weights, ResamplingScheme::Multinomial, 6);
+      }
+      EXPECT_TRUE(inFile.getParticlesAsEigenMatrix() == inMemory.getParticlesAsEigenMatrix());
+
+      //trimmed in place, as particleFilter does with a storage file
+      inFile.removeInitialParticles();
+      EXPECT_TRUE(inFile.getParticlesAsEigenMatrix() == inMemory.getParticlesWithoutInit().getParticlesAsEigenMatrix());
+
+      Particles copy = inFile;
+      EXPECT_TRUE(copy.getStorageFile().empty());
+      EXPECT_TRUE(copy == inFile);
+    }
+  }
+}
+
+TEST(StochasticVolatility_Particles, StorageFileRoundTrip) {
+  Eigen::VectorXd initialParticles(3);
+  initialParticles << 1.0, 2.0, 3.0;
+  const std::string path = testing::TempDir() + "particles_round_trip.traj";
+
+  Particles particles(initialParticles, 3, ParticleLayout::TimeMajor);
+  particles.setPathStorage(PathStorage::Genealogy);
+  particles.appendParticles(initialParticles * 10.0);
+  particles.applyAncestors((Eigen::VectorXi(3) << 2, 2, 0).finished());
+  particles.setStorageFile(path); //spilled mid-run, the genealogy with it
+
+  {
+    Particles reopened = Particles::openStorageFile(path);
+    EXPECT_EQ(reopened.getPathStorage(), PathStorage::Genealogy);
+    EXPECT_EQ(reopened.getLayout(), ParticleLayout::TimeMajor);
+    EXPECT_TRUE(reopened.getLatestParticles() == particles.getLatestParticles());
+    EXPECT_TRUE(reopened.getParticlesAsEigenMatrix() == particles.getParticlesAsEigenMatrix());
+  }
+
+  //the documented header and layout, read without the class
+  particles.setPathStorage(PathStorage::Copy);
+  TrajectoryFileHeader header = trajectoryfile::readHeader(path);
+  EXPECT_EQ(header.scalarSize, sizeof(double));
+  EXPECT_EQ(header.layout, 1u);
+  EXPECT_EQ(header.pathStorage, 0u);
+  EXPECT_EQ(header.particleCount, 3u);
+  EXPECT_EQ(header.particleLength, 3u);
+  EXPECT_EQ(header.currentRow, 1u);
+
+  MappedFile file(path, MappingMode::ReadOnly);
+  Eigen::Map<const Eigen::MatrixXd> stored(reinterpret_cast<const double*>(static_cast<const char*>(file.data()) + header.dataOffset),
+                                           3, 3);
+  EXPECT_TRUE(stored.transpose() == particles.getParticlesAsEigenMatrix());
+
+  particles.setStorageFile("");
+  EXPECT_TRUE(particles.getStorageFile().empty());
+  EXPECT_TRUE(particles.getStorage() == stored);
+
+  EXPECT_THROW(ParticlesT<float>::openStorageFile(path), std::invalid_argument);
+}
+
+TEST(StochasticVolatility_Particles, SaveLoad) {
+  Eigen::VectorXd initialParticles(5);
+  initialParticles << 0.1, -0.2, 0.3, -0.4, 0.5;
+  const std::string path = testing::TempDir() + "particles_snapshot.traj";
+
+  for (PathStorage storage : {PathStorage::Copy, PathStorage::Genealogy}) {
+    Particles particles(initialParticles, 4, ParticleLayout::TraceMajor);
+    particles.setPathStorage(storage);
+    particles.appendParticles(initialParticles / 3.0);
+    particles.applyAncestors((Eigen::VectorXi(5) << 4, 0, 0, 2, 1).finished());
+
+    particles.save(path);
+    Particles loaded = Particles::load(path);
+    EXPECT_TRUE(loaded.getStorageFile().empty());
+    EXPECT_EQ(loaded.getPathStorage(), storage);
+    EXPECT_TRUE(loaded.getStorage() == particles.getStorage());
+    EXPECT_TRUE(loaded.getLatestParticles() == particles.getLatestParticles());
+
+    //both go on identically
+    particles.appendParticles(initialParticles * 2.0);
+    loaded.appendParticles(initialParticles * 2.0);
+    EXPECT_TRUE(loaded.getParticlesAsEigenMatrix() == particles.getParticlesAsEigenMatrix());
+  }
+}
+
+TEST(StochasticVolatility_Particles, TemplatedTransformations) {
+  //large enough to be split over 4 threads
+  Eigen::MatrixXd initialParticles = Eigen::MatrixXd::Random(300, 1000);
+
+  for (ParticleLayout layout : {ParticleLayout::TraceMajor, ParticleLayout::TimeMajor}) {
+    Particles expected(initialParticles, 300, layout);
+    expected.applyTransformation(std::function<double(double)>([](double v) {return std::exp(0.5 * v);}));
+
+    Particles inlined(initialParticles, 300, layout);
+    inlined.applyTransformation([](double v) {return std::exp(0.5 * v);}, 4);
+    EXPECT_TRUE(inlined.getStorage() == expected.getStorage());
+
+    Particles vectorised(initialParticles, 300, layout);
+    vectorised.applyArrayTransformation([](const auto& x) {return (0.5 * x).exp();}, 4);
+    EXPECT_TRUE(vectorised.getStorage().isApprox(expected.getStorage(), 1e-14));
+  }
+}
+
+TEST(StochasticVolatility_Particles, TemplatedReductions) {
+  Eigen::VectorXd initialParticles = Eigen::VectorXd::Random(400);
+  Eigen::VectorXi ancestors = Eigen::VectorXi::LinSpaced(400, 0, 399).reverse();
+  ancestors.head(100).setZero();
+  std::function<double(const Eigen::VectorXd&)> mean = [](const Eigen::VectorXd& v) {return v.mean();};
+
+  for (PathStorage storage : {PathStorage::Copy, PathStorage::Genealogy}) {
+    for (ParticleLayout layout : {ParticleLayout::TraceMajor, ParticleLayout::TimeMajor}) {
+      Particles particles(initialParticles, 200, layout);
+      particles.setPathStorage(storage);
+      for (int t = 1; t < 200; ++t) {
+        particles.appendParticles(initialParticles * std::cos(t));
+        particles.applyAncestors(ancestors);
+      }
+
+      //strided views may be summed in another order than the copies
+      for (unsigned int threads : {1u, 4u}) {
+        EXPECT_TRUE(particles.reduceParticles([](const auto& v) {return v.mean();}, threads).isApprox(particles.reduceParticles(mean), 1e-14));
+        EXPECT_TRUE(particles.reduceTraces([](const auto& v) {return v.mean();}, threads).isApprox(particles.reduceTraces(mean), 1e-14));
+      }
+      //a reference parameter takes a copy
+      EXPECT_TRUE(particles.reduceParticles([](const Eigen::VectorXd& v) {return v.maxCoeff();})
+                  == particles.reduceParticles(std::function<double(const Eigen::VectorXd&)>([](const Eigen::VectorXd& v) {return v.maxCoeff();})));
+    }
+  }
+}
+
+TEST(StochasticVolatility_Particles, ParticleMoments) {
+  Eigen::MatrixXd initialParticles = (Eigen::MatrixXd::Random(300, 1000).array() + 3.0).matrix();
+  std::function<double(const Eigen::VectorXd&)> mean = [](const Eigen::VectorXd& v) {return v.mean();};
+  std::function<double(const Eigen::VectorXd&)> variance = [](const Eigen::VectorXd& v) {
+    return (v.array() - v.mean()).square().mean();
+  };
+
+  for (ParticleLayout layout : {ParticleLayout::TraceMajor, ParticleLayout::TimeMajor}) {
+    Particles particles(initialParticles, 300, layout);
+    for (unsigned int threads : {1u, 4u}) {
+      EXPECT_TRUE(particles.particleMeans(threads).isApprox(particles.reduceParticles(mean), 1e-14));
+      EXPECT_TRUE(particles.particleVariances(threads).isApprox(particles.reduceParticles(variance), 1e-12));
+    }
+  }
+}
+
+TEST(StochasticVolatility_Particles, ParticleQuantiles) {
+  Eigen::MatrixXd initialParticles = Eigen::MatrixXd::Random(50, 1001);
+  initialParticles.row(3).setConstant(2.0); //ties
+  const std::vector<double> probabilities = {0.95, 0.05, 0.5, 0.5, 0.0, 1.0, 0.2501};
+
+  for (ParticleLayout layout : {ParticleLayout::TraceMajor, ParticleLayout::TimeMajor}) {
+    Particles particles(initialParticles, 50, layout);
+    Eigen::MatrixXd quantiles = particles.particleQuantiles(probabilities, 2);
+    ASSERT_EQ(quantiles.rows(), 50);
+    ASSERT_EQ(quantiles.cols(), 7);
+
+    for (int t = 0; t < 50; ++t) {
+      Eigen::VectorXd row = initialParticles.row(t);
+      std::vector<double> sorted(row.data(), row.data() + row.size());
+      std::sort(sorted.begin(), sorted.end());
+      for (int k = 0; k < 7; ++k) {
+        const double position = probabilities[k] * 1000;
+        const size_t lower = static_cast<size_t>(position);
+        const double weight = position - lower;
+        const double expected = lower + 1 < sorted.size() ? sorted[lower] * (1.0 - weight) + sorted[lower + 1] * weight
+                                                          : sorted[lower];
+        EXPECT_EQ(quantiles(t, k), expected);
+      }
+    }
+  }
+
+  Particles particles(initialParticles, 50);
+  EXPECT_THROW(particles.particleQuantiles({0.5, 1.5}), std::invalid_argument);
+}
@@ -0,0 +1,75 @@
+#include <vector>
+#include <cmath>
+#include <stdexcept>
+
+#include "gtest/gtest.h"
+
+#include "model/pmmh_sampler.h"
+#include "model/stochastic_volatility_model.h"
+
+namespace {
+  Eigen::VectorXd testSeries() {
+    Eigen::VectorXd y(8);
+    y << 1.0 , -2.0, 0.5, 0.3, -0.1, 1.5, -0.7, 0.2;
+    return y;
+  }
+}
+
+TEST(StochasticVolatility_PMMHSampler, Shapes) {
+  PMMHSampler sampler(testSeries(), 50, Eigen::Vector3d::Constant(0.1));
+  PMMHResult result = sampler.sample(Eigen::Vector3d::Zero(), 30, 3, 123, 2);
+
+  ASSERT_EQ(result.chains.size(), 3);
+  for (const Eigen::MatrixXd& chain : result.chains) {
+    EXPECT_EQ(chain.rows(), 30);
+    EXPECT_EQ(chain.cols(), 3);
+  }
+  EXPECT_EQ(result.logMarginalLikelihoods.rows(), 30);
+  EXPECT_EQ(result.logMarginalLikelihoods.cols(), 3);
+  ASSERT_EQ(result.acceptanceRates.size(), 3);
+  for (int c=0; c<3; c++) {
+    EXPECT_GE(result.acceptanceRates[c], 0.0);
+    EXPECT_LE(result.acceptanceRates[c], 1.0);
+  }
+  EXPECT_TRUE(result.logMarginalLikelihoods.allFinite());
+}
+
+TEST(StochasticVolatility_PMMHSampler, DeterministicAcrossThreadCounts) {
+  PMMHSampler sampler(testSeries(), 30, Eigen::Vector3d::Constant(0.2));
+  PMMHResult serial = sampler.sample(Eigen::Vector3d::Zero(), 20, 4, 7, 1);
+  PMMHResult parallel = sampler.sample(Eigen::Vector3d::Zero(), 20, 4, 7, 3);
+
+  for (int c=0; c<4; c++) {
+    EXPECT_TRUE(serial.chains[c] == parallel.chains[c]);
+  }
+  EXPECT_TRUE(serial.acceptanceRates == parallel.acceptanceRates);
+  EXPECT_FALSE(serial.chains[0] == serial.chains[1]); //chains use their own random numbers
+}
+
+TEST(StochasticVolatility_PMMHSampler, ZeroProposalScaleNeverMoves) {
+  PMMHSampler sampler(testSeries(), 30, Eigen::Vector3d(0.0, 0.3, 0.0));
+  PMMHResult result = sampler.sample(Eigen::Vector3d(0.1, 0.2, -0.3), 25, 2, 123, 2);
+
+  for (const Eigen::MatrixXd& chain : result.chains) {
+    EXPECT_TRUE((chain.col(0).array() == 0.1).all());
+    EXPECT_TRUE((chain.col(2).array() == -0.3).all());
+  }
+}
+
+TEST(StochasticVolatility_PMMHSampler, LogMarginalLikelihoodMatchesFilter) {
+  //a single-particle filter has equal weights throughout, so the estimate is the sum of the per-step averages
+  Eigen::VectorXd y = testSeries();
+  StochasticVolatilityModel svm(0.1, 0.5, -0.5);
+  EXPECT_NEAR(svm.logMarginalLikelihood(y, 1, 123), svm.logLikelihood(y, 1, 123) * y.size(), 1e-9);
+  EXPECT_LT(svm.logMarginalLikelihood(y, 200, 123), 0.0);
+}
+
+TEST(StochasticVolatility_PMMHSampler, InvalidArguments) {
+  EXPECT_THROW(PMMHSampler(testSeries(), 0, Eigen::Vector3d::Constant(0.1)), std::invalid_argument);
+  EXPECT_THROW(PMMHSampler(testSeries(), 10, Eigen::Vector3d::Constant(-0.1)), std::invalid_argument);
+  EXPECT_THROW(PMMHSampler(testSeries(), 10, Eigen::Vector3d::Constant(0.1), Eigen::Vector3d::Zero()), std::invalid_argument);
+
+  PMMHSampler sampler(testSeries(), 10, Eigen::Vector3d::Constant(0.1));
+  EXPECT_THROW(sampler.sample(Eigen::Vector3d::Zero(), 10, 0), std::invalid_argument);
+  EXPECT_THROW(sampler.sample(Eigen::Vector3d::Zero(), 0, 2), std::invalid_argument);
+}
@@ -0,0 +1,90 @@
+#include <cmath>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+#include <Eigen/Dense>
+
+#include "gtest/gtest.h"
+#include "statistics/quasi_random.h"
+
+TEST(StochasticVolatility_QuasiRandom, NormalQuantile) {
+  EXPECT_NEAR(quasirandom::normalQuantile(0.5), 0.0, 1e-15);
+  EXPECT_NEAR(quasirandom::normalQuantile(0.975), 1.959963984540054, 1e-13);
+  EXPECT_NEAR(quasirandom::normalQuantile(0.025), -1.959963984540054, 1e-13);
+  EXPECT_NEAR(quasirandom::normalQuantile(1e-10), -6.361340902404056, 1e-11);
+  EXPECT_EQ(quasirandom::normalQuantile(0.0), -INFINITY);
+  EXPECT_EQ(quasirandom::normalQuantile(1.0), INFINITY);
+
+  for (double p = 1e-6; p < 1.0; p += 0.0123) {
+    const double x = quasirandom::normalQuantile(p);
+    EXPECT_NEAR(0.5 * std::erfc(-x / std::sqrt(2.0)), p, 1e-14);
+  }
+}
+
+TEST(StochasticVolatility_ScrambledSobol, NetProperty) {
+  //every elementary box of area 2^-m holds exactly one of the first 2^m points
+  const int m = 8;
+  ScrambledSobol sobol(42, 3);
+  std::vector<std::pair<std::uint32_t, std::uint32_t>> points;
+  for (std::uint32_t i = 0; i < (1u << m); ++i) {
+    points.push_back(sobol.point(i));
+  }
+
+  for (int a = 0; a <= m; ++a) {
+    const int b = m - a;
+    std::vector<int> counts(1u << m, 0);
+    for (const auto& point : points) {
+      const std::uint32_t row = a == 0 ? 0u : point.first >> (32 - a);
+      const std::uint32_t col = b == 0 ? 0u : point.second >> (32 - b);
+      counts[(row << b) | col]++;
+    }
+    EXPECT_TRUE(std::all_of(counts.begin(), counts.end(), [](const int& count) { return count == 1; })) << a;
+  }
+}
+
+TEST(StochasticVolatility_ScrambledSobol, Randomised) {
+  ScrambledSobol sobol(42, 3);
+  ScrambledSobol same(42, 3);
+  ScrambledSobol otherStep(42, 4);
+  ScrambledSobol otherSeed(43, 3);
+
+  EXPECT_EQ(sobol.point(17), same.point(17));
+  EXPECT_NE(sobol.point(17), otherStep.point(17));
+  EXPECT_NE(sobol.point(17), otherSeed.point(17));
+
+  //the digital shift moves the first point away from the origin, its mean over streams is 1/2
+  double mean = 0.0;
+  for (std::uint32_t step = 0; step < 2000; ++step) {
+    mean += quasirandom::toUnit(ScrambledSobol(7, step).point(0).first) / 2000.0;
+  }
+  EXPECT_NEAR(mean, 0.5, 0.03);
+}
+
+TEST(StochasticVolatility_QuasiRandom, StateOrderedNormals) {
+  Eigen::VectorXd states(6);
+  states << 0.3, -1.0, 2.5, 0.3, -4.0, 1.0;
+
+  std::vector<int> order;
+  quasirandom::stateOrder<double>(states, order);
+  EXPECT_EQ(order, (std::vector<int>{4, 1, 0, 3, 5, 2}));
+
+  Eigen::VectorXd normals(6);
+  StateOrderBuffers buffers;
+  quasirandom::stateOrderedNormals<double>(states, normals, 11, 2, buffers);
+
+  //the particle of rank k takes the point of rank k in the first coordinate
+  ScrambledSobol sobol(11, 2);
+  std::vector<std::pair<std::uint32_t, std::uint32_t>> points;
+  for (std::uint32_t i = 0; i < 6; ++i) {
+    points.push_back(sobol.point(i));
+  }
+  std::sort(points.begin(), points.end());
+  for (int k = 0; k < 6; ++k) {
+    EXPECT_DOUBLE_EQ(normals[order[k]], quasirandom::normalQuantile(quasirandom::toUnit(points[k].second)));
+  }
+
+  Eigen::VectorXf floatNormals(6);
+  quasirandom::stateOrderedNormals<float>(states.cast<float>(), floatNormals, 11, 2, buffers);
+  EXPECT_TRUE(floatNormals.isApprox(normals.cast<float>()));
+}
@@ -0,0 +1,116 @@
+#include <array>
+#include <vector>
+#include <cstdint>
+
+#include <Eigen/Dense>
+#include <EigenRand/EigenRand>
+
+#include "gtest/gtest.h"
+#include "statistics/random_engine.h"
+
+TEST(StochasticVolatility_ReseedableMersenneTwister, MatchesPacketEngine) {
+  Eigen::Rand::P8_mt19937_64 reference{123};
+  ReseedableMersenneTwister engine(123);
+
+  for (int i=0; i<1000; i++) {
+    EXPECT_EQ(engine(), reference());
+  }
+  for (int i=0; i<1000; i++) {
+    EXPECT_EQ(engine.uniform_real(), reference.uniform_real());
+  }
+}
+
+TEST(StochasticVolatility_ReseedableMersenneTwister, SeedRestartsStream) {
+  ReseedableMersenneTwister engine(1);
+  engine();
+  engine.uniform_real();
+  engine.seed(77);
+
+  ReseedableMersenneTwister reference(77);
+  Eigen::VectorXd expected;
+  reference.standardNormal(expected, 1001);
+  Eigen::VectorXd samples;
+  engine.standardNormal(samples, 1001);
+  EXPECT_TRUE(samples == expected);
+
+  engine.seed(77);
+  Eigen::VectorXd again;
+  engine.standardNormal(again, 1001);
+  EXPECT_TRUE(again == expected);
+}
+
+TEST(StochasticVolatility_PhiloxEngine, KnownAnswers) {
+  //Random123 known-answer vectors for philox4x32_10
+  std::array<std::uint32_t, 4> zeros = PhiloxEngine::block({0u, 0u}, {0u, 0u, 0u, 0u});
+  EXPECT_EQ(zeros, (std::array<std::uint32_t, 4>{0x6627e8d5u, 0xe169c58du, 0xbc57ac4cu, 0x9b00dbd8u}));
+
+  std::array<std::uint32_t, 4> ones = PhiloxEngine::block({0xffffffffu, 0xffffffffu},
+                                                          {0xffffffffu, 0xffffffffu, 0xffffffffu, 0xffffffffu});
+  EXPECT_EQ(ones, (std::array<std::uint32_t, 4>{0x408f276du, 0x41c83b0eu, 0xa20bc7c6u, 0x6d5451fdu}));
+
+  std::array<std::uint32_t, 4> pi = PhiloxEngine::block({0xa4093822u, 0x299f31d0u},
+                                                        {0x243f6a88u, 0x85a308d3u, 0x13198a2eu, 0x03707344u});
+  EXPECT_EQ(pi, (std::array<std::uint32_t, 4>{0xd16cfe09u, 0x94fdccebu, 0x5001e420u, 0x24126ea1u}));
+
+  PhiloxEngine engine(0);
+  EXPECT_EQ(engine(), 0xe169c58d6627e8d5ull);
+  EXPECT_EQ(engine(), 0x9b00dbd8bc57ac4cull);
+}
+
+TEST(StochasticVolatility_PhiloxEngine, JumpAhead) {
+  PhiloxEngine engine(42, 7, 3);
+  std::vector<std::uint64_t> words(101);
+  for (std::uint64_t& word : words) {
+    word = engine();
+  }
+  EXPECT_EQ(engine.getPosition(), 101u);
+
+  for (std::uint64_t k : {0u, 1u, 2u, 55u, 100u}) {
+    PhiloxEngine jumped(42, 7, 3);
+    jumped.discard(k);
+    EXPECT_EQ(jumped(), words[k]);
+  }
+
+  PhiloxEngine otherStep(42, 8, 3);
+  PhiloxEngine otherStream(42, 7, 4);
+  EXPECT_NE(otherStep(), words[0]);
+  EXPECT_NE(otherStream(), words[0]);
+}
+
+TEST(StochasticVolatility_PhiloxEngine, SplitNormalsMatch) {
+  PhiloxEngine engine(5, 1);
+  Eigen::VectorXd whole(1001);
+  engine.standardNormal(whole);
+
+  //pieces starting at odd and even positions, as pool threads would draw them
+  std::vector<Eigen::Index> bounds = {0, 1, 4, 77, 600, 1001};
+  Eigen::VectorXd pieces(1001);
+  for (std::size_t k=0; k+1<bounds.size(); k++) {
+    PhiloxEngine piece(5, 1);
+    piece.discard(bounds[k]);
+    piece.standardNormal(pieces.segment(bounds[k], bounds[k+1] - bounds[k]));
+  }
+  EXPECT_TRUE(pieces == whole);
+
+  PhiloxEngine single(5, 1);
+  Eigen::VectorXf floats(1001);
+  single.standardNormal(floats);
+  EXPECT_TRUE(floats == whole.cast<float>());
+
+  PhiloxEngine large(11);
+  Eigen::VectorXd samples(200000);
+  large.standardNormal(samples);
+  EXPECT_NEAR(samples.mean(), 0.0, 0.01);
+  EXPECT_NEAR(samples.squaredNorm() / samples.size(), 1.0, 0.01);
+}
+
+TEST(StochasticVolatility_PhiloxEngine, EigenRandEngine) {
+  static_assert(Eigen::Rand::IsScalarFullBitRandomEngine<PhiloxEngine>::value,
+                "PhiloxEngine must be usable as a scalar EigenRand engine");
+
+  PhiloxEngine engine(9);
+  Eigen::VectorXd uniforms = Eigen::Rand::uniformReal<Eigen::VectorXd>(10000, 1, engine);
+  EXPECT_GE(uniforms.minCoeff(), 0.0);
+  EXPECT_LT(uniforms.maxCoeff(), 1.0);
+  EXPECT_NEAR(uniforms.mean(), 0.5, 0.02);
+}
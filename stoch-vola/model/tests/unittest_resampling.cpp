@@ -0,0 +1,128 @@
+#include <vector>
+#include <random>
+#include <cmath>
+
+#include "gtest/gtest.h"
+#include "statistics/resampling.h"
+
+
+TEST(StochasticVolatility_Resampling, DegenerateWeights) {
+  Eigen::VectorXd weights(4);
+  weights << 0.0, 0.0, 2.0, 0.0;
+
+  std::vector<ResamplingScheme> schemes = {ResamplingScheme::Multinomial, ResamplingScheme::Stratified,
+                                           ResamplingScheme::Systematic, ResamplingScheme::Residual};
+
+  for (ResamplingScheme scheme : schemes) {
+    std::mt19937 generator(123);
+    Eigen::VectorXi ancestors = resampling::ancestorIndices(weights, scheme, generator);
+    EXPECT_EQ(ancestors.size(), 4);
+    for (int i=0; i<4; i++) {
+      EXPECT_EQ(ancestors(i), 2);
+    }
+  }
+}
+
+TEST(StochasticVolatility_Resampling, AncestorsAreSorted) {
+  Eigen::VectorXd weights = Eigen::VectorXd::LinSpaced(100, 0.0, 1.0);
+
+  std::vector<ResamplingScheme> schemes = {ResamplingScheme::Multinomial, ResamplingScheme::Stratified,
+                                           ResamplingScheme::Systematic};
+
+  for (ResamplingScheme scheme : schemes) {
+    std::mt19937 generator(123);
+    Eigen::VectorXi ancestors = resampling::ancestorIndices(weights, scheme, generator);
+    for (int i=1; i<100; i++) {
+      EXPECT_LE(ancestors(i-1), ancestors(i));
+    }
+    EXPECT_GT(ancestors(0), 0); //zero weight particle is never picked
+  }
+}
+
+TEST(StochasticVolatility_Resampling, SystematicOffspringCounts) {
+  Eigen::VectorXd weights(4);
+  weights << 1.0, 2.0, 3.0, 4.0;
+
+  std::mt19937 generator(123);
+  Eigen::VectorXi ancestors = resampling::ancestorIndices(weights, ResamplingScheme::Systematic, generator);
+
+  //systematic resampling never deviates more than one offspring from N*w_i
+  std::vector<int> counts(4, 0);
+  for (int i=0; i<4; i++) {
+    counts[ancestors(i)]++;
+  }
+  for (int i=0; i<4; i++) {
+    EXPECT_LE(std::abs(counts[i] - 4.0 * weights(i) / 10.0), 1.0);
+  }
+}
+
+TEST(StochasticVolatility_Resampling, ResidualDeterministicCopies) {
+  Eigen::VectorXd weights(4);
+  weights << 0.5, 0.25, 0.25, 0.0;
+
+  std::mt19937 generator(123);
+  Eigen::VectorXi ancestors = resampling::ancestorIndices(weights, ResamplingScheme::Residual, generator);
+
+  EXPECT_EQ(ancestors(0), 0);
+  EXPECT_EQ(ancestors(1), 0);
+  EXPECT_EQ(ancestors(2), 1);
+  EXPECT_EQ(ancestors(3), 2);
+}
+
+TEST(StochasticVolatility_Resampling, MultinomialMatchesWeights) {
+  Eigen::VectorXd weights(3);
+  weights << 0.2, 0.3, 0.5;
+
+  std::mt19937 generator(123);
+
+  Eigen::VectorXd counts = Eigen::VectorXd::Zero(3);
+  const int draws = 2000;
+  for (int rep=0; rep<draws; rep++) {
+    Eigen::VectorXi ancestors = resampling::ancestorIndices(weights, ResamplingScheme::Multinomial, generator);
+    for (int i=0; i<3; i++) {
+      counts(ancestors(i)) += 1.0;
+    }
+  }
+  counts /= 3.0 * draws;
+
+  for (int i=0; i<3; i++) {
+    EXPECT_NEAR(counts(i), weights(i), 0.02);
+  }
+}
+
+TEST(StochasticVolatility_Resampling, InvalidWeights) {
+  Eigen::VectorXd weights = Eigen::VectorXd::Zero(3);
+  std::mt19937 generator(123);
+  EXPECT_THROW(resampling::ancestorIndices(weights, ResamplingScheme::Systematic, generator), std::invalid_argument);
+}
+
+TEST(StochasticVolatility_Resampling, ParallelMatchesDistribution) {
+  Eigen::VectorXd weights = Eigen::VectorXd::LinSpaced(1000, 0.0, 1.0);
+  ThreadPool pool(4);
+
+  std::vector<ResamplingScheme> schemes = {ResamplingScheme::Multinomial, ResamplingScheme::Stratified,
+                                           ResamplingScheme::Systematic, ResamplingScheme::Residual};
+
+  for (ResamplingScheme scheme : schemes) {
+    Eigen::VectorXi ancestors = resampling::ancestorIndices(weights, scheme, 123, pool);
+    Eigen::VectorXi repeated = resampling::ancestorIndices(weights, scheme, 123, pool);
+    EXPECT_TRUE(ancestors == repeated);
+
+    //ancestor mean under weights proportional to i is (2N-1)/3
+    double mean = ancestors.cast<double>().mean();
+    EXPECT_NEAR(mean, 666.0, 25.0) << "scheme " << static_cast<int>(scheme);
+    EXPECT_GT(ancestors.minCoeff(), 0);
+  }
+}
+
+TEST(StochasticVolatility_Resampling, ParallelSystematicMatchesSerial) {
+  Eigen::VectorXd weights = Eigen::VectorXd::LinSpaced(101, 1.0, 3.0);
+  ThreadPool pool(3);
+
+  std::mt19937 generator(42);
+  Eigen::VectorXi serial = resampling::ancestorIndices(weights, ResamplingScheme::Systematic, generator);
+  Eigen::VectorXi parallel = resampling::ancestorIndices(weights, ResamplingScheme::Systematic, 42, pool);
+
+  int mismatches = (serial.array() != parallel.array()).count();
+  EXPECT_LE(mismatches, 1); //only rounding of the cumulative sums may differ
+}
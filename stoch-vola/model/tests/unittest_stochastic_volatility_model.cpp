@@ -1,9 +1,14 @@
 #include <vector>
 #include <cmath>
+#include <limits>
+#include <memory>
+#include <string>
+#include <fstream>
 
 #include "gtest/gtest.h"
 
 #include "model/stochastic_volatility_model.h"
+#include "statistics/mapped_file.h"
 #include "statistics/normal_distribution.h"
 #include "statistics/particles.h"
 
@@ -17,6 +22,22 @@ TEST(StochasticVolatility_StochasticVolatilityModel, ParticleFilter) {
   EXPECT_EQ(p.getParticleLength(), 3);
 }
 
+TEST(StochasticVolatility_StochasticVolatilityModel, ParticleLayouts) {
+  Eigen::VectorXd y(6);
+  y << 1.0 , -2.0, 0.5, 0.3, -0.1, 1.5;
+
+  StochasticVolatilityModel svm(0.1, 0.5, -0.5);
+  FilterOptions traceMajor;
+  traceMajor.particleLayout = ParticleLayout::TraceMajor;
+  FilterOptions timeMajor;
+  timeMajor.particleLayout = ParticleLayout::TimeMajor;
+
+  Particles first = svm.particleFilter(y, 50, 123, traceMajor);
+  Particles second = svm.particleFilter(y, 50, 123, timeMajor);
+  EXPECT_TRUE(first.getParticlesAsEigenMatrix() == second.getParticlesAsEigenMatrix());
+  EXPECT_EQ(svm.logLikelihood(y, 50, 123, traceMajor), svm.logLikelihood(y, 50, 123, timeMajor));
+}
+
 TEST(StochasticVolatility_StochasticVolatilityModel, LogLikelihood) {
   Eigen::VectorXd y(3);
   y << 1.0 , 2.0, 3.0;
@@ -25,3 +46,367 @@ TEST(StochasticVolatility_StochasticVolatilityModel, LogLikelihood) {
   double logLikelihood = svm.logLikelihood(y, 10, 123);
   EXPECT_TRUE(std::isfinite(logLikelihood));
 }
+
+TEST(StochasticVolatility_StochasticVolatilityModel, ParallelLogLikelihood) {
+  Eigen::VectorXd y(20);
+  for (int t=0; t<20; t++) {
+    y(t) = std::sin(t) * 0.5;
+  }
+
+  StochasticVolatilityModel svm(0.0, 0.5, -1.0);
+  FilterOptions options;
+  options.threadCount = 4;
+
+  double first = svm.logLikelihood(y, 1000, 123, options);
+  double second = svm.logLikelihood(y, 1000, 123, options);
+  double serial = svm.logLikelihood(y, 1000, 123);
+
+  EXPECT_EQ(first, second);
+  EXPECT_TRUE(std::isfinite(first));
+  EXPECT_NEAR(first, serial, 0.1);
+
+  Particles p = svm.particleFilter(y, 1000, 123, options);
+  EXPECT_EQ(p.getParticleCount(), 1000);
+  EXPECT_EQ(p.getParticleLength(), 20);
+}
+
+TEST(StochasticVolatility_StochasticVolatilityModel, BatchLogLikelihood) {
+  Eigen::VectorXd y(10);
+  y << 1.0, -2.0, 0.5, 0.1, -0.3, 1.5, 0.2, -0.1, 0.4, -1.0;
+
+  Eigen::MatrixXd parameters(3, 3);
+  parameters << 0.0, 0.0, 0.0,
+                0.5, 0.8, -1.0,
+               -0.2, -0.3, 0.5;
+
+  Eigen::VectorXd batch = StochasticVolatilityModel::batchLogLikelihood(parameters, y, 200, 123);
+  EXPECT_EQ(batch.size(), 3);
+
+  for (int k=0; k<3; k++) {
+    StochasticVolatilityModel svm(parameters(k, 0), parameters(k, 1), parameters(k, 2));
+    EXPECT_NEAR(batch(k), svm.logLikelihood(y, 200, 123), 1e-9);
+  }
+
+  FilterOptions options;
+  options.threadCount = 2;
+  Eigen::VectorXd parallel = StochasticVolatilityModel::batchLogLikelihood(parameters, y, 200, 123, options);
+  EXPECT_TRUE(parallel.isApprox(batch));
+
+  EXPECT_THROW(StochasticVolatilityModel::batchLogLikelihood(parameters, y, 0, 123), std::invalid_argument);
+
+  //settings the batch does not implement are rejected rather than ignored
+  FilterOptions single, auxiliary, philox;
+  single.precision = FilterPrecision::Single;
+  auxiliary.proposal = FilterProposal::Auxiliary;
+  philox.randomEngine = RandomEngine::Philox;
+  for (const FilterOptions& unsupported : {single, auxiliary, philox}) {
+    EXPECT_THROW(StochasticVolatilityModel::batchLogLikelihood(parameters, y, 200, 123, unsupported), std::invalid_argument);
+  }
+}
+
+TEST(StochasticVolatility_StochasticVolatilityModel, LogDomainWeights) {
+  Eigen::VectorXd y(4);
+  y << 0.1, 100.0, -80.0, 0.2; //every raw likelihood underflows on the crash days
+
+  StochasticVolatilityModel svm(0.0, 0.9, -1.0);
+  double logLikelihood = svm.logLikelihood(y, 100, 123);
+  EXPECT_TRUE(std::isfinite(logLikelihood));
+
+  //the log-variance has to jump to explain the crash
+  Eigen::VectorXd calm(4);
+  calm << 0.1, 0.1, -0.1, 0.2;
+
+  auto mean = [](const Eigen::VectorXd& vec) {
+    return vec.mean();
+  };
+  Eigen::VectorXd crashMeans = svm.particleFilter(y, 100, 123).reduceParticles(mean);
+  Eigen::VectorXd calmMeans = svm.particleFilter(calm, 100, 123).reduceParticles(mean);
+
+  EXPECT_TRUE(crashMeans.allFinite());
+  EXPECT_GT(crashMeans(1), calmMeans(1) + 1.0);
+}
+
+TEST(StochasticVolatility_StochasticVolatilityModel, EssThreshold) {
+  Eigen::VectorXd y(30);
+  for (int t=0; t<30; t++) {
+    y(t) = std::cos(t) * 0.3;
+  }
+
+  StochasticVolatilityModel svm(0.0, 0.5, -1.0);
+  FilterOptions always;
+  always.essThreshold = 2.0;
+  FilterOptions never;
+  never.essThreshold = 0.0;
+
+  double adaptive = svm.logLikelihood(y, 2000, 123);
+  EXPECT_NEAR(adaptive, svm.logLikelihood(y, 2000, 123, always), 0.05);
+  EXPECT_NEAR(adaptive, svm.logLikelihood(y, 2000, 123, never), 0.05);
+}
+
+TEST(StochasticVolatility_StochasticVolatilityModel, ParticleSmoother) {
+  Eigen::VectorXd y(12);
+  y << 0.1, -0.3, 0.2, 2.5, -3.0, 2.8, 0.1, -0.2, 0.05, 0.1, -0.1, 0.2;
+
+  StochasticVolatilityModel svm(0.0, 1.5, -1.0);
+  Particles smoothed = svm.particleSmoother(y, 200, 50, 123);
+  EXPECT_EQ(smoothed.getParticleCount(), 50);
+  EXPECT_EQ(smoothed.getParticleLength(), 12);
+  EXPECT_TRUE(smoothed.getParticlesAsEigenMatrix().allFinite());
+
+  FilterOptions options;
+  options.threadCount = 3;
+  Particles parallel = svm.particleSmoother(y, 200, 50, 123, options);
+  EXPECT_TRUE(parallel == svm.particleSmoother(y, 200, 50, 123, options));
+  EXPECT_EQ(parallel.getParticleCount(), 50);
+
+  //the large returns in the middle must show up as higher smoothed log-variance than the calm end
+  Eigen::VectorXd means = smoothed.reduceParticles([](const Eigen::VectorXd& v) {return v.mean();});
+  EXPECT_GT(means.segment(3, 3).mean(), means.tail(3).mean());
+
+  EXPECT_THROW(svm.particleSmoother(y, 0, 10), std::invalid_argument);
+  EXPECT_THROW(svm.particleSmoother(Eigen::VectorXd(), 10, 10), std::invalid_argument);
+}
+
+TEST(StochasticVolatility_StochasticVolatilityModel, AuxiliaryFilter) {
+  Eigen::VectorXd y(10);
+  y << 0.1, -0.3, 0.2, 2.5, -3.0, 2.8, 0.1, -0.2, 0.05, 0.1;
+
+  StochasticVolatilityModel svm(0.0, 1.5, -1.0);
+  FilterOptions auxiliary;
+  auxiliary.proposal = FilterProposal::Auxiliary;
+
+  Particles p = svm.particleFilter(y, 50, 123, auxiliary);
+  EXPECT_EQ(p.getParticleCount(), 50);
+  EXPECT_EQ(p.getParticleLength(), 10);
+  EXPECT_TRUE(p.getParticlesAsEigenMatrix().allFinite());
+
+  //both filters estimate the same likelihood, the auxiliary one with a fraction of the spread
+  const int runs = 40;
+  Eigen::VectorXd bootstrapEstimates(runs), auxiliaryEstimates(runs);
+  for (int r=0; r<runs; r++) {
+    bootstrapEstimates[r] = svm.logMarginalLikelihood(y, 100, 1000 + r);
+    auxiliaryEstimates[r] = svm.logMarginalLikelihood(y, 100, 1000 + r, auxiliary);
+  }
+  auto variance = [](const Eigen::VectorXd& v) {return (v.array() - v.mean()).square().mean();};
+
+  EXPECT_NEAR(auxiliaryEstimates.mean(), bootstrapEstimates.mean(), 3.0 * std::sqrt(variance(bootstrapEstimates)));
+  EXPECT_LT(variance(auxiliaryEstimates), variance(bootstrapEstimates));
+  EXPECT_NEAR(svm.logLikelihood(y, 100, 123, auxiliary), svm.logLikelihood(y, 2000, 123), 0.1);
+
+  FilterOptions parallel = auxiliary;
+  parallel.threadCount = 3;
+  EXPECT_EQ(svm.logLikelihood(y, 100, 123, parallel), svm.logLikelihood(y, 100, 123, parallel));
+}
+
+TEST(StochasticVolatility_StochasticVolatilityModel, BatchFilter) {
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  Eigen::MatrixXd y(4, 6);
+  y << 1.0 , 2.0, 3.0, -0.5, 0.1, 0.4,
+       0.2, -0.1, nan, 0.3, nan, nan, //missing step, then shorter
+       nan, nan, nan, nan, nan, nan,
+       2.5, -3.0, 0.1, 0.2, -0.4, 0.0;
+  Eigen::MatrixXd parameters(4, 3);
+  parameters << 0.1, 0.5, -0.5,
+                0.0, 1.0, -1.0,
+                0.0, 0.0, 0.0,
+               -1.0, 2.0, -1.5;
+
+  BatchFilterResult result = StochasticVolatilityModel::batchFilter(parameters, y, 100, 123);
+  EXPECT_EQ(result.filteredMeans.rows(), 4);
+  EXPECT_EQ(result.filteredMeans.cols(), 6);
+  EXPECT_EQ(result.observationCounts[0], 6);
+  EXPECT_EQ(result.observationCounts[1], 3);
+  EXPECT_EQ(result.observationCounts[2], 0);
+  EXPECT_TRUE(std::isnan(result.logLikelihoods[2]));
+  EXPECT_EQ(result.logMarginalLikelihoods[2], 0.0);
+  EXPECT_TRUE(result.filteredMeans.allFinite());
+  EXPECT_TRUE((result.filteredStdDevs.array() >= 0.0).all());
+
+  for (int a : {0, 3}) {
+    StochasticVolatilityModel svm(parameters(a, 0), parameters(a, 1), parameters(a, 2));
+    const unsigned int assetSeed = static_cast<unsigned int>(ThreadPool::blockSeed(123, a));
+    Eigen::VectorXd series = y.row(a).transpose();
+    EXPECT_NEAR(result.logLikelihoods[a], svm.logLikelihood(series, 100, assetSeed), 1e-9);
+    EXPECT_NEAR(result.logMarginalLikelihoods[a], svm.logMarginalLikelihood(series, 100, assetSeed), 1e-9);
+  }
+
+  FilterOptions options;
+  options.threadCount = 3;
+  BatchFilterResult parallel = StochasticVolatilityModel::batchFilter(parameters, y, 100, 123, options);
+  EXPECT_TRUE(parallel.filteredMeans == result.filteredMeans);
+  EXPECT_TRUE(parallel.logMarginalLikelihoods == result.logMarginalLikelihoods);
+
+  EXPECT_THROW(StochasticVolatilityModel::batchFilter(parameters.topRows(3), y, 100), std::invalid_argument);
+}
+
+TEST(StochasticVolatility_StochasticVolatilityModel, SinglePrecision) {
+  Eigen::VectorXd y(10);
+  y << 1.0 , 2.0, 3.0, -0.5, 0.1, 0.4, -1.2, 0.3, 0.0, 0.8;
+
+  StochasticVolatilityModel svm(0.1, 0.5, -0.5);
+  FilterOptions single;
+  single.precision = FilterPrecision::Single;
+
+  Particles p = svm.particleFilter(y, 50, 123, single);
+  EXPECT_EQ(p.getParticleCount(), 50);
+  EXPECT_EQ(p.getParticleLength(), 10);
+  EXPECT_TRUE(p.getParticlesAsEigenMatrix().allFinite());
+
+  //float draws differ from the double ones, so only the estimates agree
+  EXPECT_NEAR(svm.logLikelihood(y, 5000, 123, single), svm.logLikelihood(y, 5000, 123), 0.02);
+  EXPECT_NEAR(svm.logMarginalLikelihood(y, 5000, 123, single), svm.logMarginalLikelihood(y, 5000, 123), 0.2);
+  EXPECT_EQ(svm.logLikelihood(y, 100, 7, single), svm.logLikelihood(y, 100, 7, single));
+
+  FilterOptions parallel = single;
+  parallel.threadCount = 3;
+  parallel.proposal = FilterProposal::Auxiliary;
+  FilterOptions auxiliary;
+  auxiliary.proposal = FilterProposal::Auxiliary;
+  EXPECT_NEAR(svm.logLikelihood(y, 5000, 123, parallel), svm.logLikelihood(y, 5000, 123, auxiliary), 0.02);
+}
+
+TEST(StochasticVolatility_StochasticVolatilityModel, PhiloxThreadCountInvariant) {
+  Eigen::VectorXd y(15);
+  for (int t=0; t<15; t++) {
+    y(t) = std::cos(t) * 0.7;
+  }
+
+  StochasticVolatilityModel svm(0.1, 0.5, -0.5);
+  FilterOptions serial;
+  serial.randomEngine = RandomEngine::Philox;
+
+  //2500 particles: a partial chunk at the end and chunks shared unevenly between the threads
+  for (ResamplingScheme scheme : {ResamplingScheme::Systematic, ResamplingScheme::Multinomial, ResamplingScheme::Residual}) {
+    serial.resamplingScheme = scheme;
+    const double expected = svm.logLikelihood(y, 2500, 123, serial);
+    const double expectedMarginal = svm.logMarginalLikelihood(y, 2500, 123, serial);
+    const Eigen::MatrixXd expectedClouds = svm.particleFilter(y, 2500, 123, serial).getParticlesAsEigenMatrix();
+
+    for (unsigned int threads : {2u, 3u, 4u}) {
+      FilterOptions parallel = serial;
+      parallel.threadCount = threads;
+      EXPECT_EQ(svm.logLikelihood(y, 2500, 123, parallel), expected);
+      EXPECT_EQ(svm.logMarginalLikelihood(y, 2500, 123, parallel), expectedMarginal);
+      EXPECT_TRUE(svm.particleFilter(y, 2500, 123, parallel).getParticlesAsEigenMatrix() == expectedClouds);
+    }
+  }
+
+  FilterOptions single = serial;
+  single.precision = FilterPrecision::Single;
+  FilterOptions singleParallel = single;
+  singleParallel.threadCount = 3;
+  EXPECT_EQ(svm.logLikelihood(y, 2500, 7, single), svm.logLikelihood(y, 2500, 7, singleParallel));
+
+  //an independent stream, so the estimate only agrees with the Mersenne Twister one
+  EXPECT_NE(svm.logLikelihood(y, 2500, 123, serial), svm.logLikelihood(y, 2500, 123));
+  EXPECT_NEAR(svm.logLikelihood(y, 2500, 123, serial), svm.logLikelihood(y, 2500, 123), 0.05);
+  EXPECT_NE(svm.logLikelihood(y, 2500, 123, serial), svm.logLikelihood(y, 2500, 124, serial));
+}
+
+TEST(StochasticVolatility_StochasticVolatilityModel, SobolLowersVariance) {
+  Eigen::VectorXd y(20);
+  for (int t=0; t<20; t++) {
+    y(t) = std::cos(t) * 0.7;
+  }
+
+  StochasticVolatilityModel svm(0.1, 0.5, -0.5);
+  FilterOptions sobol;
+  sobol.randomEngine = RandomEngine::Sobol;
+  sobol.essThreshold = 2.0; //resampling every step, sorted by state
+
+  //steps and resampling stay serial, so the pool changes nothing
+  FilterOptions parallel = sobol;
+  parallel.threadCount = 3;
+  EXPECT_EQ(svm.logMarginalLikelihood(y, 512, 123, sobol), svm.logMarginalLikelihood(y, 512, 123, parallel));
+  EXPECT_TRUE(svm.particleFilter(y, 512, 123, sobol).getParticlesAsEigenMatrix()
+              == svm.particleFilter(y, 512, 123, parallel).getParticlesAsEigenMatrix());
+  EXPECT_NE(svm.logMarginalLikelihood(y, 512, 123, sobol), svm.logMarginalLikelihood(y, 512, 124, sobol));
+
+  FilterOptions monteCarlo;
+  monteCarlo.essThreshold = 2.0;
+  const int runs = 40;
+  Eigen::VectorXd quasi(runs), plain(runs);
+  for (int i = 0; i < runs; ++i) {
+    quasi[i] = svm.logMarginalLikelihood(y, 512, 1000 + i, sobol);
+    plain[i] = svm.logMarginalLikelihood(y, 512, 1000 + i, monteCarlo);
+  }
+  EXPECT_TRUE(quasi.allFinite());
+  EXPECT_NEAR(quasi.mean(), plain.mean(), 0.05);
+  const double quasiVariance = (quasi.array() - quasi.mean()).square().mean();
+  const double plainVariance = (plain.array() - plain.mean()).square().mean();
+  EXPECT_LT(quasiVariance, 0.5 * plainVariance);
+}
+
+TEST(StochasticVolatility_StochasticVolatilityModel, StridedObservations) {
+  //every other entry of a larger buffer, as a sliced NumPy array arrives through the bindings
+  Eigen::VectorXd buffer(20);
+  for (int t=0; t<20; t++) {
+    buffer(t) = std::sin(0.3 * t);
+  }
+  Eigen::Map<const Eigen::VectorXd, 0, Eigen::InnerStride<>> strided(buffer.data(), 10, Eigen::InnerStride<>(2));
+  Eigen::VectorXd y = strided;
+
+  StochasticVolatilityModel svm(0.1, 0.5, -0.5);
+  EXPECT_EQ(svm.logLikelihood(strided, 200, 123), svm.logLikelihood(y, 200, 123));
+  EXPECT_EQ(svm.logMarginalLikelihood(strided, 200, 123), svm.logMarginalLikelihood(y, 200, 123));
+  EXPECT_TRUE(svm.particleFilter(strided, 200, 123).getParticlesAsEigenMatrix()
+              == svm.particleFilter(y, 200, 123).getParticlesAsEigenMatrix());
+
+  //both directions of a row-major panel
+  Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> panel(2, 10);
+  panel.row(0) = y.transpose();
+  panel.row(1) = y.reverse().transpose();
+  Eigen::MatrixXd parameters(2, 3);
+  parameters << 0.1, 0.5, -0.5,
+                0.0, 0.3, -1.0;
+  BatchFilterResult fromRowMajor = StochasticVolatilityModel::batchFilter(parameters, panel, 200, 123);
+  BatchFilterResult fromColumnMajor = StochasticVolatilityModel::batchFilter(parameters, Eigen::MatrixXd(panel), 200, 123);
+  EXPECT_TRUE(fromRowMajor.logLikelihoods == fromColumnMajor.logLikelihoods);
+
+  ParticlesT<float> single = svm.particleFilterSingle(y, 200, 123);
+  EXPECT_EQ(single.getParticleLength(), 10);
+  EXPECT_EQ(single.getParticleCount(), 200);
+}
+
+TEST(StochasticVolatility_StochasticVolatilityModel, StatisticsCompiledOut) {
+  //this target is built without SV_FILTER_INSTRUMENTATION, attached statistics stay untouched
+  Eigen::VectorXd y = Eigen::VectorXd::LinSpaced(20, -1.0, 1.0);
+  StochasticVolatilityModel svm(0.1, 0.5, -0.5);
+  FilterOptions options;
+  options.statistics = std::make_shared<FilterStatistics>();
+
+  EXPECT_FALSE(FilterStatistics::isEnabled());
+  EXPECT_EQ(svm.logLikelihood(y, 100, 123, options), svm.logLikelihood(y, 100, 123));
+  EXPECT_EQ(options.statistics->stepCount, 0);
+  EXPECT_TRUE(options.statistics->effectiveSampleSizes.empty());
+}
+
+TEST(StochasticVolatility_StochasticVolatilityModel, StorageFile) {
+  Eigen::VectorXd y(40);
+  for (int i = 0; i < 40; i++) {
+    y[i] = 0.5 * std::sin(0.7 * i);
+  }
+  const std::string seriesPath = testing::TempDir() + "model_series.bin";
+  std::ofstream(seriesPath, std::ios::binary).write(reinterpret_cast<const char*>(y.data()), sizeof(double) * y.size());
+
+  StochasticVolatilityModel svm(0.1, 0.5, -0.5);
+  MappedSeries series(seriesPath);
+  EXPECT_EQ(svm.logLikelihood(series.getSeries(), 200, 3), svm.logLikelihood(y, 200, 3));
+
+  for (ParticleLayout layout : {ParticleLayout::TraceMajor, ParticleLayout::TimeMajor}) {
+    FilterOptions inMemory;
+    inMemory.particleLayout = layout;
+    FilterOptions inFile = inMemory;
+    inFile.storageFile = testing::TempDir() + "model_trajectories.traj";
+
+    Particles expected = svm.particleFilter(y, 100, 7, inMemory);
+    Particles stored = svm.particleFilter(y, 100, 7, inFile);
+    EXPECT_EQ(stored.getStorageFile(), inFile.storageFile);
+    EXPECT_TRUE(stored.getParticlesAsEigenMatrix() == expected.getParticlesAsEigenMatrix());
+
+    TrajectoryFileHeader header = trajectoryfile::readHeader(inFile.storageFile);
+    EXPECT_EQ(header.particleLength, 40u);
+    EXPECT_EQ(header.particleCount, 100u);
+    EXPECT_EQ(header.pathStorage, 0u);
+  }
+}
@@ -0,0 +1,123 @@
+#include <vector>
+#include <cmath>
+#include <string>
+#include <fstream>
+#include <stdexcept>
+
+#include "gtest/gtest.h"
+
+#include "model/stochastic_volatility_model.h"
+#include "model/sv_filter_state.h"
+
+TEST(StochasticVolatility_SVFilterState, Constructor) {
+  StochasticVolatilityModel svm(0.0, 0.0, 0.0);
+  SVFilterState state(svm, 10, 123);
+  EXPECT_EQ(state.getParticleCount(), 10);
+  EXPECT_EQ(state.getStepCount(), 0);
+  EXPECT_EQ(state.getParticles().size(), 10);
+}
+
+TEST(StochasticVolatility_SVFilterState, MatchesLogLikelihood) {
+  Eigen::VectorXd y(5);
+  y << 1.0 , 2.0, 3.0, -0.5, 0.1;
+
+  StochasticVolatilityModel svm(0.1, 0.5, -0.5);
+  SVFilterState state(svm, 50, 123);
+  for (int t=0; t<5; t++) {
+    state.step(y(t));
+  }
+
+  EXPECT_EQ(state.getStepCount(), 5);
+  EXPECT_DOUBLE_EQ(state.getLogLikelihood(), svm.logLikelihood(y, 50, 123));
+
+  FilterOptions philox;
+  philox.randomEngine = RandomEngine::Philox;
+  SVFilterState counterBased(svm, 50, 123, philox);
+  for (int t=0; t<5; t++) {
+    counterBased.step(y(t));
+  }
+  EXPECT_DOUBLE_EQ(counterBased.getLogLikelihood(), svm.logLikelihood(y, 50, 123, philox));
+}
+
+TEST(StochasticVolatility_SVFilterState, MatchesParticleFilter) {
+  Eigen::VectorXd y(4);
+  y << 1.0 , -2.0, 0.5, 0.3;
+
+  StochasticVolatilityModel svm(0.0, 0.3, 0.0);
+  FilterOptions options;
+  options.essThreshold = 2.0; //resample at every step, the batch filter always returns a resampled cloud
+  SVFilterState state(svm, 20, 7, options);
+  for (int t=0; t<4; t++) {
+    state.step(y(t));
+  }
+
+  Particles p = svm.particleFilter(y, 20, 7, options);
+  Eigen::VectorXd latest = p.getParticlesAsEigenMatrix().row(3);
+  EXPECT_TRUE(latest.isApprox(state.getParticles()));
+}
+
+TEST(StochasticVolatility_SVFilterState, FilteredSummaries) {
+  StochasticVolatilityModel svm(0.0, 0.0, 0.0);
+  SVFilterState state(svm, 100, 123);
+  state.step(0.5);
+
+  double lower = state.getFilteredQuantile(0.05);
+  double median = state.getFilteredQuantile(0.5);
+  double upper = state.getFilteredQuantile(0.95);
+
+  EXPECT_LE(lower, median);
+  EXPECT_LE(median, upper);
+  EXPECT_TRUE(std::isfinite(state.getFilteredMean()));
+  EXPECT_TRUE(std::isfinite(state.getLogLikelihood()));
+}
+
+TEST(StochasticVolatility_SVFilterState, AdaptiveResampling) {
+  StochasticVolatilityModel svm(0.0, 0.0, 0.0);
+  SVFilterState state(svm, 100, 123);
+
+  //an uninformative observation keeps the cloud close to equally weighted
+  state.step(0.0);
+  EXPECT_GT(state.getEffectiveSampleSize(), 50.0);
+  EXPECT_NEAR(state.getWeights().sum(), 1.0, 1e-12);
+  EXPECT_FALSE(state.getWeights().isApprox(Eigen::VectorXd::Constant(100, 0.01)));
+
+  //an extreme return collapses the weights and triggers resampling instead of underflowing
+  state.step(50.0);
+  EXPECT_TRUE(state.getWeights().isApprox(Eigen::VectorXd::Constant(100, 0.01)));
+  EXPECT_TRUE(std::isfinite(state.getLogLikelihood()));
+  EXPECT_TRUE(std::isfinite(state.getFilteredMean()));
+}
+
+TEST(StochasticVolatility_SVFilterState, CheckpointResumesBitExactly) {
+  StochasticVolatilityModel svm(0.1, 0.5, -0.5);
+  const std::string path = testing::TempDir() + "filter_state.ckpt";
+
+  for (RandomEngine engine : {RandomEngine::MersenneTwister, RandomEngine::Philox}) {
+    FilterOptions options;
+    options.randomEngine = engine;
+    options.resamplingScheme = ResamplingScheme::Stratified;
+    options.essThreshold = 0.7;
+    SVFilterState state(svm, 300, 11, options);
+    for (int t = 0; t < 60; t++) {
+      state.step(0.4 * std::cos(0.3 * t));
+    }
+
+    state.save(path);
+    SVFilterState resumed = SVFilterState::load(path);
+    EXPECT_EQ(resumed.getStepCount(), 60);
+    EXPECT_TRUE(resumed.getParticles() == state.getParticles());
+
+    //the restart carries on exactly as the uninterrupted filter
+    for (int t = 60; t < 120; t++) {
+      state.step(0.4 * std::cos(0.3 * t));
+      resumed.step(0.4 * std::cos(0.3 * t));
+    }
+    EXPECT_EQ(resumed.getLogLikelihood(), state.getLogLikelihood());
+    EXPECT_EQ(resumed.getEffectiveSampleSize(), state.getEffectiveSampleSize());
+    EXPECT_TRUE(resumed.getParticles() == state.getParticles());
+    EXPECT_TRUE(resumed.getWeights() == state.getWeights());
+  }
+
+  std::ofstream(path, std::ios::binary) << "not a checkpoint";
+  EXPECT_THROW(SVFilterState::load(path), std::invalid_argument);
+}
@@ -0,0 +1,46 @@
+#include <vector>
+#include <stdexcept>
+
+#include "gtest/gtest.h"
+#include "statistics/thread_pool.h"
+
+TEST(StochasticVolatility_ThreadPool, RunsEveryBlock) {
+  ThreadPool pool(4);
+  EXPECT_EQ(pool.getThreadCount(), 4);
+
+  std::vector<int> visited(4, 0);
+  for (int rep=0; rep<100; rep++) {
+    pool.run([&](unsigned int block) {
+      visited[block]++;
+    });
+  }
+
+  for (int i=0; i<4; i++) {
+    EXPECT_EQ(visited[i], 100);
+  }
+}
+
+TEST(StochasticVolatility_ThreadPool, BlockBegin) {
+  EXPECT_EQ(ThreadPool::blockBegin(10, 3, 0), 0);
+  EXPECT_EQ(ThreadPool::blockBegin(10, 3, 1), 3);
+  EXPECT_EQ(ThreadPool::blockBegin(10, 3, 2), 6);
+  EXPECT_EQ(ThreadPool::blockBegin(10, 3, 3), 10);
+  EXPECT_EQ(ThreadPool::blockSeed(123, 0), 123);
+  EXPECT_NE(ThreadPool::blockSeed(123, 1), ThreadPool::blockSeed(124, 1));
+}
+
+TEST(StochasticVolatility_ThreadPool, PropagatesExceptions) {
+  ThreadPool pool(3);
+  EXPECT_THROW(pool.run([](unsigned int block) {
+    if (block == 2) {
+      throw std::runtime_error("failure in worker");
+    }
+  }), std::runtime_error);
+
+  //pool stays usable afterwards
+  std::vector<int> visited(3, 0);
+  pool.run([&](unsigned int block) {
+    visited[block] = 1;
+  });
+  EXPECT_EQ(visited[2], 1);
+}
@@ -1,4 +1,10 @@
+#include <cmath>
 #include <vector>
+#include <numeric>
+#include <algorithm>
+#include <stdexcept>
+
+#include <Eigen/Dense>
 
 #include "gtest/gtest.h"
 #include "statistics/util_funs.h"
@@ -38,3 +44,119 @@ TEST(StochasticVolatility_utilfunsTest, Quantile) {
     EXPECT_DOUBLE_EQ(utilfuns::quantile(data, 0.5), 25.0);
     EXPECT_DOUBLE_EQ(utilfuns::quantile(data, 1.0), 40.0);
 }
+
+namespace {
+    //the weighted quantile by a full sort and a scan of the cumulative weights
+    double sortedWeightedQuantile(const Eigen::VectorXd& data, const Eigen::VectorXd& weights, const double& q) {
+        std::vector<int> order(data.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&](int a, int b) { return data[a] < data[b]; });
+        const double target = q * weights.sum();
+        double cumulative = 0.0;
+        for (int i : order) {
+            cumulative += weights[i];
+            if (cumulative >= target) {
+                return data[i];
+            }
+        }
+        return data[order.back()];
+    }
+
+    const std::vector<double> bands = {0.95, 0.05, 0.5, 0.0, 1.0, 0.5, 0.3333};
+}
+
+TEST(StochasticVolatility_utilfunsTest, Quantiles) {
+    for (long n : {1L, 2L, 7L, 100L, 1001L}) {
+        Eigen::VectorXd data = Eigen::VectorXd::Random(n);
+        data.head(n / 2) = data.tail(n / 2); //ties
+        std::vector<double> values(data.data(), data.data() + n);
+
+        Eigen::VectorXd quantiles = utilfuns::quantiles(data, bands);
+        ASSERT_EQ(quantiles.size(), 7);
+        for (size_t k = 0; k < bands.size(); ++k) {
+            EXPECT_EQ(quantiles[k], utilfuns::quantile(values, bands[k]));
+        }
+    }
+
+    EXPECT_THROW(utilfuns::quantiles(Eigen::VectorXd::Zero(3), {0.5, -0.1}), std::invalid_argument);
+    EXPECT_THROW(utilfuns::quantiles(Eigen::VectorXd(), {0.5}), std::invalid_argument);
+}
+
+TEST(StochasticVolatility_utilfunsTest, WeightedQuantiles) {
+    for (long n : {1L, 5L, 33L, 1000L, 20000L}) {
+        Eigen::VectorXd data = Eigen::VectorXd::Random(n);
+        data.head(n / 3) = data.tail(n / 3); //ties
+        Eigen::VectorXd weights = Eigen::VectorXd::Random(n).cwiseAbs();
+
+        Eigen::VectorXd quantiles = utilfuns::weightedQuantiles(data, weights, bands);
+        for (size_t k = 0; k < bands.size(); ++k) {
+            EXPECT_EQ(quantiles[k], sortedWeightedQuantile(data, weights, bands[k]));
+        }
+    }
+
+    //equal weights pick the order statistic whose cumulative weight first reaches q
+    Eigen::VectorXd data(4);
+    data << 40.0, 10.0, 30.0, 20.0;
+    Eigen::VectorXd quantiles = utilfuns::weightedQuantiles(data, Eigen::VectorXd::Ones(4), {0.0, 0.25, 0.3, 1.0});
+    EXPECT_EQ(quantiles[0], 10.0);
+    EXPECT_EQ(quantiles[1], 10.0);
+    EXPECT_EQ(quantiles[2], 20.0);
+    EXPECT_EQ(quantiles[3], 40.0);
+
+    EXPECT_THROW(utilfuns::weightedQuantiles(data, -Eigen::VectorXd::Ones(4), {0.5}), std::invalid_argument);
+    EXPECT_THROW(utilfuns::weightedQuantiles(data, Eigen::VectorXd::Zero(4), {0.5}), std::invalid_argument);
+    EXPECT_THROW(utilfuns::weightedQuantiles(data, Eigen::VectorXd::Ones(3), {0.5}), std::invalid_argument);
+}
+
+TEST(StochasticVolatility_utilfunsTest, Moments) {
+    std::vector<double> values = {2.5, 3.5, 4.5, 5.5};
+    Eigen::VectorXd data = Eigen::Map<const Eigen::VectorXd>(values.data(), values.size());
+    utilfuns::Moments moments = utilfuns::moments(data);
+    EXPECT_EQ(moments.weightSum, 4.0);
+    EXPECT_DOUBLE_EQ(moments.mean, utilfuns::mean(values));
+    EXPECT_DOUBLE_EQ(std::sqrt(moments.variance), utilfuns::standardDeviation(values));
+
+    //integer weights repeat the values
+    Eigen::VectorXd weights(4);
+    weights << 1.0, 3.0, 0.0, 2.0;
+    utilfuns::Moments weighted = utilfuns::moments(data, weights);
+    utilfuns::Moments repeated = utilfuns::moments((Eigen::VectorXd(6) << 2.5, 3.5, 3.5, 3.5, 5.5, 5.5).finished());
+    EXPECT_EQ(weighted.weightSum, 6.0);
+    EXPECT_NEAR(weighted.mean, repeated.mean, 1e-14);
+    EXPECT_NEAR(weighted.variance, repeated.variance, 1e-14);
+}
+
+TEST(StochasticVolatility_utilfunsTest, RowStatistics) {
+    //time x particles, large enough to be split over 4 threads
+    Eigen::MatrixXd samples = Eigen::MatrixXd::Random(64, 5000);
+    Eigen::MatrixXd weights = Eigen::MatrixXd::Random(64, 5000).cwiseAbs();
+    Eigen::MatrixXd transposed = samples.transpose(); //particles x time, as a TimeMajor storage
+
+    for (unsigned int threads : {1u, 4u}) {
+        Eigen::MatrixXd quantiles = utilfuns::rowQuantiles(samples, bands, threads);
+        Eigen::MatrixXd stridedQuantiles = utilfuns::rowQuantiles(transposed.transpose(), bands, threads);
+        Eigen::MatrixXd weightedQuantiles = utilfuns::rowWeightedQuantiles(samples, weights, bands, threads);
+        Eigen::MatrixXd moments = utilfuns::rowMoments(samples, threads);
+        Eigen::MatrixXd weightedMoments = utilfuns::rowWeightedMoments(samples, weights, threads);
+        ASSERT_EQ(quantiles.rows(), 64);
+        ASSERT_EQ(quantiles.cols(), 7);
+        ASSERT_EQ(moments.cols(), 2);
+
+        for (int row = 0; row < 64; ++row) {
+            Eigen::VectorXd data = samples.row(row).transpose();
+            Eigen::VectorXd rowWeights = weights.row(row).transpose();
+            EXPECT_TRUE(quantiles.row(row).transpose() == utilfuns::quantiles(data, bands));
+            EXPECT_TRUE(weightedQuantiles.row(row).transpose() == utilfuns::weightedQuantiles(data, rowWeights, bands));
+
+            utilfuns::Moments expected = utilfuns::moments(data);
+            EXPECT_NEAR(moments(row, 0), expected.mean, 1e-14);
+            EXPECT_NEAR(moments(row, 1), expected.variance, 1e-14);
+            expected = utilfuns::moments(data, rowWeights);
+            EXPECT_NEAR(weightedMoments(row, 0), expected.mean, 1e-14);
+            EXPECT_NEAR(weightedMoments(row, 1), expected.variance, 1e-14);
+        }
+        EXPECT_TRUE(stridedQuantiles == quantiles);
+    }
+
+    EXPECT_THROW(utilfuns::rowWeightedQuantiles(samples, transposed, bands), std::invalid_argument);
+}